@@ -28,6 +28,15 @@
 
 grammar Asl;
 
+options {
+  // every context keeps the index of its attributes (see TreeDecoration)
+  contextSuperClass = DecoratedContext;
+}
+
+@parser::header {
+#include "DecoratedContext.h"
+}
+
 //////////////////////////////////////////////////
 /// Parser Rules
 //////////////////////////////////////////////////
@@ -103,8 +112,11 @@ expr    :  '(' expr ')'                     # paren
         | ident                               # exprIdent
         ;
 
-// Identifiers
-ident   : ID
+// Identifiers (symbolId caches the SymTable::SymbolId of the name,
+// 0 until it is interned)
+ident
+locals [std::uint32_t symbolId = 0]
+        : ID
         ;
 
 //////////////////////////////////////////////////
@@ -37,6 +37,11 @@
 
 #include <string>
 #include <cstddef>    // std::size_t
+#include <utility>    // std::move
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>  // std::min
 
 // uncomment the following line to enable debugging messages with DEBUG*
 // #define DEBUG_BUILD
@@ -48,10 +53,14 @@
 // Constructor
 CodeGenVisitor::CodeGenVisitor(TypesMgr       & Types,
                                SymTable       & Symbols,
-                               TreeDecoration & Decorations) :
+                               TreeDecoration & Decorations,
+                               unsigned         numThreads,
+                               bool             shortCircuit) :
   Types{Types},
   Symbols{Symbols},
-  Decorations{Decorations} {
+  Decorations{Decorations},
+  NumThreads{numThreads},
+  ShortCircuit{shortCircuit} {
 }
 
 // Accessor/Mutator to the attribute currFunctionType
@@ -69,12 +78,42 @@ antlrcpp::Any CodeGenVisitor::visitProgram(AslParser::ProgramContext *ctx) {
   DEBUG_ENTER();
   code my_code;
   SymTable::ScopeId sc = getScopeDecor(ctx);
-  Symbols.pushThisScope(sc);
-  for (auto ctxFunc : ctx->function()) { 
-    subroutine subr = visit(ctxFunc);
-    my_code.add_subroutine(subr);
+  std::vector<AslParser::FunctionContext *> functions = ctx->function();
+  std::size_t numThreads = std::min<std::size_t>(NumThreads, functions.size() / MinFunctionsPerThread);
+  if (numThreads <= 1) {
+    Symbols.pushThisScope(sc);
+    for (auto ctxFunc : functions) { 
+      subroutine subr = visit(ctxFunc);
+      my_code.add_subroutine(subr);
+    }
+    Symbols.popScope();
+    DEBUG_EXIT();
+    return my_code;
   }
-  Symbols.popScope();
+
+  // generate the functions in parallel: every thread takes the next
+  // one with a visitor of its own (its counters, current function
+  // and stack of scopes), and they are added in source order
+  std::vector<subroutine>  subrs(functions.size(), subroutine(""));
+  std::atomic<std::size_t> next{0};
+  auto generate = [&]() {
+    SymTable       symbols(Symbols);
+    CodeGenVisitor codegen(Types, symbols, Decorations, 1, ShortCircuit);
+    symbols.pushThisScope(sc);
+    for (std::size_t i = next++; i < functions.size(); i = next++) {
+      subroutine subr = codegen.visit(functions[i]);
+      subrs[i] = std::move(subr);
+    }
+    symbols.popScope();
+  };
+  std::vector<std::thread> threads;
+  for (std::size_t t = 1; t < numThreads; ++t)
+    threads.emplace_back(generate);
+  generate();
+  for (auto & thread : threads)
+    thread.join();
+  for (auto & subr : subrs)
+    my_code.add_subroutine(subr);
   DEBUG_EXIT();
   return my_code;
 }
@@ -108,8 +147,9 @@ antlrcpp::Any CodeGenVisitor::visitFunction(AslParser::FunctionContext *ctx) {
   }
 
   instructionList && code = visit(ctx->statements());
-  code = code || instruction(instruction::RETURN());
-  subr.set_instructions(code);
+  code.append(instruction::RETURN());
+  code.back().line = ctx->getStop()->getLine();
+  subr.set_instructions(std::move(code));
   Symbols.popScope();
   DEBUG_EXIT();
   return subr;
@@ -126,11 +166,11 @@ antlrcpp::Any CodeGenVisitor::visitReturn(AslParser::ReturnContext *ctx){
 
   instructionList code;
   CodeAttribs     && codAtsE = visit(ctx->expr());
-  std::string           addr1 = codAtsE.addr;
+  operand               addr1 = codAtsE.addr;
   instructionList &     code1 = codAtsE.code;
 
 
-  code = code1 || instruction::LOAD("_result", addr1) || instruction::RETURN();
+  code = std::move(code1) || instruction::LOAD("_result", addr1) || instruction::RETURN();
 
   return code;
 
@@ -140,7 +180,7 @@ antlrcpp::Any CodeGenVisitor::visitReturn(AslParser::ReturnContext *ctx){
 antlrcpp::Any CodeGenVisitor::visitCall(AslParser::CallContext *ctx){
   DEBUG_ENTER();
   
-  std::string temp = "%"+codeCounters.newTEMP();
+  operand temp = codeCounters.newTEMP();
   instructionList code;
   auto typesParams = Types.getFuncParamsTypes(getTypeDecor(ctx->ident()));
 
@@ -151,7 +191,7 @@ antlrcpp::Any CodeGenVisitor::visitCall(AslParser::CallContext *ctx){
   for (auto & exprCtx : ctx->expr()){
     CodeAttribs && codAts = visit(exprCtx);
 
-    std::string addr = codAts.addr;
+    operand     addr = codAts.addr;
     instructionList & code1 = codAts.code;
 
     //type coertion for floats and array parameters load
@@ -159,32 +199,32 @@ antlrcpp::Any CodeGenVisitor::visitCall(AslParser::CallContext *ctx){
     //std::cout << ctx->getText() << "  " << Types.to_string(tparam) << std::endl; 
 
 
-    std::string tempAddr = addr;
+    operand tempAddr = addr;
     if(Types.isFloatTy(typesParams[i]) and Types.isIntegerTy(tparam)){
-      tempAddr = "%" + codeCounters.newTEMP();
-      code1 = code1 || instruction::FLOAT(tempAddr,addr);
+      tempAddr = codeCounters.newTEMP();
+      code1.append(instruction::FLOAT(tempAddr,addr));
       addr = tempAddr;
     }
-    else if(Types.isArrayTy(tparam) and not Symbols.isParameterClass(addr)){
+    else if(Types.isArrayTy(tparam) and not Symbols.isParameterClass(addr.name())){
 
-      tempAddr = "%" + codeCounters.newTEMP();
-      code1 = code1 || instruction::ALOAD(tempAddr, addr);
+      tempAddr = codeCounters.newTEMP();
+      code1.append(instruction::ALOAD(tempAddr, addr));
       addr = tempAddr;
     }
 
-    code = code || code1 || instruction::PUSH(addr);
+    code.append(code1).append(instruction::PUSH(addr));
     ++i;
   }
 
-  code = code || instruction::CALL(ctx->ident()->getText());
+  code.append(instruction::CALL(ctx->ident()->getText()));
 
   for (auto & exprCtx : ctx->expr()){
-    code = code || instruction::POP();
+    code.append(instruction::POP());
   }
 
-  code = code || instruction::POP(temp);
+  code.append(instruction::POP(temp));
   
-  CodeAttribs codAts(temp, "", code);
+  CodeAttribs codAts(temp, "", std::move(code));
 
   DEBUG_EXIT();
   return codAts;
@@ -203,39 +243,39 @@ antlrcpp::Any CodeGenVisitor::visitProcCall(AslParser::ProcCallContext *ctx){
   for (auto & exprCtx : ctx->expr()){
     CodeAttribs && codAts = visit(exprCtx);
 
-    std::string addr = codAts.addr;
+    operand     addr = codAts.addr;
     instructionList & code1 = codAts.code;
 
     TypesMgr::TypeId tparam = getTypeDecor(exprCtx);
-    std::string temp = addr;
+    operand temp = addr;
     //std::cout << ctx->getText() << "  " << Types.to_string(tparam) << std::endl; 
 
 
     if(Types.isFloatTy(typesParams[i]) and Types.isIntegerTy(tparam)){
-      temp = "%" + codeCounters.newTEMP();
-      code1 = code1 || instruction::FLOAT(temp,addr);
+      temp = codeCounters.newTEMP();
+      code1.append(instruction::FLOAT(temp,addr));
       addr = temp;
     }
-    else if(Types.isArrayTy(tparam) and not Symbols.isParameterClass(addr)){
-      temp = "%" + codeCounters.newTEMP();
-      code1 = code1 || instruction::ALOAD(temp, addr);
+    else if(Types.isArrayTy(tparam) and not Symbols.isParameterClass(addr.name())){
+      temp = codeCounters.newTEMP();
+      code1.append(instruction::ALOAD(temp, addr));
       addr = temp;
     }
 
 
-    code = code || code1 || instruction::PUSH(addr);
+    code.append(code1).append(instruction::PUSH(addr));
     ++i;
   }
   
 
-  code = code || instruction::CALL(ctx->ident()->getText());
+  code.append(instruction::CALL(ctx->ident()->getText()));
 
   for (auto & exprCtx : ctx->expr()){
-    code = code || instruction::POP();
+    code.append(instruction::POP());
   }
   
   if (not Types.isVoidFunction(getTypeDecor(ctx->ident()))) 
-    code = code || instruction::POP();
+    code.append(instruction::POP());
 
 
   DEBUG_EXIT();
@@ -282,7 +322,11 @@ antlrcpp::Any CodeGenVisitor::visitStatements(AslParser::StatementsContext *ctx)
   instructionList code;
   for (auto stCtx : ctx->statement()) {
     instructionList && codeS = visit(stCtx);
-    code = code || codeS;
+    // source line of the instructions (for --profile); the ones of a
+    // nested statement already have theirs
+    for (auto & instr : codeS)
+      if (instr.line == 0) instr.line = stCtx->getStart()->getLine();
+    code.append(codeS);
   }
   DEBUG_EXIT();
   return code;
@@ -292,14 +336,14 @@ antlrcpp::Any CodeGenVisitor::visitAssignStmt(AslParser::AssignStmtContext *ctx)
   DEBUG_ENTER();
   instructionList code;
   CodeAttribs     && codAtsE1 = visit(ctx->left_expr());
-  std::string           addr1 = codAtsE1.addr;
-  std::string           offs1 = codAtsE1.offs;
+  operand               addr1 = codAtsE1.addr;
+  operand               offs1 = codAtsE1.offs;
   instructionList &     code1 = codAtsE1.code;
   TypesMgr::TypeId tid1 = getTypeDecor(ctx->left_expr());
 
   CodeAttribs     && codAtsE2 = visit(ctx->expr());
-  std::string           addr2 = codAtsE2.addr;
-  //std::string           offs2 = codAtsE2.offs;
+  operand               addr2 = codAtsE2.addr;
+  //operand               offs2 = codAtsE2.offs;
   instructionList &     code2 = codAtsE2.code;
   TypesMgr::TypeId tid2 = getTypeDecor(ctx->expr());
 
@@ -307,60 +351,28 @@ antlrcpp::Any CodeGenVisitor::visitAssignStmt(AslParser::AssignStmtContext *ctx)
   //std::cout << ctx->getText() << "        " << Types.to_string(tid1) <<  "     " << Types.to_string(tid2) << std::endl;
 
 
-  code = code1 || code2;
+  code = std::move(code1) || code2;
 
   if(Types.isArrayTy(tid1) and Types.isArrayTy(tid2)){
 
-    std::string labelSTART = "ArrayCpy" + codeCounters.newLabelWHILE();
-    std::string labelEND   = "End" + labelSTART;
-
     //if either one of the arrays is not a local var, then its a paramter (then its a pointer and needs to be loaded)
-    if(not Symbols.isLocalVarClass(addr1)){
-      std::string R7 = "%" + codeCounters.newTEMP();
-      code = code || instruction::LOAD(R7,addr1);
+    if(not Symbols.isLocalVarClass(addr1.name())){
+      operand R7 = codeCounters.newTEMP();
+      code.append(instruction::LOAD(R7,addr1));
       addr1 = R7;
     }
 
-    if(not Symbols.isLocalVarClass(addr2)){
-      std::string R6 = "%" + codeCounters.newTEMP();
-      code = code || instruction::LOAD(R6,addr2);
+    if(not Symbols.isLocalVarClass(addr2.name())){
+      operand R6 = codeCounters.newTEMP();
+      code.append(instruction::LOAD(R6,addr2));
       addr2 = R6;
     }
 
     //By precondition , if there's a size mismatch is checked on the TypeCheckVisitor
-    std::string numElements = std::to_string(Types.getArraySize(tid1) - 1);
-
-    std::string constantOne = "%" + codeCounters.newTEMP();
-    std::string constantZero = "%" + codeCounters.newTEMP();
-    std::string iTemp = "%" + codeCounters.newTEMP();
-    std::string condTemp = "%" + codeCounters.newTEMP();
-    std::string elemTemp = "%" + codeCounters.newTEMP();
-
-    /* both arrays adddress are located in addr1(a) and addr2(b)  
-              r1 = 0
-              r2 = 1
-              r3 = n 
-       ArrayCpyX:
-               si no  0 <= r3 goto ENDARRAYCPYX
-               r4 = load( a[r3] )
-               store(b[r3], r4)
-               r3 = r3 - 1
-               goto ARRAYCPYX
-
-       EndArrayCpyX
-    */
-
-    code = code || instruction::LOAD(iTemp, numElements)
-                || instruction::ILOAD(constantZero, "0")
-                || instruction::ILOAD(constantOne, "1" )
-                || instruction::LABEL(labelSTART)
-                || instruction::LE(condTemp, constantZero, iTemp)
-                || instruction::FJUMP(condTemp, labelEND)
-                || instruction::LOADX(elemTemp, addr2, iTemp)
-                || instruction::XLOAD(addr1, iTemp, elemTemp)
-                || instruction::SUB(iTemp, iTemp, constantOne)
-                || instruction::UJUMP(labelSTART)
-                || instruction::LABEL(labelEND);
+    operand numElements = operand::intConst(Types.getArraySize(tid1));
+
+    // both arrays adddress are located in addr1(a) and addr2(b): a = b[0..n-1]
+    code.append(instruction::ACOPY(addr1, addr2, numElements));
 
   }
   else{
@@ -368,15 +380,15 @@ antlrcpp::Any CodeGenVisitor::visitAssignStmt(AslParser::AssignStmtContext *ctx)
     // Coerció de tipus sobre TID2 Int -> Float
     if(Types.isFloatTy(tid1) and Types.isIntegerTy(tid2)){
 
-      std::string tempF = "%" + codeCounters.newTEMP();
-      code = code || instruction::FLOAT(tempF, addr2);
+      operand tempF = codeCounters.newTEMP();
+      code.append(instruction::FLOAT(tempF, addr2));
       addr2 = tempF;
     }
 
     // A[i] = B on A és una array
-    if(offs1 != "") code = code || instruction::XLOAD(addr1,offs1,addr2);
+    if(not offs1.isNone()) code.append(instruction::XLOAD(addr1,offs1,addr2));
     // A = B on A, B no són arrays
-    else code = code || instruction::LOAD(addr1, addr2);
+    else code.append(instruction::LOAD(addr1, addr2));
     
 
   }
@@ -389,8 +401,24 @@ antlrcpp::Any CodeGenVisitor::visitIfStmt(AslParser::IfStmtContext *ctx) {
   DEBUG_ENTER();
   
   instructionList code;
+  if (ShortCircuit) {
+    std::string label = codeCounters.newLabelIF();
+    std::string lab1 = (ctx->ELSE() ? "If" : "Endif") + label;
+    std::string lab2 = "Else" + label;
+    code = jumpOnCondition(ctx->expr(), true, lab1);
+    instructionList && code2 = visit(ctx->statements(0));
+    code.append(code2);
+    if (ctx->ELSE()) {
+      instructionList && code3 = visit(ctx->statements(1));
+      code = std::move(code) || instruction::UJUMP(lab2) || instruction::LABEL(lab1) ||
+             code3 || instruction::LABEL(lab2);
+    }
+    else code.append(instruction::LABEL(lab1));
+    DEBUG_EXIT();
+    return code;
+  }
   CodeAttribs     && codAtsE = visit(ctx->expr());
-  std::string          addr1 = codAtsE.addr;
+  operand              addr1 = codAtsE.addr;
   instructionList &    code1 = codAtsE.code;
 
 
@@ -398,7 +426,7 @@ antlrcpp::Any CodeGenVisitor::visitIfStmt(AslParser::IfStmtContext *ctx) {
     instructionList &&   code2 = visit(ctx->statements(0));
     std::string label = codeCounters.newLabelIF();
     std::string labelEndIf = "Endif"+label;
-    code = code1 || instruction::FJUMP(addr1, labelEndIf) ||
+    code = std::move(code1) || instruction::FJUMP(addr1, labelEndIf) ||
           code2 || instruction::LABEL(labelEndIf);
 
   }
@@ -408,7 +436,7 @@ antlrcpp::Any CodeGenVisitor::visitIfStmt(AslParser::IfStmtContext *ctx) {
     std::string label = codeCounters.newLabelIF();
     std::string lab1 = "If"+label;
     std::string lab2 = "Else"+label;
-    code = code1 || instruction::FJUMP(addr1, lab1) || code2 ||
+    code = std::move(code1) || instruction::FJUMP(addr1, lab1) || code2 ||
           instruction::UJUMP(lab2) || instruction::LABEL(lab1) ||
           code3 || instruction::LABEL(lab2);
 
@@ -421,8 +449,19 @@ antlrcpp::Any CodeGenVisitor::visitWhileStmt(AslParser::WhileStmtContext *ctx){
   DEBUG_ENTER();
 
   instructionList code;
+  if (ShortCircuit) {
+    std::string label = codeCounters.newLabelWHILE();
+    std::string  lab1 = "While" + label;
+    std::string  lab2 = "EndWhile" + label;
+    instructionList && code1 = jumpOnCondition(ctx->expr(), true, lab2);
+    instructionList && code2 = visit(ctx->statements());
+    code = instruction::LABEL(lab1) || code1 || code2 ||
+           instruction::UJUMP(lab1) || instruction::LABEL(lab2);
+    DEBUG_EXIT();
+    return code;
+  }
   CodeAttribs    && codAtsE = visit(ctx->expr());
-  std::string         addr1 = codAtsE.addr;
+  operand             addr1 = codAtsE.addr;
   instructionList   & code1 = codAtsE.code;
   instructionList  && code2 = visit(ctx->statements());
 
@@ -443,32 +482,32 @@ antlrcpp::Any CodeGenVisitor::visitWhileStmt(AslParser::WhileStmtContext *ctx){
 antlrcpp::Any CodeGenVisitor::visitReadStmt(AslParser::ReadStmtContext *ctx) {
   DEBUG_ENTER();
   CodeAttribs     && codAtsE = visit(ctx->left_expr());
-  std::string          addr1 = codAtsE.addr;
-  std::string          offs1 = codAtsE.offs;
+  operand              addr1 = codAtsE.addr;
+  operand              offs1 = codAtsE.offs;
   instructionList &    code = codAtsE.code;
 
   TypesMgr::TypeId tid1 = getTypeDecor(ctx->left_expr());
   
-  if (offs1 != ""){
+  if (not offs1.isNone()){
     // Es una array
-    std::string temp = "%"+codeCounters.newTEMP();
+    operand temp = codeCounters.newTEMP();
     if (Types.isIntegerTy(tid1) || Types.isBooleanTy(tid1)) 
-      code = code || instruction::READI(temp);
+      code.append(instruction::READI(temp));
     else if (Types.isFloatTy(tid1))
-      code = code || instruction::READF(temp);
+      code.append(instruction::READF(temp));
     else
-      code = code || instruction::READC(temp);
+      code.append(instruction::READC(temp));
 
-    code = code || instruction::XLOAD(addr1, offs1, temp);
+    code.append(instruction::XLOAD(addr1, offs1, temp));
   }
   else {
 
     if (Types.isIntegerTy(tid1) || Types.isBooleanTy(tid1)) 
-      code = code || instruction::READI(addr1);
+      code.append(instruction::READI(addr1));
     else if (Types.isFloatTy(tid1))
-      code = code || instruction::READF(addr1);
+      code.append(instruction::READF(addr1));
     else
-      code = code || instruction::READC(addr1);
+      code.append(instruction::READC(addr1));
 
   }
 
@@ -479,18 +518,18 @@ antlrcpp::Any CodeGenVisitor::visitReadStmt(AslParser::ReadStmtContext *ctx) {
 antlrcpp::Any CodeGenVisitor::visitWriteExpr(AslParser::WriteExprContext *ctx) {
   DEBUG_ENTER();
   CodeAttribs     && codAt1 = visit(ctx->expr());
-  std::string         addr1 = codAt1.addr;
-  // std::string         offs1 = codAt1.offs;
+  operand             addr1 = codAt1.addr;
+  // operand             offs1 = codAt1.offs;
   instructionList &   code1 = codAt1.code;
   instructionList &    code = code1;
   TypesMgr::TypeId tid1 = getTypeDecor(ctx->expr());
   
   if (Types.isIntegerTy(tid1) || Types.isBooleanTy(tid1))
-    code = code1 || instruction::WRITEI(addr1);
+    code = std::move(code1) || instruction::WRITEI(addr1);
   else if (Types.isFloatTy(tid1))
-    code = code1 || instruction::WRITEF(addr1);
+    code = std::move(code1) || instruction::WRITEF(addr1);
   else if (Types.isCharacterTy(tid1))
-    code = code1 || instruction::WRITEC(addr1);
+    code = std::move(code1) || instruction::WRITEC(addr1);
 
   DEBUG_EXIT();
   return code;
@@ -500,7 +539,7 @@ antlrcpp::Any CodeGenVisitor::visitWriteString(AslParser::WriteStringContext *ct
   DEBUG_ENTER();
   instructionList code;
   std::string s = ctx->STRING()->getText();
-  code = code || instruction::WRITES(s);
+  code.append(instruction::WRITES(s));
   DEBUG_EXIT();
   return code;
 }
@@ -516,25 +555,25 @@ antlrcpp::Any CodeGenVisitor::visitSimpleIdent(AslParser::SimpleIdentContext *ct
 antlrcpp::Any CodeGenVisitor::visitArray(AslParser::ArrayContext *ctx){
   DEBUG_ENTER();
   CodeAttribs && codAtID = visit(ctx->ident());
-  std::string addrID = codAtID.addr;
+  operand     addrID = codAtID.addr;
   instructionList & codeID = codAtID.code;
 
   CodeAttribs && codAtIdx = visit(ctx->expr());
-  std::string addrIdx = codAtIdx.addr;
+  operand     addrIdx = codAtIdx.addr;
   instructionList & codeIdx = codAtIdx.code;
   //TypesMgr::TypeId IndexType = getTypeDecor(ctx->expr());
 
-  instructionList && code = codeID || codeIdx;
-  std::string value = "%" + codeCounters.newTEMP();
+  instructionList && code = std::move(codeID) || codeIdx;
+  operand value = codeCounters.newTEMP();
 
   // Check if array is local or is passed as a parameter by reference.
-  if(Symbols.isParameterClass(ctx->ident()->getText())){
-    std::string temp = "%" + codeCounters.newTEMP();
-    code = code || instruction::LOAD(temp,addrID) || instruction::LOADX(value,temp,addrIdx);
+  if(Symbols.isParameterClass(getSymbolId(ctx->ident()))){
+    operand temp = codeCounters.newTEMP();
+    code.append(instruction::LOAD(temp,addrID) || instruction::LOADX(value,temp,addrIdx));
   }
-  else code = code || instruction::LOADX(value,addrID,addrIdx);
+  else code.append(instruction::LOADX(value,addrID,addrIdx));
 
-  CodeAttribs  codAts(value,"",code);
+  CodeAttribs  codAts(value,"", std::move(code));
   DEBUG_EXIT();  
   return codAts;
 }
@@ -545,23 +584,23 @@ antlrcpp::Any CodeGenVisitor::visitArrayIdent(AslParser::ArrayIdentContext *ctx)
   DEBUG_ENTER();
   
   CodeAttribs && codeAttribID = visit(ctx->ident());
-  std::string addrID = codeAttribID.addr;
-  std::string offID  = "";
+  operand     addrID = codeAttribID.addr;
+  operand offID;
   instructionList & codeID = codeAttribID.code;
   instructionList & code = codeID;
 
   CodeAttribs && codAtIndex = visit(ctx->expr());
   offID = codAtIndex.addr;
-  code = code || codAtIndex.code;
+  code.append(codAtIndex.code);
   //std::cout << "This is an arrayIdent (left_expr) " << ctx->getText() << std::endl;
   //if this is a pointer to an array (a function paramter) then a load is needed to have the actual adress of that array
-  if(Symbols.isParameterClass(ctx->ident()->getText())){
-    std::string temp = "%" + codeCounters.newTEMP();
-    code = code || instruction::LOAD(temp,addrID);
+  if(Symbols.isParameterClass(getSymbolId(ctx->ident()))){
+    operand temp = codeCounters.newTEMP();
+    code.append(instruction::LOAD(temp,addrID));
     addrID = temp;
   }
   
-  CodeAttribs codAts(addrID, offID, code);
+  CodeAttribs codAts(addrID, offID, std::move(code));
   DEBUG_EXIT();
   return codAts;
 
@@ -585,21 +624,21 @@ antlrcpp::Any CodeGenVisitor::visitUnary(AslParser::UnaryContext *ctx){
   }
 
   instructionList & codeExpr = codeAt.code;
-  std::string addrExpr = codeAt.addr;
+  operand     addrExpr = codeAt.addr;
 
   instructionList & code = codeExpr;
 
-  std::string temp = "%"+codeCounters.newTEMP();
+  operand temp = codeCounters.newTEMP();
   TypesMgr::TypeId t1 = getTypeDecor(ctx->expr());
     
   if (ctx->NOT())
-    code = code || instruction::NOT(temp, addrExpr);
+    code.append(instruction::NOT(temp, addrExpr));
   else if (ctx->SUB() && Types.isIntegerTy(t1))
-    code = code || instruction::NEG(temp, addrExpr);
+    code.append(instruction::NEG(temp, addrExpr));
   else if (ctx->SUB())
-    code = code || instruction::FNEG(temp, addrExpr);
+    code.append(instruction::FNEG(temp, addrExpr));
 
-  CodeAttribs codAts(temp, "", code);
+  CodeAttribs codAts(temp, "", std::move(code));
 
   DEBUG_EXIT();
   return codAts;
@@ -611,14 +650,14 @@ antlrcpp::Any CodeGenVisitor::visitArithmetic(AslParser::ArithmeticContext *ctx)
   //std::cout << "Visiting expr0 of " << ctx->getText() << std::endl;
   CodeAttribs     && codAt1 = visit(ctx->expr(0));
   //std::cout << "Exiting expr0 of " << ctx->getText() << std::endl;
-  std::string         addr1 = codAt1.addr;
+  operand             addr1 = codAt1.addr;
   instructionList &   code1 = codAt1.code;
   //std::cout << "Visiting expr1 of " << ctx->getText() << std::endl;
   CodeAttribs     && codAt2 = visit(ctx->expr(1));
   //std::cout << "Exiting expr1 of " << ctx->getText() << std::endl;
-  std::string         addr2 = codAt2.addr;
+  operand             addr2 = codAt2.addr;
   instructionList &   code2 = codAt2.code;
-  instructionList &&   code = code1 || code2;
+  instructionList &&   code = std::move(code1) || code2;
   
   TypesMgr::TypeId t1 = getTypeDecor(ctx->expr(0));
   TypesMgr::TypeId t2 = getTypeDecor(ctx->expr(1));
@@ -628,46 +667,46 @@ antlrcpp::Any CodeGenVisitor::visitArithmetic(AslParser::ArithmeticContext *ctx)
 
   if (isFloat){
     if (not Types.isFloatTy(t1)){
-      std::string tempA = "%"+codeCounters.newTEMP();
-      code = code || instruction::FLOAT(tempA, addr1);
+      operand tempA = codeCounters.newTEMP();
+      code.append(instruction::FLOAT(tempA, addr1));
       addr1 = tempA;
     }
     if (not Types.isFloatTy(t2)){
-      std::string tempB = "%"+codeCounters.newTEMP();
-      code = code || instruction::FLOAT(tempB, addr2);
+      operand tempB = codeCounters.newTEMP();
+      code.append(instruction::FLOAT(tempB, addr2));
       addr2 = tempB;
     }
   }
 
-  std::string temp = "%"+codeCounters.newTEMP();
+  operand temp = codeCounters.newTEMP();
   if (ctx->MUL()){
 
-      if(not isFloat) code = code || instruction::MUL(temp, addr1, addr2);
-      else code = code || instruction::FMUL(temp, addr1, addr2);
+      if(not isFloat) code.append(instruction::MUL(temp, addr1, addr2));
+      else code.append(instruction::FMUL(temp, addr1, addr2));
 
   }
   else if (ctx->PLUS()){
 
-    if(not isFloat) code = code || instruction::ADD(temp, addr1, addr2);
-    else code = code || instruction::FADD(temp, addr1, addr2);
+    if(not isFloat) code.append(instruction::ADD(temp, addr1, addr2));
+    else code.append(instruction::FADD(temp, addr1, addr2));
 
   }
   else if (ctx->SUB()){
 
-    if(not isFloat) code = code || instruction::SUB(temp, addr1, addr2);
-    else code = code || instruction::FSUB(temp, addr1, addr2);
+    if(not isFloat) code.append(instruction::SUB(temp, addr1, addr2));
+    else code.append(instruction::FSUB(temp, addr1, addr2));
 
   }    
   else if (ctx->DIV()){
 
-    if(not isFloat) code = code || instruction::DIV(temp, addr1, addr2);
-    else code = code || instruction::FDIV(temp, addr1, addr2);
+    if(not isFloat) code.append(instruction::DIV(temp, addr1, addr2));
+    else code.append(instruction::FDIV(temp, addr1, addr2));
 
   }
   else if (ctx->MOD()) 
-    code = code || instruction::DIV(temp, addr1, addr2) || instruction::MUL(temp, temp, addr2) || instruction::SUB(temp, addr1, temp);
+    code.append(instruction::DIV(temp, addr1, addr2) || instruction::MUL(temp, temp, addr2) || instruction::SUB(temp, addr1, temp));
 
-  CodeAttribs codAts(temp, "", code);
+  CodeAttribs codAts(temp, "", std::move(code));
   DEBUG_EXIT();
   //std::cout << "Exiting arithmetic of " << ctx->getText() << std::endl;
   return codAts;
@@ -676,24 +715,45 @@ antlrcpp::Any CodeGenVisitor::visitArithmetic(AslParser::ArithmeticContext *ctx)
 antlrcpp::Any CodeGenVisitor::visitLogic(AslParser::LogicContext *ctx){
   DEBUG_ENTER();
 
+  // short-circuit: the right operand is skipped when the left one
+  // is false (and) or true (or), which is then the result
+  if (ShortCircuit) {
+    CodeAttribs && codAt1 = visit(ctx->expr(0));
+    operand temp = codeCounters.newTEMP();
+    std::string label = (ctx->AND() ? "EndAnd" : "EndOr") + codeCounters.newLabelLOGIC();
+    instructionList code = std::move(codAt1.code) || instruction::LOAD(temp, codAt1.addr);
+    if (ctx->AND())
+      code.append(instruction::FJUMP(temp, label));
+    else {
+      operand notTemp = codeCounters.newTEMP();
+      code = std::move(code) || instruction::NOT(notTemp, temp) || instruction::FJUMP(notTemp, label);
+    }
+    CodeAttribs && codAt2 = visit(ctx->expr(1));
+    code = std::move(code) || codAt2.code || instruction::LOAD(temp, codAt2.addr) ||
+           instruction::LABEL(label);
+    CodeAttribs codAts(temp, "", std::move(code));
+    DEBUG_EXIT();
+    return codAts;
+  }
+
   CodeAttribs && codAt1 = visit(ctx->expr(0));
   CodeAttribs && codAt2 = visit(ctx->expr(1));
   instructionList &   code1 = codAt1.code;
   instructionList &   code2 = codAt2.code;
-  std::string         addr1 = codAt1.addr;
-  std::string         addr2 = codAt2.addr;
+  operand             addr1 = codAt1.addr;
+  operand             addr2 = codAt2.addr;
 
-  instructionList &&   code = code1 || code2;
+  instructionList &&   code = std::move(code1) || code2;
 
 
-  std::string temp = "%"+codeCounters.newTEMP();
+  operand temp = codeCounters.newTEMP();
 
   if (ctx->AND())
-    code = code || instruction::AND(temp, addr1, addr2);
+    code.append(instruction::AND(temp, addr1, addr2));
   else if (ctx->OR())
-    code = code || instruction::OR(temp, addr1, addr2);
+    code.append(instruction::OR(temp, addr1, addr2));
 
-  CodeAttribs codAts(temp, "", code);
+  CodeAttribs codAts(temp, "", std::move(code));
   DEBUG_EXIT();
   return codAts;
 
@@ -704,71 +764,71 @@ antlrcpp::Any CodeGenVisitor::visitRelational(AslParser::RelationalContext *ctx)
   // FA FALTA COERCIÓ INT -> FLOAT COM EN EL visitArithmetic
   DEBUG_ENTER();
   CodeAttribs     && codAt1 = visit(ctx->expr(0));
-  std::string         addr1 = codAt1.addr;
+  operand             addr1 = codAt1.addr;
   instructionList &   code1 = codAt1.code;
 
   CodeAttribs     && codAt2 = visit(ctx->expr(1));
-  std::string         addr2 = codAt2.addr;
+  operand             addr2 = codAt2.addr;
   instructionList &   code2 = codAt2.code;
 
 
-  instructionList &&   code = code1 || code2;
+  instructionList &&   code = std::move(code1) || code2;
 
 
   TypesMgr::TypeId t1 = getTypeDecor(ctx->expr(0));
   TypesMgr::TypeId t2 = getTypeDecor(ctx->expr(1));
   //TypesMgr::TypeId  t = getTypeDecor(ctx);
 
-  std::string temp1= "%"+codeCounters.newTEMP();
-  std::string temp2= "%"+codeCounters.newTEMP();
+  operand temp1 = codeCounters.newTEMP();
+  operand temp2 = codeCounters.newTEMP();
 
   if(not Types.isFloatTy(t1) and not Types.isFloatTy(t2)){
 
       if (ctx->EQ())
-        code = code || instruction::EQ(temp1, addr1, addr2);
+        code.append(instruction::EQ(temp1, addr1, addr2));
       else if (ctx->NEQ())
-        code = code || instruction::EQ(temp2, addr1, addr2) || instruction::NOT(temp1, temp2);
+        code.append(instruction::EQ(temp2, addr1, addr2) || instruction::NOT(temp1, temp2));
       else if (ctx->GE())
-        code = code || instruction::LT(temp2, addr1, addr2) || instruction::NOT(temp1, temp2);
+        code.append(instruction::LT(temp2, addr1, addr2) || instruction::NOT(temp1, temp2));
       else if (ctx->GT())
-        code = code || instruction::LE(temp2, addr1, addr2) || instruction::NOT(temp1, temp2);
+        code.append(instruction::LE(temp2, addr1, addr2) || instruction::NOT(temp1, temp2));
       else if (ctx->LE())
-        code = code || instruction::LE(temp1, addr1, addr2);
+        code.append(instruction::LE(temp1, addr1, addr2));
       else if (ctx->LT())
-        code = code || instruction::LT(temp1, addr1, addr2);
+        code.append(instruction::LT(temp1, addr1, addr2));
   }
   else{
 
-    std::string addrF1 = addr1;
-    std::string addrF2 = addr2;
+    operand addrF1 = addr1;
+    operand addrF2 = addr2;
 
     if(not Types.isFloatTy(t1)){
-      addrF1 = "%" + codeCounters.newTEMP();
-      code = code || instruction::FLOAT(addrF1, addr1);
+      addrF1 = codeCounters.newTEMP();
+      code.append(instruction::FLOAT(addrF1, addr1));
     }
     
     if(not Types.isFloatTy(t2)){
-      addrF2 = "%" + codeCounters.newTEMP();
-      code = code || instruction::FLOAT(addrF2, addr2);
+      addrF2 = codeCounters.newTEMP();
+      code.append(instruction::FLOAT(addrF2, addr2));
     }
 
       if (ctx->EQ())
-        code = code || instruction::FEQ(temp1, addrF1, addrF2);
+        code.append(instruction::FEQ(temp1, addrF1, addrF2));
       else if (ctx->NEQ())
-        code = code || instruction::FEQ(temp2, addrF1, addrF2) || instruction::NOT(temp1, temp2);
+        code.append(instruction::FEQ(temp2, addrF1, addrF2) || instruction::NOT(temp1, temp2));
       else if (ctx->GE())
-        code = code || instruction::FLT(temp2, addrF1, addrF2) || instruction::NOT(temp1, temp2);
+        code.append(instruction::FLT(temp2, addrF1, addrF2) || instruction::NOT(temp1, temp2));
       else if (ctx->GT())
-        code = code || instruction::FLE(temp2, addrF1, addrF2) || instruction::NOT(temp1, temp2);
+        code.append(instruction::FLE(temp2, addrF1, addrF2) || instruction::NOT(temp1, temp2));
       else if (ctx->LE())
-        code = code || instruction::FLE(temp1, addrF1, addrF2);
+        code.append(instruction::FLE(temp1, addrF1, addrF2));
       else if (ctx->LT())
-        code = code || instruction::FLT(temp1, addrF1, addrF2);
+        code.append(instruction::FLT(temp1, addrF1, addrF2));
 
 
   }
     
-  CodeAttribs codAts(temp1, "", code);
+  CodeAttribs codAts(temp1, "", std::move(code));
   DEBUG_EXIT();
   return codAts;
 }
@@ -777,7 +837,7 @@ antlrcpp::Any CodeGenVisitor::visitRelational(AslParser::RelationalContext *ctx)
 antlrcpp::Any CodeGenVisitor::visitValue(AslParser::ValueContext *ctx) {
   DEBUG_ENTER();
   instructionList code;
-  std::string temp = "%"+codeCounters.newTEMP();
+  operand temp = codeCounters.newTEMP();
   
   if (ctx->INTVAL())
     code = instruction::ILOAD(temp, ctx->getText());
@@ -791,7 +851,7 @@ antlrcpp::Any CodeGenVisitor::visitValue(AslParser::ValueContext *ctx) {
     int isTrue = val.compare("true");
     isTrue == 0 ? code = instruction::ILOAD(temp, "1") : code = instruction::ILOAD(temp, "0");
   }
-  CodeAttribs codAts(temp, "", code);
+  CodeAttribs codAts(temp, "", std::move(code));
   DEBUG_EXIT();
   return codAts;
 }
@@ -811,6 +871,52 @@ antlrcpp::Any CodeGenVisitor::visitIdent(AslParser::IdentContext *ctx) {
 }
 
 
+// SymbolId of an identifier (interned on the first visit and
+// cached in the node)
+SymTable::SymbolId CodeGenVisitor::getSymbolId(AslParser::IdentContext *ctx) {
+  if (ctx->symbolId == SymTable::NO_SYMBOL_ID)
+    ctx->symbolId = Symbols.intern(ctx->getText());
+  return ctx->symbolId;
+}
+
+instructionList CodeGenVisitor::jumpOnCondition(AslParser::ExprContext *ctx,
+                                                bool ifFalse, const std::string & label) {
+  if (ShortCircuit) {
+    if (auto paren = dynamic_cast<AslParser::ParenContext *>(ctx))
+      return jumpOnCondition(paren->expr(), ifFalse, label);
+    auto unary = dynamic_cast<AslParser::UnaryContext *>(ctx);
+    if (unary and unary->NOT())
+      return jumpOnCondition(unary->expr(), not ifFalse, label);
+    if (auto logic = dynamic_cast<AslParser::LogicContext *>(ctx)) {
+      bool isAnd = logic->AND() != nullptr;
+      instructionList code;
+      // "a and b" is false if any of them is false, "a or b" is true
+      // if any of them is true
+      if (isAnd == ifFalse) {
+        code = jumpOnCondition(logic->expr(0), ifFalse, label);
+        code.append(jumpOnCondition(logic->expr(1), ifFalse, label));
+      }
+      // otherwise the left one decides when it is true (and) or false (or)
+      else {
+        std::string skip = (isAnd ? "EndAnd" : "EndOr") + codeCounters.newLabelLOGIC();
+        code = jumpOnCondition(logic->expr(0), not ifFalse, skip);
+        code = std::move(code) || jumpOnCondition(logic->expr(1), ifFalse, label) ||
+               instruction::LABEL(skip);
+      }
+      return code;
+    }
+  }
+  CodeAttribs && codAts = visit(ctx);
+  instructionList code = std::move(codAts.code);
+  if (ifFalse)
+    code.append(instruction::FJUMP(codAts.addr, label));
+  else {
+    operand temp = codeCounters.newTEMP();
+    code = std::move(code) || instruction::NOT(temp, codAts.addr) || instruction::FJUMP(temp, label);
+  }
+  return code;
+}
+
 // Getters for the necessary tree node atributes:
 //   Scope and Type
 SymTable::ScopeId CodeGenVisitor::getScopeDecor(antlr4::ParserRuleContext *ctx) const {
@@ -823,14 +929,14 @@ TypesMgr::TypeId CodeGenVisitor::getTypeDecor(antlr4::ParserRuleContext *ctx) co
 
 // Constructors of the class CodeAttribs:
 //
-CodeGenVisitor::CodeAttribs::CodeAttribs(const std::string & addr,
-                                         const std::string & offs,
+CodeGenVisitor::CodeAttribs::CodeAttribs(const operand & addr,
+                                         const operand & offs,
                                          instructionList & code) :
   addr{addr}, offs{offs}, code{code} {
 }
 
-CodeGenVisitor::CodeAttribs::CodeAttribs(const std::string & addr,
-                                         const std::string & offs,
+CodeGenVisitor::CodeAttribs::CodeAttribs(const operand & addr,
+                                         const operand & offs,
                                          instructionList && code) :
-  addr{addr}, offs{offs}, code{code} {
+  addr{addr}, offs{offs}, code{std::move(code)} {
 }
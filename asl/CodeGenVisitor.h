@@ -57,10 +57,15 @@ class CodeGenVisitor final : public AslBaseVisitor {
 
 public:
 
-  // Constructor
+  // Constructor: the functions of a program are generated on at most
+  // 'numThreads' threads (each one with its own counters and scopes).
+  // With 'shortCircuit' the right operand of "and" and "or" is only
+  // evaluated if the left one does not decide the result
   CodeGenVisitor(TypesMgr       & Types,
                  SymTable       & Symbols,
-                 TreeDecoration & Decorations);
+                 TreeDecoration & Decorations,
+                 unsigned         numThreads = 1,
+                 bool             shortCircuit = false);
 
   // Methods to visit each kind of node:
   antlrcpp::Any visitProgram(AslParser::ProgramContext *ctx);
@@ -98,11 +103,30 @@ private:
   counters          codeCounters;
   // Current function type (assigned before visit its instructions)
   TypesMgr::TypeId currFunctionType;
+  // Threads to generate the functions of a program
+  unsigned          NumThreads;
+  // Short-circuit evaluation of "and" and "or"
+  bool              ShortCircuit;
+
+  // Functions given to each thread, at least (fewer are generated
+  // faster on the calling thread)
+  static const std::size_t MinFunctionsPerThread = 8;
 
   // Accessor/Mutator to the type (TypeId) of the current function
   TypesMgr::TypeId getCurrentFunctionTy ()                      const;
   void             setCurrentFunctionTy (TypesMgr::TypeId type);
 
+  // SymbolId of an identifier (interned on the first visit and
+  // cached in the node)
+  SymTable::SymbolId getSymbolId (AslParser::IdentContext *ctx);
+
+  // Code of a condition that jumps to 'label' if it is false (or
+  // true, if not 'ifFalse') and goes on with the next instruction
+  // otherwise. With ShortCircuit, "and", "or" and "not" become jumps
+  // with no boolean temporal
+  instructionList jumpOnCondition (AslParser::ExprContext *ctx,
+                                   bool ifFalse, const std::string & label);
+
   // Getters for the necessary tree node atributes:
   //   Scope and Type
   SymTable::ScopeId getScopeDecor (antlr4::ParserRuleContext *ctx) const;
@@ -120,18 +144,18 @@ private:
     
   public:
     // Constructors
-    CodeAttribs(const std::string & addr,
-                const std::string & offs,
+    CodeAttribs(const operand & addr,
+                const operand & offs,
                 instructionList & code);
-    CodeAttribs(const std::string & addr,
-                const std::string & offs,
+    CodeAttribs(const operand & addr,
+                const operand & offs,
                 instructionList && code);
 
     // Attributes (publics):
     //   - the address that will hold the value of an expression
-    std::string addr;
+    operand addr;
     //   - the offset applied to the address (for array access)
-    std::string offs;
+    operand offs;
     //   - the three-address code associated to an statement/expression
     instructionList code;
 
@@ -0,0 +1,107 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    FunctionReader - Split the source of an Asl program
+//                     in functions, without parsing it
+//
+//    Copyright (C) 2017-2023  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "FunctionReader.h"
+
+#include <string>
+#include <istream>
+#include <cctype>     // std::isalnum, std::isspace
+
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+// Constructor
+FunctionReader::FunctionReader(std::istream & is) :
+  IS{is},
+  Line{1},
+  Column{0} {
+}
+
+// Reads the next function: the words are read as a whole, so that
+// only the keyword 'endfunc' (and not an identifier that contains
+// it) ends the function
+bool FunctionReader::next(Function & func) {
+  func.text.clear();
+  func.line   = Line;
+  func.column = Column;
+  bool significant = false;
+  for (int c = IS.peek(); c != EOF; c = IS.peek()) {
+    if (std::isalnum(c) or c == '_') {
+      std::size_t start = func.text.size();
+      while (c != EOF and (std::isalnum(c) or c == '_')) {
+        get(func.text);
+        c = IS.peek();
+      }
+      significant = true;
+      if (func.text.compare(start, std::string::npos, "endfunc") == 0)
+        return true;
+      continue;
+    }
+    get(func.text);
+    if (c == '/' and IS.peek() == '/') {              // comment
+      while (IS.peek() != EOF and get(func.text) != '\n') ;
+      continue;
+    }
+    if (c == '"' or c == '\'') {                      // string or character
+      for (int d = IS.peek(); d != EOF; d = IS.peek()) {
+        get(func.text);
+        if (d == '\\' and IS.peek() != EOF)
+          get(func.text);
+        else if (d == c or (c == '\'' and d == '\n'))
+          break;
+      }
+    }
+    if (not std::isspace(c))
+      significant = true;
+  }
+  return significant;
+}
+
+// Position of the next character to read
+std::size_t FunctionReader::getLine() const {
+  return Line;
+}
+std::size_t FunctionReader::getColumn() const {
+  return Column;
+}
+
+// Reads one character, appends it to the text and keeps the position
+int FunctionReader::get(std::string & text) {
+  int c = IS.get();
+  text += char(c);
+  if (c == '\n') {
+    ++Line;
+    Column = 0;
+  }
+  else
+    ++Column;
+  return c;
+}
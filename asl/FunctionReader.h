@@ -0,0 +1,83 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    FunctionReader - Split the source of an Asl program
+//                     in functions, without parsing it
+//
+//    Copyright (C) 2017-2023  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <istream>
+
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Class FunctionReader: reads the source of a program from a stream,
+// one function at a time, so that the functions can be parsed (with
+// the 'function' rule of the grammar) and compiled one by one.
+// A function is the text from the end of the previous one up to
+// the next 'endfunc' keyword (comments, strings and characters are
+// skipped, as the lexer does). The text after the last 'endfunc',
+// if it has something else than blanks and comments, is returned as
+// one more function (that the parser will reject).
+
+class FunctionReader {
+
+public:
+
+  // The text of a function, and its position in the source (line
+  // and column of its first character, as the lexer counts them)
+  struct Function {
+    std::string text;
+    std::size_t line;
+    std::size_t column;
+  };
+
+  // Constructor
+  FunctionReader(std::istream & is);
+
+  // Reads the next function. Returns false at the end of the source
+  bool next(Function & func);
+
+  // Position of the next character to read (at the end of the
+  // source, the position of the EOF token)
+  std::size_t getLine   () const;
+  std::size_t getColumn () const;
+
+private:
+
+  // Attributes
+  std::istream & IS;
+  std::size_t    Line;
+  std::size_t    Column;
+
+  // Reads one character and appends it to the text
+  int get(std::string & text);
+
+};  // class FunctionReader
@@ -38,6 +38,7 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <set>
 
 #include <cstddef>    // std::size_t
 
@@ -52,11 +53,13 @@
 SymbolsVisitor::SymbolsVisitor(TypesMgr       & Types,
                                SymTable       & Symbols,
                                TreeDecoration & Decorations,
-                               SemErrors      & Errors) :
+                               SemErrors      & Errors,
+                               DeclaredSymbols declared) :
   Types{Types},
   Symbols{Symbols},
   Decorations{Decorations},
-  Errors{Errors} {
+  Errors{Errors},
+  Declared{declared} {
 }
 
 // Methods to visit each kind of node:
@@ -85,19 +88,26 @@ antlrcpp::Any SymbolsVisitor::visitUnary(AslParser::UnaryContext *ctx)
 antlrcpp::Any SymbolsVisitor::visitFunction(AslParser::FunctionContext *ctx) {
   DEBUG_ENTER();
   std::string funcName = ctx->ID(0)->getText();
-  SymTable::ScopeId sc = Symbols.pushNewScope(funcName);
-  putScopeDecor(ctx, sc);
+  bool declareLocals = Declared != DeclareFunctions;
+  if (declareLocals) {
+    SymTable::ScopeId sc = Symbols.pushNewScope(funcName);
+    putScopeDecor(ctx, sc);
+  }
   std::vector<TypesMgr::TypeId> lParamsTy;
+  // (the names of the parameters, also when they are not declared)
+  std::set<std::string> lParamsNames;
 
   for (uint i = 1; i < ctx->ID().size(); ++i)
   {
     visit(ctx->type(i-1));
 
     std::string ident = ctx->ID(i)->getText();
-    if (Symbols.findInCurrentScope(ident)) Errors.declaredIdent(ctx->ID(i));
+    if (not lParamsNames.insert(ident).second) {
+      if (declareLocals) Errors.declaredIdent(ctx->ID(i));
+    }
     else {
       TypesMgr::TypeId ti = getTypeDecor(ctx->type(i-1));
-      Symbols.addParameter(ident, ti);
+      if (declareLocals) Symbols.addParameter(ident, ti);
       //std::cout << "To parameter " << ident << " setting type " << Types.to_string(ti) << std::endl;
       lParamsTy.push_back(ti);
     }
@@ -114,12 +124,17 @@ antlrcpp::Any SymbolsVisitor::visitFunction(AslParser::FunctionContext *ctx) {
   //std::cout << "Setting type decor to " << Types.to_string(tRet) << std::endl;
   putTypeDecor(ctx, tRet);
 
-  visit(ctx->declarations());
-  // Symbols.print();
-  Symbols.popScope();
+  if (declareLocals) {
+    visit(ctx->declarations());
+    // Symbols.print();
+    Symbols.popScope();
+  }
 
   std::string ident = ctx->ID(0)->getText();
-  if (Symbols.findInCurrentScope(ident)) {
+  if (Declared == DeclareLocals) {
+    // the function has been declared by a previous visit
+  }
+  else if (Symbols.findInCurrentScope(ident)) {
     Errors.declaredIdent(ctx->ID(0));
   }
   else {
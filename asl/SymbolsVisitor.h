@@ -52,11 +52,23 @@ class SymbolsVisitor final : public AslBaseVisitor {
 
 public:
 
+  // What is declared when visiting a function: its parameters and
+  // local variables (in a new scope) and the function itself (in the
+  // current scope). The compiler declares the functions of the
+  // program in a first pass over their headers, and the local symbols
+  // of each one in a second pass, just before it is type checked
+  enum DeclaredSymbols {
+    DeclareAll,          // both
+    DeclareFunctions,    // only the function
+    DeclareLocals,       // only the parameters and local variables
+  };
+
   // Constructor
   SymbolsVisitor(TypesMgr       & Types,
                  SymTable       & Symbols,
                  TreeDecoration & Decorations,
-                 SemErrors      & Errors);
+                 SemErrors      & Errors,
+                 DeclaredSymbols declared = DeclareAll);
 
   // Methods to visit each kind of node.
   // Non visited nodes have been commented out:
@@ -87,6 +99,7 @@ private:
   SymTable       & Symbols;
   TreeDecoration & Decorations;
   SemErrors      & Errors;
+  DeclaredSymbols  Declared;
 
   // Getters for the necessary tree node atributes:
   //   Scope and Type
@@ -239,7 +239,7 @@ antlrcpp::Any TypeCheckVisitor::visitProcCall(AslParser::ProcCallContext *ctx) {
   }
   else if (not Types.isFunctionTy(t)) Errors.isNotCallable(ctx);
   else {
-    TypesMgr::TypeId tRet = Symbols.getType(ctx->ident()->getText());
+    TypesMgr::TypeId tRet = Symbols.getType(getSymbolId(ctx->ident()));
     putTypeDecor(ctx, Types.getFuncReturnType(tRet));
 
     //std::cout << "Call to function " << ctx->ident()->getText() << " has type " << Types.to_string(tRet) << std::endl;
@@ -395,7 +395,7 @@ antlrcpp::Any TypeCheckVisitor::visitCall(AslParser::CallContext *ctx)
   }
   else if (not Types.isFunctionTy(t)) Errors.isNotCallable(ctx);
   else {
-    TypesMgr::TypeId tRet = Symbols.getType(ctx->ident()->getText());
+    TypesMgr::TypeId tRet = Symbols.getType(getSymbolId(ctx->ident()));
     putTypeDecor(ctx, Types.getFuncReturnType(tRet));
 
     //std::cout << "Call to function " << ctx->ident()->getText() << " has type " << Types.to_string(tRet) << std::endl;
@@ -595,7 +595,7 @@ antlrcpp::Any TypeCheckVisitor::visitExprIdent(AslParser::ExprIdentContext *ctx)
 
 antlrcpp::Any TypeCheckVisitor::visitIdent(AslParser::IdentContext *ctx) {
   DEBUG_ENTER();
-  std::string ident = ctx->getText();
+  SymTable::SymbolId ident = getSymbolId(ctx);
   if (Symbols.findInStack(ident) == -1) {
     Errors.undeclaredIdent(ctx->ID());
     TypesMgr::TypeId te = Types.createErrorTy();
@@ -616,6 +616,14 @@ antlrcpp::Any TypeCheckVisitor::visitIdent(AslParser::IdentContext *ctx) {
 
 
 
+// SymbolId of an identifier (interned on the first visit and
+// cached in the node)
+SymTable::SymbolId TypeCheckVisitor::getSymbolId(AslParser::IdentContext *ctx) {
+  if (ctx->symbolId == SymTable::NO_SYMBOL_ID)
+    ctx->symbolId = Symbols.intern(ctx->getText());
+  return ctx->symbolId;
+}
+
 // Getters for the necessary tree node atributes:
 //   Scope, Type ans IsLValue
 SymTable::ScopeId TypeCheckVisitor::getScopeDecor(antlr4::ParserRuleContext *ctx) {
@@ -103,6 +103,10 @@ private:
   TypesMgr::TypeId getCurrentFunctionTy ()                      const;
   void             setCurrentFunctionTy (TypesMgr::TypeId type);
 
+  // SymbolId of an identifier (interned on the first visit and
+  // cached in the node)
+  SymTable::SymbolId getSymbolId (AslParser::IdentContext *ctx);
+
   // Getters for the necessary tree node atributes:
   //   Scope, Type ans IsLValue
   SymTable::ScopeId getScopeDecor    (antlr4::ParserRuleContext *ctx);
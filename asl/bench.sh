@@ -0,0 +1,146 @@
+#!/bin/bash
+
+# Benchmarks of the compiler and of the execution of the generated
+# code, for the programs of ../benchmarks (and two generated ones).
+# Every benchmark writes one line with a JSON object on the standard
+# output, e.g. to compare two commits:
+#   make bench > before.json ; ... ; make bench > after.json
+# The optimization level is taken from $ASLFLAGS (e.g. ASLFLAGS=-O2),
+# and BENCH_TVM=0 skips the (slow) executions with ../tvm/tvm-linux.
+#
+#   name:         the benchmark
+#   flags:        $ASLFLAGS
+#   compile:      the output of --stats=json (time and memory of each
+#                 phase, instructions of each function)
+#   run_ms:       execution time with ./asl --run (-1 if it fails)
+#   tvm_ms:       execution time with ../tvm/tvm-linux
+#   native_ms:    execution time of the executable of --emit=exe
+#                 (-1 if the compiler is built without LLVM)
+#   output_ok:    the outputs of the executions are the expected ones
+#                 (the ones of ../benchmarks, and for the generated
+#                 programs the result computed here by the shell)
+
+BENCHDIR=../benchmarks
+TMPDIR=$(mktemp -d)
+trap 'rm -rf "$TMPDIR"' EXIT
+
+# milliseconds since the epoch
+function now_ms() {
+    echo $(( $(date +%s%N) / 1000000 ))
+}
+
+# time_ms <input> <expected> <command...>: sets 'ms' to the execution
+# time of the command (-1 if it fails), and clears 'ok' if the output
+# is not the expected one (not called in a $(...): that would be a
+# subshell, and 'ok' would not change here)
+function time_ms() {
+    input=$1; expected=$2; shift 2
+    start=$(now_ms)
+    if "$@" < "$input" > "$TMPDIR/out" 2>/dev/null; then
+	ms=$(( $(now_ms) - start ))
+	cmp -s "$TMPDIR/out" "$expected" || ok=false
+    else
+	ms=-1
+	ok=false
+    fi
+}
+
+# bench <name> <asl file> <input> <expected output>
+function bench() {
+    name=$1; asl=$2; input=$3; expected=$4
+    ok=true
+    stats=$(./asl $ASLFLAGS --stats=json "$asl" 2>&1 >"$TMPDIR/$name.t" | tail -1)
+    time_ms "$input" "$expected" ./asl $ASLFLAGS --run "$asl"
+    run=$ms
+    tvm=-1
+    if [ "$BENCH_TVM" != 0 ]; then
+	time_ms "$input" "$expected" ../tvm/tvm-linux "$TMPDIR/$name.t"
+	tvm=$ms
+    fi
+    native=-1
+    if ./asl $ASLFLAGS --emit=exe -o "$TMPDIR/$name" "$asl" >/dev/null 2>&1; then
+	time_ms "$input" "$expected" "$TMPDIR/$name"
+	native=$ms
+    fi
+    echo "{\"name\": \"$name\", \"flags\": \"$ASLFLAGS\", \"compile\": $stats," \
+	 "\"run_ms\": $run, \"tvm_ms\": $tvm, \"native_ms\": $native, \"output_ok\": $ok}"
+}
+
+# a program with 'n' small functions called from main
+function generate_functions() {
+    n=$1
+    for ((i = 0; i < n; i++)); do
+	echo "func f$i(a:int, b:int):int"
+	echo "  var x:int"
+	echo "  x = a * $i + b;"
+	echo "  if x > 100 then x = x % 100; endif"
+	echo "  return x;"
+	echo "endfunc"
+    done
+    echo "func main()"
+    echo "  var s:int"
+    echo "  s = 0;"
+    for ((i = 0; i < n; i++)); do
+	echo "  s = f$i(s, $i);"
+    done
+    echo "  write s; write \"\\n\";"
+    echo "endfunc"
+}
+
+# the output of generate_functions 'n'
+function expected_functions() {
+    n=$1
+    s=0
+    for ((i = 0; i < n; i++)); do
+	s=$(( s * i + i ))
+	if (( s > 100 )); then s=$(( s % 100 )); fi
+    done
+    echo $s
+}
+
+# a program with one function of 'n' statements (v is cleared first:
+# the elements read before they are written would have any value in
+# the native code)
+function generate_statements() {
+    n=$1
+    echo "func main()"
+    echo "  var a, b, c:int"
+    echo "  var v:array[100] of int"
+    echo "  var i:int"
+    echo "  i = 0;"
+    echo "  while i < 100 do v[i] = 0; i = i + 1; endwhile"
+    echo "  a = 1; b = 2; c = 0;"
+    for ((i = 0; i < n; i++)); do
+	echo "  v[$((i % 100))] = a * $i + b;"
+	echo "  c = (c + v[$(((i * 7) % 100))]) % 1000;"
+	echo "  if c > 500 then a = a + 1; else b = b - 1; endif"
+    done
+    echo "  write c; write \"\\n\";"
+    echo "endfunc"
+}
+
+# the output of generate_statements 'n'
+function expected_statements() {
+    n=$1
+    a=1; b=2; c=0
+    v=()
+    for ((i = 0; i < 100; i++)); do v[i]=0; done
+    for ((i = 0; i < n; i++)); do
+	v[i % 100]=$(( a * i + b ))
+	c=$(( (c + v[(i * 7) % 100]) % 1000 ))
+	if (( c > 500 )); then a=$(( a + 1 )); else b=$(( b - 1 )); fi
+    done
+    echo $c
+}
+
+for f in $BENCHDIR/*.asl; do
+    bench $(basename "$f" .asl) "$f" "${f/.asl/.in}" "${f/.asl/.out}"
+done
+
+generate_functions 2000 > "$TMPDIR/functions.asl"
+expected_functions 2000 > "$TMPDIR/functions.out"
+bench functions "$TMPDIR/functions.asl" /dev/null "$TMPDIR/functions.out"
+
+generate_statements 5000 > "$TMPDIR/statements.asl"
+expected_statements 5000 > "$TMPDIR/statements.out"
+bench statements "$TMPDIR/statements.asl" /dev/null "$TMPDIR/statements.out"
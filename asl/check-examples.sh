@@ -1,5 +1,8 @@
 #!/bin/bash
 
+# the generated code is executed with "./asl $ASLFLAGS --run", e.g.
+#   ASLFLAGS=-O2 ./check-examples.sh
+
 #--------------------------------------------
 function check_chkt_example() {
     expected=$1
@@ -67,7 +70,7 @@ for f in ../examples/jpbasic_genc_*.asl; do
     if (test $? != 0); then
        echo "Compilation errors"
     else
-       ../tvm/tvm tmp.t < "${f/asl/in}" >tmp.out
+       ./asl $ASLFLAGS --run "$f" < "${f/asl/in}" >tmp.out
        check_genc_example "${f/asl/out}" tmp.out
     fi
     rm -f tmp.t tmp.out tmp.diff
@@ -85,7 +88,7 @@ for f in ../examples/jp_genc_*.asl; do
     if (test $? != 0); then
        echo "Compilation errors"
     else
-       ../tvm/tvm tmp.t < "${f/asl/in}" >tmp.out
+       ./asl $ASLFLAGS --run "$f" < "${f/asl/in}" >tmp.out
        check_genc_example "${f/asl/out}" tmp.out
     fi
     rm -f tmp.t tmp.out tmp.diff
@@ -41,105 +41,1018 @@
 #include "SymbolsVisitor.h"
 #include "TypeCheckVisitor.h"
 #include "../common/code.h"
+#include "../common/Interpreter.h"
+#include "../common/Optimizer.h"
+#include "../common/NativeBackend.h"
+#include "../common/JIT.h"
+#include "../common/CompilerStats.h"
+#include "../common/CompilationCache.h"
 #include "CodeGenVisitor.h"
+#include "FunctionReader.h"
 
 #include <iostream>
 #include <fstream>    // ifstream
+#include <sstream>    // ostringstream
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <memory>     // std::make_shared
+#include <iterator>   // std::istreambuf_iterator
 
-#include <cstdio>     // fopen
+#include <cstdio>     // fopen, std::remove
 #include <cstdlib>    // EXIT_FAILURE, EXIT_SUCCESS
+#include <cstring>    // std::strcpy, std::strerror
+#include <cerrno>
+#include <csignal>    // std::signal
+#include <sys/socket.h>
+#include <sys/un.h>   // sockaddr_un
+#include <sys/stat.h> // stat
+#include <unistd.h>   // read, close, unlink
 
 // using namespace std;
 // using namespace antlr4;
 
 
-int main(int argc, const char* argv[]) {
-  // check the correct use of the program
-  if (argc > 2) {
-    std::cout << "Usage: ./main [<file>]" << std::endl;
-    return EXIT_FAILURE;
-  }
-  if (argc == 2 and not std::fopen(argv[1], "r")) {
-    std::cout << "No such file: " << argv[1] << std::endl;
-    return EXIT_FAILURE;
+static void usage() {
+  std::cout << "Usage: ./main [-O0 | -O1 | -O2] [--short-circuit] [--stats[=json]] [--cache <dir>] [--run | --jit | --emit-bin <binfile>] [<file>]" << std::endl;
+  std::cout << "       ./main [-O0 | -O1 | -O2] [--short-circuit] [--stats[=json]] [--cache <dir>] --profile[=flamegraph] [<file>]" << std::endl;
+  std::cout << "       ./main [-O0 | -O1 | -O2] [--short-circuit] [--stats[=json]] [--cache <dir>] --emit=ll|obj|exe [-o <outfile>] [<file>]" << std::endl;
+  std::cout << "       ./main [-O0 | -O1 | -O2] [--short-circuit] [--emit=ll|obj|exe] [-j <jobs>] <file> <file>..." << std::endl;
+  std::cout << "       ./main [-O0 | -O1 | -O2] [--short-circuit] --stream <file>" << std::endl;
+  std::cout << "       ./main [--profile[=flamegraph]] --run-bin <binfile>" << std::endl;
+  std::cout << "       ./main [-j <jobs>] --serve <socket>" << std::endl;
+  std::cout << "       ./main [-O0 | -O1 | -O2] [--short-circuit] [--run] --connect <socket> [<file>]" << std::endl;
+}
+
+// name of the file generated from <file> (or from std::cin):
+// its base name without extension, and the given suffix
+static std::string outputFileName(const char *fileName, const std::string & suffix) {
+  if (not fileName)
+    return "output" + suffix;
+  std::string inputFileName = std::string(fileName);
+  std::size_t slashPos = inputFileName.rfind("/");
+  std::size_t start    = (slashPos == std::string::npos) ? 0 : slashPos+1;
+  std::size_t dotPos   = inputFileName.rfind(".");
+  if (dotPos == std::string::npos or dotPos < start)
+    dotPos = inputFileName.size();
+  return inputFileName.substr(start, dotPos-start) + suffix;
+}
+
+// ANTLR syntax errors written to a stream (as the console listener
+// of ANTLR does with std::cerr)
+class StreamErrorListener : public antlr4::BaseErrorListener {
+ public:
+  StreamErrorListener(std::ostream & os) : OS(os) {}
+  void syntaxError(antlr4::Recognizer *recognizer, antlr4::Token *offendingSymbol,
+                   std::size_t line, std::size_t charPositionInLine,
+                   const std::string & msg, std::exception_ptr e) override {
+    OS << "line " << line << ":" << charPositionInLine << " " << msg << std::endl;
   }
+ private:
+  std::ostream & OS;
+};
 
-  // open input file (or std::cin) and create a character stream
-  antlr4::ANTLRInputStream input;
-  if (argc == 2) {  // read from <file>
-    std::ifstream stream;
-    stream.open(argv[1]);
-    input = antlr4::ANTLRInputStream(stream);
+// call the parser rule (program or function) with the SLL prediction
+// mode and an error strategy that gives up at the first error, which
+// is faster and enough for almost every correct input. If it fails,
+// parse the input again with the full LL prediction mode and the
+// error listener (it is the only parse if the input has syntax
+// errors). 'fellBack' tells if the second parse has been needed
+template <typename Context>
+static Context *parseSLLFirst(AslParser & parser, Context *(AslParser::*rule)(),
+                              antlr4::BaseErrorListener & errorListener, bool & fellBack) {
+  auto *interpreter = parser.getInterpreter<antlr4::atn::ParserATNSimulator>();
+  interpreter->setPredictionMode(antlr4::atn::PredictionMode::SLL);
+  parser.setErrorHandler(std::make_shared<antlr4::BailErrorStrategy>());
+  parser.removeErrorListeners();
+  fellBack = false;
+  try {
+    return (parser.*rule)();
   }
-  else {            // read fron std::cin
-    input = antlr4::ANTLRInputStream(std::cin);
+  catch (antlr4::ParseCancellationException &) {
+    fellBack = true;
   }
+  parser.reset();     // (back to the first token)
+  interpreter->setPredictionMode(antlr4::atn::PredictionMode::LL);
+  parser.setErrorHandler(std::make_shared<antlr4::DefaultErrorStrategy>());
+  parser.addErrorListener(&errorListener);
+  return (parser.*rule)();
+}
+
+// one ASL program: the auxililary classes we are going to need to
+// store information while traversing the tree (they are described
+// below in this document), and the generated code
+struct Compilation {
+  TypesMgr       types;
+  SymTable       symbols{types};
+  TreeDecoration decorations;
+  SemErrors      errors;
+  code           mycode;
+  // the program has been parsed again in LL mode (see parseSLLFirst)
+  bool           parsedWithLL = false;
+  // time and memory of the phases, and counters (--stats)
+  CompilerStats  stats;
+
+  // the messages of the compilation (and the semantic errors) are
+  // written to 'out', the syntax errors to 'err'
+  Compilation(std::ostream & out, std::ostream & err) : errors(out), out(out), err(err) {}
+  std::ostream & out;
+  std::ostream & err;
+};
+
+// number of nodes of a parse tree (rules and tokens)
+static std::size_t countNodes(antlr4::tree::ParseTree *tree) {
+  std::size_t n = 1;
+  for (auto child : tree->children)
+    n += countNodes(child);
+  return n;
+}
+
+// optimize the generated code
+static void optimize(int optLevel, Compilation & comp) {
+  Optimizer optimizer(optLevel);
+  optimizer.run(comp.mycode);
+  comp.stats.endPhase("optimizer");
+  std::size_t numInstructions = 0;
+  for (auto & subr : comp.mycode.get_subroutine_list()) {
+    comp.stats.setInstructions(subr.get_name(), subr.get_instructions().size());
+    numInstructions += subr.get_instructions().size();
+  }
+  comp.stats.setCounter("instructions", numInstructions);
+}
+
+// parse, check and generate the (optimized) code of the program in
+// 'input'; false if it has errors
+static bool compile(antlr4::ANTLRInputStream & input, int optLevel, bool shortCircuit,
+                    unsigned numThreads, Compilation & comp) {
+  StreamErrorListener errorListener(comp.err);
 
   // create a lexer that consumes the character stream and produces a token stream
   AslLexer lexer(&input);
+  lexer.removeErrorListeners();
+  lexer.addErrorListener(&errorListener);
   antlr4::CommonTokenStream tokens(&lexer);
+  tokens.fill();
+  comp.stats.endPhase("lexer");
+  comp.stats.setCounter("tokens", tokens.size());
 
   // create a parser that consumes the token stream, and parses it.
   AslParser parser(&tokens);
 
   // call the parser and get the parse tree
-  antlr4::tree::ParseTree *tree = parser.program();
+  AslParser::ProgramContext *tree = parseSLLFirst(parser, &AslParser::program,
+                                                  errorListener, comp.parsedWithLL);
+  comp.stats.endPhase("parser");
+  comp.stats.setCounter("parse_tree_nodes", countNodes(tree));
+  comp.stats.setCounter("ll_fallback", comp.parsedWithLL);
 
   // check for lexical or syntactical errors
   if (lexer.getNumberOfSyntaxErrors() > 0 or
       parser.getNumberOfSyntaxErrors() > 0) {
-    std::cout << "Lexical and/or syntactical errors have been found." << std::endl;
-    return EXIT_FAILURE;
+    comp.out << "Lexical and/or syntactical errors have been found." << std::endl;
+    return false;
   }
 
   // print the parse tree (for debugging purposes)
   // std::cout << tree->toStringTree(&parser) << std::endl;
 
-  // auxililary classes we are going to need to store information while
-  // traversing the tree. They are described below in this document
-  TypesMgr       types;
-  SymTable       symbols(types);
-  TreeDecoration decorations;
-  SemErrors      errors;
+  // the semantic analysis walks the tree twice: a pass over the
+  // headers of the functions declares them (a function can call the
+  // ones after it), and then each function declares its parameters and
+  // local variables and is type checked right away, while its subtree
+  // is still in the cache
+  SymTable::ScopeId sc = comp.symbols.pushNewScope(SymTable::GLOBAL_SCOPE_NAME);
+  comp.decorations.putScope(tree, sc);
+  SymbolsVisitor signatures(comp.types, comp.symbols, comp.decorations, comp.errors,
+                            SymbolsVisitor::DeclareFunctions);
+  for (auto ctxFunc : tree->function())
+    signatures.visit(ctxFunc);
+  SymbolsVisitor symboldecl(comp.types, comp.symbols, comp.decorations, comp.errors,
+                            SymbolsVisitor::DeclareLocals);
+  TypeCheckVisitor typecheck(comp.types, comp.symbols, comp.decorations, comp.errors);
+  for (auto ctxFunc : tree->function()) {
+    symboldecl.visit(ctxFunc);
+    typecheck.visit(ctxFunc);
+  }
+  if (comp.symbols.noMainProperlyDeclared())
+    comp.errors.noMainProperlyDeclared(tree);
+  comp.symbols.popScope();
+  comp.errors.print();
+  comp.stats.endPhase("semantic");
+  comp.stats.setCounter("symbols", comp.symbols.getNumberOfSymbols());
+  comp.stats.setCounter("types", comp.types.getNumberOfTypes());
+
+  if (comp.errors.getNumberOfSemanticErrors() > 0) {
+    comp.out << "There are semantic errors: no code generated." << std::endl;
+    return false;
+  }
+
+  // create a visitor that will return the generated code
+  // for each part of the tree, and will store it in 'mycode'
+  CodeGenVisitor codegenerator(comp.types, comp.symbols, comp.decorations, numThreads, shortCircuit);
+  comp.mycode = codegenerator.visit(tree);
+  comp.stats.endPhase("codegen");
+
+  optimize(optLevel, comp);
+  return true;
+}
+
+// execute the program with the interpreter, and write its profile
+// on std::cerr (after the output of the program)
+static int runProfiled(const Interpreter & interpreter, const std::string & profileFormat) {
+  Interpreter::Profile prof;
+  int status = interpreter.profile(std::cin, std::cout, prof);
+  std::cout.flush();
+  if (profileFormat == "flamegraph")
+    interpreter.printFlameGraph(prof, std::cerr);
+  else
+    interpreter.printProfile(prof, std::cerr);
+  return status;
+}
+
+// write the t-code of the program, as it is printed (for tvm)
+static void dumpTCode(code & mycode, std::ostream & os) {
+  Optimizer lowering;
+  lowering.addPass("expand-array-operations", Optimizer::expandArrayOperations);
+  lowering.run(mycode);
+  mycode.dump(os);
+}
+
+// write the LLVM code of the program to 'outFileName' (emitKind "ll"),
+// or compile it to an object file ("obj") or an executable ("exe")
+static bool emitLLVM(Compilation & comp, const std::string & emitKind,
+                     const std::string & outFileName, int optLevel) {
+  std::string llvmStr, llvmErrors;
+  if (emitKind == "ll") {
+    // written as it is generated (removed if some function fails)
+    std::ofstream myLLVMFile(outFileName, std::ofstream::out);
+    bool ok = myLLVMFile and
+              comp.mycode.dumpLLVM(comp.types, comp.symbols, myLLVMFile, llvmErrors);
+    if (not ok and not llvmErrors.empty()) {
+      myLLVMFile.close();
+      std::remove(outFileName.c_str());
+      comp.err << llvmErrors << std::endl;
+      return false;
+    }
+    if (not (myLLVMFile << std::endl)) {
+      comp.out << "Cannot write LLVM code to " << outFileName << std::endl;
+      return false;
+    }
+    return true;
+  }
+  if (not comp.mycode.dumpLLVM(comp.types, comp.symbols, llvmStr, llvmErrors)) {
+    comp.err << llvmErrors << std::endl;
+    return false;
+  }
+  NativeBackend backend(optLevel);
+  bool ok;
+  if (emitKind == "obj")
+    ok = backend.emitObject(llvmStr, outFileName);
+  else
+    ok = backend.emitExecutable(llvmStr, outFileName);
+  if (not ok)
+    comp.out << backend.getErrorMessage() << std::endl;
+  return ok;
+}
+
+// batch mode: compile every file on 'jobs' threads. The output of
+// each one is written to the current directory (<base>.t with the
+// t-code, or the file of --emit), and the messages of all of them
+// are reported at the end, in the order of the files
+static int compileBatch(const std::vector<const char *> & fileNames,
+                        int optLevel, bool shortCircuit, const std::string & emitKind,
+                        unsigned jobs) {
+  const std::string suffix = emitKind.empty() ? ".t" :
+                             emitKind == "ll" ? ".ll" : emitKind == "obj" ? ".o" : "";
+  std::vector<std::string> outFileNames;
+  std::set<std::string> seen;
+  for (const char *fileName : fileNames) {
+    outFileNames.push_back(outputFileName(fileName, suffix));
+    if (not seen.insert(outFileNames.back()).second) {
+      std::cout << "Several files would be compiled to " << outFileNames.back() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
 
-  // create a visitor that looks for variables and function declarations
-  // in the tree and stores required information
-  SymbolsVisitor symboldecl(types, symbols, decorations, errors);
-  symboldecl.visit(tree);
+  std::vector<std::ostringstream> messages(fileNames.size());
+  std::vector<char>               failed(fileNames.size(), 0);
+  std::vector<char>               parsedWithLL(fileNames.size(), 0);
+  std::atomic<std::size_t>        next{0};
+  auto worker = [&]() {
+    for (std::size_t i = next++; i < fileNames.size(); i = next++) {
+      std::ifstream stream(fileNames[i]);
+      if (not stream) {
+        messages[i] << "No such file: " << fileNames[i] << std::endl;
+        failed[i] = 1;
+        continue;
+      }
+      antlr4::ANTLRInputStream input(stream);
+      Compilation comp(messages[i], messages[i]);
+      bool ok = compile(input, optLevel, shortCircuit, 1, comp);
+      parsedWithLL[i] = comp.parsedWithLL;
+      if (ok and emitKind.empty()) {
+        std::ofstream outFile(outFileNames[i], std::ofstream::out);
+        dumpTCode(comp.mycode, outFile);
+        if (not (outFile << std::endl)) {
+          messages[i] << "Cannot write t-code to " << outFileNames[i] << std::endl;
+          ok = false;
+        }
+      }
+      else if (ok)
+        ok = emitLLVM(comp, emitKind, outFileNames[i], optLevel);
+      failed[i] = not ok;
+    }
+  };
+  if (jobs > fileNames.size())
+    jobs = fileNames.size();
+  std::vector<std::thread> threads;
+  for (unsigned t = 1; t < jobs; ++t)
+    threads.emplace_back(worker);
+  worker();
+  for (auto & thread : threads)
+    thread.join();
 
-  // create another visitor that will perform type checkings wherever
-  // it is needed (on expressions, assignments, parameter passing, etc)
-  TypeCheckVisitor typecheck(types, symbols, decorations, errors);
-  typecheck.visit(tree);
+  std::size_t numFailed = 0, numParsedWithLL = 0;
+  for (std::size_t i = 0; i < fileNames.size(); ++i) {
+    std::istringstream lines(messages[i].str());
+    for (std::string line; std::getline(lines, line); )
+      std::cout << fileNames[i] << ": " << line << std::endl;
+    numFailed += failed[i];
+    numParsedWithLL += parsedWithLL[i] and not failed[i];
+  }
+  if (numParsedWithLL > 0)
+    std::cout << numParsedWithLL << " of " << fileNames.size()
+              << " files needed the full LL parser." << std::endl;
+  if (numFailed > 0) {
+    std::cout << numFailed << " of " << fileNames.size() << " files have errors." << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+// one function of a program, parsed with the 'function' rule of the
+// grammar (the lexer starts counting at its position in the file)
+struct ParsedFunction {
+  antlr4::ANTLRInputStream    input;
+  StreamErrorListener         errorListener;
+  AslLexer                    lexer;
+  antlr4::CommonTokenStream   tokens;
+  AslParser                   parser;
+  AslParser::FunctionContext *tree;
+  bool                        parsedWithLL;
+
+  ParsedFunction(const FunctionReader::Function & func, std::ostream & err) :
+    input(func.text), errorListener(err), lexer(&input), tokens(&lexer), parser(&tokens) {
+    lexer.setLine(func.line);
+    lexer.setCharPositionInLine(func.column);
+    lexer.removeErrorListeners();
+    lexer.addErrorListener(&errorListener);
+    tree = parseSLLFirst(parser, &AslParser::function, errorListener, parsedWithLL);
+  }
+  bool hasErrors() {
+    return lexer.getNumberOfSyntaxErrors() > 0 or parser.getNumberOfSyntaxErrors() > 0;
+  }
+};
 
+// cached mode: compile the program in 'is' one function at a time,
+// as the streaming mode, but the code of the functions that have not
+// changed is taken from 'cache' with no parsing, checking or code
+// generation (they only declare their symbols), and the code of the
+// others is written to it. False if the program has errors
+static bool compileCached(std::istream & is, int optLevel, bool shortCircuit,
+                          const CompilationCache & cache, Compilation & comp) {
+  struct Function {
+    FunctionReader::Function        source;
+    std::string                     key;
+    CompilationCache::Entry         entry;
+    bool                            cached;
+    std::unique_ptr<ParsedFunction> parsed;
+  };
+  std::vector<Function> functions;
+  FunctionReader reader(is);
+  for (FunctionReader::Function func; reader.next(func); ) {
+    functions.emplace_back();
+    Function & function = functions.back();
+    function.source = func;
+    function.key    = CompilationCache::key(func.text, shortCircuit);
+    function.cached = cache.load(function.key, func.text, function.entry);
+  }
+  comp.stats.endPhase("cache");
+
+  // the functions that are not in the cache are parsed, and also the
+  // ones whose name is not unique (the error is reported at the second
+  // one, which must be checked)
+  auto parse = [&](Function & function) {
+    function.cached = false;
+    function.parsed.reset(new ParsedFunction(function.source, comp.err));
+    comp.parsedWithLL = comp.parsedWithLL or function.parsed->parsedWithLL;
+    return not function.parsed->hasErrors();
+  };
+  bool syntaxErrors = false;
+  for (auto & function : functions)
+    if (not function.cached)
+      syntaxErrors = not parse(function) or syntaxErrors;
+  if (syntaxErrors or functions.empty()) {
+    comp.out << "Lexical and/or syntactical errors have been found." << std::endl;
+    return false;
+  }
+  std::map<std::string, std::size_t> uses;
+  for (auto & function : functions)
+    ++uses[function.cached ? function.entry.subr.get_name() :
+                             function.parsed->tree->ID(0)->getText()];
+  for (auto & function : functions)
+    if (function.cached and uses[function.entry.subr.get_name()] > 1)
+      parse(function);
+  comp.stats.endPhase("parser");
+
+  // the signatures of the functions, and then the ones in the cache
+  // that call a function whose type has changed are checked again
+  comp.symbols.pushNewScope(SymTable::GLOBAL_SCOPE_NAME);
+  SymbolsVisitor signatures(comp.types, comp.symbols, comp.decorations, comp.errors,
+                            SymbolsVisitor::DeclareFunctions);
+  for (auto & function : functions)
+    if (function.cached)
+      CompilationCache::declareFunction(function.entry, comp.types, comp.symbols);
+    else
+      signatures.visit(function.parsed->tree);
+  for (auto & function : functions)
+    if (function.cached and not CompilationCache::usable(function.entry, comp.types, comp.symbols))
+      parse(function);
+  if (comp.symbols.noMainProperlyDeclared())
+    comp.errors.noMainProperlyDeclared(reader.getLine(), reader.getColumn());
+  SymbolsVisitor symboldecl(comp.types, comp.symbols, comp.decorations, comp.errors,
+                            SymbolsVisitor::DeclareLocals);
+  TypeCheckVisitor typecheck(comp.types, comp.symbols, comp.decorations, comp.errors);
+  std::size_t numCached = 0;
+  for (auto & function : functions) {
+    if (function.cached) {
+      CompilationCache::declareLocals(function.entry, comp.types, comp.symbols);
+      ++numCached;
+      continue;
+    }
+    symboldecl.visit(function.parsed->tree);
+    typecheck.visit(function.parsed->tree);
+  }
+  comp.errors.print();
+  comp.stats.endPhase("semantic");
+  comp.stats.setCounter("cached_functions", numCached);
+  comp.stats.setCounter("symbols", comp.symbols.getNumberOfSymbols());
+  comp.stats.setCounter("types", comp.types.getNumberOfTypes());
+  if (comp.errors.getNumberOfSemanticErrors() > 0) {
+    comp.symbols.popScope();
+    comp.out << "There are semantic errors: no code generated." << std::endl;
+    return false;
+  }
+
+  CodeGenVisitor codegenerator(comp.types, comp.symbols, comp.decorations, 1, shortCircuit);
+  for (auto & function : functions) {
+    if (function.cached) {
+      comp.mycode.add_subroutine(CompilationCache::codeAt(function.entry, function.source.line));
+      continue;
+    }
+    subroutine subr = codegenerator.visit(function.parsed->tree);
+    cache.store(function.key,
+                CompilationCache::makeEntry(function.source.text, function.source.line,
+                                            subr, comp.types, comp.symbols));
+    comp.mycode.add_subroutine(subr);
+    function.parsed.reset();
+  }
+  comp.symbols.popScope();
+  comp.stats.endPhase("codegen");
+
+  optimize(optLevel, comp);
+  return true;
+}
+
+// streaming mode: compile the program one function at a time, so
+// that only the signatures of the functions and the function being
+// compiled are kept in memory. A first pass over the file declares
+// the functions; the second one checks and generates each function,
+// and writes its code right away (the code of the functions before
+// a semantic error has already been written)
+static int compileStreaming(const char *fileName, int optLevel, bool shortCircuit) {
+  std::ifstream stream(fileName);
+  if (not stream) {
+    std::cout << "No such file: " << fileName << std::endl;
+    return EXIT_FAILURE;
+  }
+  TypesMgr  types;
+  SymTable  symbols(types);
+  SemErrors errors;
+  symbols.pushNewScope(SymTable::GLOBAL_SCOPE_NAME);
+
+  // first pass: the signatures of the functions
+  FunctionReader reader(stream);
+  std::size_t numFunctions = 0;
+  bool syntaxErrors = false;
+  for (FunctionReader::Function func; reader.next(func); ++numFunctions) {
+    ParsedFunction function(func, std::cerr);
+    if (function.hasErrors()) {
+      syntaxErrors = true;
+      continue;
+    }
+    TreeDecoration decorations;
+    SymbolsVisitor symboldecl(types, symbols, decorations, errors,
+                              SymbolsVisitor::DeclareFunctions);
+    symboldecl.visit(function.tree);
+  }
+  if (syntaxErrors or numFunctions == 0) {
+    std::cout << "Lexical and/or syntactical errors have been found." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (symbols.noMainProperlyDeclared())
+    errors.noMainProperlyDeclared(reader.getLine(), reader.getColumn());
+
+  // second pass: each function is checked, generated, optimized and
+  // written, and then its tree and local symbols are dropped
+  stream.clear();
+  stream.seekg(0);
+  FunctionReader secondReader(stream);
+  Optimizer optimizer(optLevel);
+  for (FunctionReader::Function func; secondReader.next(func); ) {
+    ParsedFunction function(func, std::cerr);
+    TreeDecoration decorations;
+    SymbolsVisitor symboldecl(types, symbols, decorations, errors,
+                              SymbolsVisitor::DeclareLocals);
+    symboldecl.visit(function.tree);
+    TypeCheckVisitor typecheck(types, symbols, decorations, errors);
+    typecheck.visit(function.tree);
+    if (errors.getNumberOfSemanticErrors() == 0) {
+      CodeGenVisitor codegenerator(types, symbols, decorations, 1, shortCircuit);
+      subroutine subr = codegenerator.visit(function.tree);
+      code mycode;
+      mycode.add_subroutine(subr);
+      optimizer.run(mycode);
+      dumpTCode(mycode, std::cout);
+    }
+    symbols.clearScope(decorations.getScope(function.tree));
+  }
   if (errors.getNumberOfSemanticErrors() > 0) {
-    std::cout << "There are semantic errors: no code generated." << std::endl;
+    errors.print();
+    std::cout << "There are semantic errors: no more code generated." << std::endl;
     return EXIT_FAILURE;
   }
+  std::cout << std::endl;
+  return EXIT_SUCCESS;
+}
 
-  // create a third visitor that will return the generated code
-  // for each part of the tree, and will store it in 'mycode'
-  CodeGenVisitor codegenerator(types, symbols, decorations);
-  code mycode = codegenerator.visit(tree);
+// server mode (--serve <socket>): the compiler waits for requests on
+// a Unix socket, so that each one does not pay for a new process and
+// the prediction DFA of the parser (shared by all the parsers of the
+// process) is already built. A request is what the client writes
+// until it shuts down its side of the connection:
+//   <options>\n<size>\n<program (size bytes)><input of the program>
+// where the options are -O0, -O1, -O2, --short-circuit and --run (the
+// program is executed with the interpreter, instead of printing its
+// t-code). The answer is
+//   <status> <size of errors> <size of out> <size of crash>\n<errors><out><crash>
+// with the exit status, and what the compiler would have written: on
+// std::cerr the syntax errors (before the rest) and the message of a
+// halted program (after its output), and on std::cout the rest. The
+// requests are served by a fixed number of workers (-j), each one
+// with a compilation (types, symbols, decorations) of its own: a
+// program that never ends keeps its worker busy, but not the others
+
+// everything that can be read from 'fd'
+static bool readAll(int fd, std::string & data) {
+  char buf[1 << 16];
+  for (;;) {
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n == 0) return true;
+    if (n < 0 and errno != EINTR) return false;
+    if (n > 0) data.append(buf, n);
+  }
+}
+
+// write all of 'data' to 'fd' (with no SIGPIPE if the other side has
+// gone away)
+static bool writeAll(int fd, const std::string & data) {
+  for (std::size_t done = 0; done < data.size(); ) {
+    ssize_t n = send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+    if (n < 0 and errno != EINTR) return false;
+    if (n > 0) done += n;
+  }
+  return true;
+}
+
+// the address of the Unix socket 'socketName' (false if the name is too long)
+static bool socketAddress(const char *socketName, sockaddr_un & addr) {
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (std::strlen(socketName) >= sizeof(addr.sun_path)) return false;
+  std::strcpy(addr.sun_path, socketName);
+  return true;
+}
+
+// answer one request of a client, and close the connection
+static void serveRequest(int fd) {
+  std::string request;
+  std::ostringstream out, err, crash;
+  int status = EXIT_FAILURE;
+  std::size_t optionsEnd = std::string::npos, sizeEnd = std::string::npos;
+  if (readAll(fd, request)) {
+    optionsEnd = request.find('\n');
+    if (optionsEnd != std::string::npos) sizeEnd = request.find('\n', optionsEnd+1);
+  }
+  std::size_t programSize = 0;
+  if (sizeEnd != std::string::npos)
+    programSize = std::strtoul(request.c_str() + optionsEnd + 1, nullptr, 10);
+  if (sizeEnd == std::string::npos or programSize > request.size() - sizeEnd - 1)
+    out << "Invalid request." << std::endl;
+  else {
+    int optLevel = 0;
+    bool shortCircuit = false, runCode = false, validOptions = true;
+    std::istringstream options(request.substr(0, optionsEnd));
+    for (std::string arg; options >> arg; ) {
+      if (arg == "-O0" or arg == "-O1" or arg == "-O2")
+        optLevel = arg[2] - '0';
+      else if (arg == "--short-circuit")
+        shortCircuit = true;
+      else if (arg == "--run")
+        runCode = true;
+      else
+        validOptions = false;
+    }
+    if (not validOptions)
+      out << "Invalid options: " << request.substr(0, optionsEnd) << std::endl;
+    else {
+      antlr4::ANTLRInputStream input(request.substr(sizeEnd + 1, programSize));
+      Compilation comp(out, err);
+      if (compile(input, optLevel, shortCircuit, 1, comp)) {
+        if (runCode) {
+          Interpreter interpreter(comp.mycode);
+          if (interpreter.hasErrors())
+            out << "Invalid t-code: " << interpreter.getErrorMessage() << std::endl;
+          else {
+            std::istringstream in(request.substr(sizeEnd + 1 + programSize));
+            status = interpreter.run(in, out, crash);
+          }
+        }
+        else {
+          dumpTCode(comp.mycode, out);
+          out << std::endl;
+          status = EXIT_SUCCESS;
+        }
+      }
+    }
+  }
+  std::string errText = err.str(), outText = out.str(), crashText = crash.str();
+  writeAll(fd, std::to_string(status) + " " + std::to_string(errText.size()) + " " +
+               std::to_string(outText.size()) + " " + std::to_string(crashText.size()) + "\n" +
+               errText + outText + crashText);
+  close(fd);
+}
+
+// name of the socket of the server, removed when it is stopped
+static char servedSocketName[sizeof(sockaddr_un::sun_path)];
+
+static void stopServer(int) {
+  unlink(servedSocketName);
+  _exit(EXIT_SUCCESS);
+}
+
+static int serve(const char *socketName, unsigned workers) {
+  sockaddr_un addr;
+  if (not socketAddress(socketName, addr)) {
+    std::cout << "Socket name too long: " << socketName << std::endl;
+    return EXIT_FAILURE;
+  }
+  // (the socket left by a server that has been killed)
+  struct stat st;
+  if (stat(socketName, &st) == 0 and S_ISSOCK(st.st_mode))
+    unlink(socketName);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 or bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 or
+      listen(fd, SOMAXCONN) != 0) {
+    std::cout << "Cannot listen on " << socketName << ": " << std::strerror(errno) << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::strcpy(servedSocketName, socketName);
+  std::signal(SIGINT, stopServer);
+  std::signal(SIGTERM, stopServer);
+  std::cout << "Serving on " << socketName << std::endl;
+  // every worker takes the next connection (until accept fails)
+  std::atomic<int> acceptError{0};
+  auto worker = [&]() {
+    while (acceptError == 0) {
+      int client = accept(fd, nullptr, nullptr);
+      if (client >= 0)
+        serveRequest(client);
+      else if (errno != EINTR and errno != ECONNABORTED)
+        acceptError = errno;
+    }
+  };
+  std::vector<std::thread> threads;
+  for (unsigned t = 1; t < workers; ++t)
+    threads.emplace_back(worker);
+  worker();
+  std::cout << "Cannot accept connections: " << std::strerror(acceptError) << std::endl;
+  unlink(socketName);
+  // (the other workers may be serving a program that does not end)
+  _exit(EXIT_FAILURE);
+}
+
+// client of the server mode (--connect <socket>): send the program in
+// <file> (or std::cin) and, with --run, its input (all of std::cin),
+// and write the answer as if the program had been compiled here
+static int connectToServer(const char *socketName, const std::string & options,
+                           const char *fileName, bool runCode) {
+  std::string program, input;
+  if (fileName) {
+    std::ifstream stream(fileName);
+    if (not stream) {
+      std::cout << "No such file: " << fileName << std::endl;
+      return EXIT_FAILURE;
+    }
+    program.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    if (runCode)
+      input.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+  }
+  else
+    program.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+
+  sockaddr_un addr;
+  int fd = -1;
+  if (socketAddress(socketName, addr))
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  std::string answer;
+  if (fd < 0 or connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 or
+      not writeAll(fd, options + "\n" + std::to_string(program.size()) + "\n" + program + input) or
+      shutdown(fd, SHUT_WR) != 0 or not readAll(fd, answer)) {
+    std::cout << "Cannot connect to " << socketName << ": " << std::strerror(errno) << std::endl;
+    if (fd >= 0) close(fd);
+    return EXIT_FAILURE;
+  }
+  close(fd);
+  std::istringstream header(answer.substr(0, answer.find('\n')));
+  int status;
+  std::size_t errSize, outSize, crashSize;
+  std::size_t start = answer.find('\n') + 1;
+  if (not (header >> status >> errSize >> outSize >> crashSize) or start == 0 or
+      start + errSize + outSize + crashSize != answer.size()) {
+    std::cout << "Invalid answer from " << socketName << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cerr << answer.substr(start, errSize) << std::flush;
+  std::cout << answer.substr(start + errSize, outSize) << std::flush;
+  std::cerr << answer.substr(start + errSize + outSize, crashSize) << std::flush;
+  return status;
+}
+
+int main(int argc, const char* argv[]) {
+  // check the correct use of the program
+  //   -O0, -O1, -O2:     optimization level of the generated code (see Optimizer)
+  //   --short-circuit:   evaluate the right operand of "and"/"or" only if
+  //                      the left one does not decide the result
+  //   --run:             execute the generated code instead of printing it
+  //   --jit:             execute it compiled to native code in memory (with
+  //                      the interpreter if there is no LLVM translation)
+  //   --emit-bin <file>: write the generated code in binary t-code format
+  //   --run-bin <file>:  execute a binary t-code file (no compilation)
+  //   --emit=ll:         write the LLVM code of the program to a .ll file
+  //   --emit=obj|exe:    compile the LLVM code to an object file or an
+  //                      executable (-O also selects the LLVM passes)
+  //   -o <file>:         name of the file written by --emit
+  //   -j <jobs>:         threads of the batch mode (several files), or
+  //                      of the code generation of one file (all the
+  //                      cores by default), or workers of --serve
+  //   --stream:          compile and print the code one function at a
+  //                      time (for very large files)
+  //   --cache <dir>:     keep the code of each function in <dir>, and
+  //                      only compile the functions that have changed
+  //   --serve <socket>:  wait for compilations (and runs) on a Unix socket
+  //   --connect <socket>: compile (or run) the program in the server
+  //   --stats[=json]:    write the time and memory of each phase of the
+  //                      compilation, and some counters, on std::cerr
+  //   --profile:         execute the generated code with the interpreter and
+  //                      write its profile on std::cerr: calls and time of
+  //                      the subroutines, iterations of the loops, and the
+  //                      instructions executed by source line and by opcode
+  //   --profile=flamegraph: the same profile as folded stacks, the input
+  //                      of flamegraph.pl
+  // the standard streams keep their own buffers (not the ones of
+  // stdio): the interpreter reads and writes straight from them
+  std::ios::sync_with_stdio(false);
+  bool runCode = false;
+  std::string statsFormat;
+  std::string profileFormat;
+  bool streamCode = false;
+  bool jitCode = false;
+  int optLevel = 0;
+  bool shortCircuit = false;
+  std::vector<const char *> fileNames;
+  const char *emitBinFileName = nullptr;
+  const char *runBinFileName = nullptr;
+  std::string emitKind;
+  const char *outFileName = nullptr;
+  const char *cacheDirectory = nullptr;
+  const char *serveSocket = nullptr;
+  const char *connectSocket = nullptr;
+  unsigned jobs = std::thread::hardware_concurrency();
+  bool jobsGiven = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--run")
+      runCode = true;
+    else if (arg == "--jit")
+      jitCode = true;
+    else if (arg == "--stream")
+      streamCode = true;
+    else if (arg == "--stats" or arg == "--stats=json")
+      statsFormat = arg == "--stats" ? "text" : "json";
+    else if (arg == "--profile" or arg == "--profile=flamegraph")
+      profileFormat = arg == "--profile" ? "text" : "flamegraph";
+    else if (arg == "-O0" or arg == "-O1" or arg == "-O2")
+      optLevel = arg[2] - '0';
+    else if (arg == "--short-circuit")
+      shortCircuit = true;
+    else if (arg == "--emit-bin" and i+1 < argc)
+      emitBinFileName = argv[++i];
+    else if (arg == "--run-bin" and i+1 < argc)
+      runBinFileName = argv[++i];
+    else if (arg == "--emit=ll" or arg == "--emit=obj" or arg == "--emit=exe")
+      emitKind = arg.substr(7);
+    else if (arg == "-o" and i+1 < argc)
+      outFileName = argv[++i];
+    else if (arg == "--cache" and i+1 < argc)
+      cacheDirectory = argv[++i];
+    else if (arg == "--serve" and i+1 < argc)
+      serveSocket = argv[++i];
+    else if (arg == "--connect" and i+1 < argc)
+      connectSocket = argv[++i];
+    else if (arg == "-j" and i+1 < argc and std::atoi(argv[i+1]) > 0)
+      jobs = std::atoi(argv[++i]), jobsGiven = true;
+    else if (arg[0] != '-')
+      fileNames.push_back(argv[i]);
+    else {
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+  bool batch = fileNames.size() > 1;
+  if ((runBinFileName and (not fileNames.empty() or runCode or emitBinFileName or not emitKind.empty())) or
+      (runCode and emitBinFileName) or
+      (not emitKind.empty() and (runCode or emitBinFileName)) or
+      (outFileName and emitKind.empty()) or
+      (jitCode and (runBinFileName or runCode or emitBinFileName or not emitKind.empty())) or
+      (batch and (runCode or jitCode or emitBinFileName or outFileName or cacheDirectory)) or
+      (not statsFormat.empty() and (batch or streamCode or runBinFileName)) or
+      (not profileFormat.empty() and (batch or streamCode or runCode or jitCode or
+                                      emitBinFileName or not emitKind.empty())) or
+      (streamCode and (fileNames.size() != 1 or runCode or jitCode or emitBinFileName or
+                       runBinFileName or not emitKind.empty() or cacheDirectory)) or
+      (runBinFileName and cacheDirectory) or
+      (serveSocket and argc != (jobsGiven ? 5 : 3)) or
+      (connectSocket and (fileNames.size() > 1 or jitCode or emitBinFileName or runBinFileName or
+                          not emitKind.empty() or not statsFormat.empty() or
+                          not profileFormat.empty() or streamCode or cacheDirectory))) {
+    usage();
+    return EXIT_FAILURE;
+  }
+  const char *fileName = fileNames.empty() ? nullptr : fileNames[0];
+
+  if (serveSocket)
+    return serve(serveSocket, jobs > 0 ? jobs : 1);
+
+  if (connectSocket) {
+    std::string options = "-O" + std::to_string(optLevel);
+    if (shortCircuit) options += " --short-circuit";
+    if (runCode) options += " --run";
+    return connectToServer(connectSocket, options, fileName, runCode);
+  }
+
+  // execute a binary t-code file, reading the program input from std::cin
+  if (runBinFileName) {
+    Interpreter interpreter{std::string(runBinFileName)};
+    if (interpreter.hasErrors()) {
+      std::cout << interpreter.getErrorMessage() << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (not profileFormat.empty())
+      return runProfiled(interpreter, profileFormat);
+    return interpreter.run(std::cin, std::cout);
+  }
+
+  if ((emitKind == "obj" or emitKind == "exe") and not NativeBackend::isAvailable()) {
+    std::cout << "--emit=" << emitKind << " needs a compiler built with LLVM (make WITH_LLVM=1)" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (batch)
+    return compileBatch(fileNames, optLevel, shortCircuit, emitKind, jobs > 0 ? jobs : 1);
+
+  if (streamCode)
+    return compileStreaming(fileName, optLevel, shortCircuit);
+
+  if (fileName and not std::fopen(fileName, "r")) {
+    std::cout << "No such file: " << fileName << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // the messages to std::cout, and the syntax errors to std::cerr (as
+  // ANTLR does)
+  Compilation comp(std::cout, std::cerr);
+  auto printStats = [&]() {
+    if (statsFormat == "text")
+      comp.stats.print(std::cerr);
+    else if (statsFormat == "json")
+      comp.stats.printJSON(std::cerr);
+  };
+
+  // compile <file> (or std::cin) with the code of the functions in the cache
+  if (cacheDirectory) {
+    CompilationCache cache(cacheDirectory);
+    std::ifstream stream;
+    if (fileName) stream.open(fileName);
+    if (not compileCached(fileName ? stream : std::cin, optLevel, shortCircuit, cache, comp)) {
+      printStats();
+      return EXIT_FAILURE;
+    }
+  }
+  else {
+    // open input file (or std::cin) and create a character stream
+    antlr4::ANTLRInputStream input;
+    if (fileName) {   // read from <file>
+      std::ifstream stream;
+      stream.open(fileName);
+      input = antlr4::ANTLRInputStream(stream);
+    }
+    else {            // read fron std::cin
+      input = antlr4::ANTLRInputStream(std::cin);
+    }
+
+    comp.stats.endPhase("input");
+
+    // compile it
+    if (not compile(input, optLevel, shortCircuit, jobs > 0 ? jobs : 1, comp)) {
+      printStats();
+      return EXIT_FAILURE;
+    }
+  }
+  code & mycode = comp.mycode;
+
+  // execute the generated code compiled by the JIT, or go back to the
+  // interpreter if it has no LLVM translation (or there is no JIT)
+  if (jitCode) {
+    std::string llvmStr, llvmErrors;
+    if (mycode.dumpLLVM(comp.types, comp.symbols, llvmStr, llvmErrors)) {
+      JIT jit(llvmStr, optLevel);
+      comp.stats.endPhase("jit");
+      if (not jit.hasErrors()) {
+        printStats();
+        return jit.run();
+      }
+      llvmErrors = jit.getErrorMessage();
+    }
+    std::cerr << "--jit: " << llvmErrors.substr(0, llvmErrors.find('\n'))
+              << "; running the t-code interpreter" << std::endl;
+    runCode = true;
+  }
+
+  // execute the generated code (reading the program input from std::cin)
+  if (runCode or not profileFormat.empty()) {
+    Interpreter interpreter(mycode);
+    comp.stats.endPhase("interpreter");
+    printStats();
+    if (interpreter.hasErrors()) {
+      std::cout << "Invalid t-code: " << interpreter.getErrorMessage() << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (not profileFormat.empty())
+      return runProfiled(interpreter, profileFormat);
+    return interpreter.run(std::cin, std::cout);
+  }
+
+  // write the generated code in binary t-code format
+  if (emitBinFileName) {
+    std::ofstream binFile(emitBinFileName, std::ofstream::out | std::ofstream::binary);
+    if (not binFile or not mycode.dumpBinary(binFile)) {
+      std::cout << "Cannot write binary t-code to " << emitBinFileName << std::endl;
+      return EXIT_FAILURE;
+    }
+    comp.stats.endPhase("output");
+    printStats();
+    return EXIT_SUCCESS;
+  }
+
+  // write the LLVM code of the program, or compile it to native code
+  if (not emitKind.empty()) {
+    const std::string suffix = emitKind == "ll" ? ".ll" : emitKind == "obj" ? ".o" : "";
+    bool ok = emitLLVM(comp, emitKind,
+                       outFileName ? outFileName : outputFileName(fileName, suffix), optLevel);
+    comp.stats.endPhase("output");
+    printStats();
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
 
   // print generated code as output
-  std::cout << mycode.dump() << std::endl;
-
-  // uncomment the following lines to generate LLVM code
-  // and write it to a .ll file
-  // std::string llvmStr = mycode.dumpLLVM(types, symbols);
-  // std::string llvmFileName;
-  // if (argc == 2) { // read from <file>
-  //   std::string inputFileName = std::string(argv[1]);
-  //   std::size_t slashPos = inputFileName.rfind("/");
-  //   std::size_t dotPos   = inputFileName.rfind(".");
-  //   llvmFileName = inputFileName.substr(slashPos+1, dotPos-slashPos-1) + ".ll";
-  // }
-  // else {           // read fron std::cin
-  //   llvmFileName = "output.ll";
-  // }
-  // std::ofstream myLLVMFile(llvmFileName, std::ofstream::out);
-  // myLLVMFile << llvmStr << std::endl;
+  dumpTCode(mycode, std::cout);
+  std::cout << std::endl;
+  comp.stats.endPhase("output");
+  printStats();
 
   return EXIT_SUCCESS;
 }
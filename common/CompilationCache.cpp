@@ -0,0 +1,339 @@
+/////////////////////////////////////////////////////////////////
+//
+//    CompilationCache - code of the unchanged functions for the Asl programming language
+//
+//    Copyright (C) 2017-2023  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include "CompilationCache.h"
+
+#include <fstream>
+#include <set>
+
+#include <cstdio>     // std::snprintf, std::rename, std::remove
+#include <sys/stat.h> // mkdir
+#include <unistd.h>   // getpid
+
+// using namespace std;
+
+
+////////////////////////////////////////////////////////////////////
+// Binary format of the entries
+
+namespace {
+
+  // longest string read back (a corrupt length must not allocate
+  // the memory of the machine)
+  const std::uint32_t MaxString = 1u << 28;
+
+  void writeU32(std::ostream & os, std::uint32_t n) {
+    os.write(reinterpret_cast<const char *>(&n), sizeof(n));
+  }
+
+  bool readU32(std::istream & is, std::uint32_t & n) {
+    return bool(is.read(reinterpret_cast<char *>(&n), sizeof(n)));
+  }
+
+  void writeString(std::ostream & os, const std::string & s) {
+    writeU32(os, s.size());
+    os.write(s.data(), s.size());
+  }
+
+  bool readString(std::istream & is, std::string & s) {
+    std::uint32_t n;
+    if (not readU32(is, n) or n > MaxString) return false;
+    s.resize(n);
+    return n == 0 or bool(is.read(&s[0], n));
+  }
+
+  void writeSymbols(std::ostream & os, const CompilationCache::SymbolList & symbols) {
+    writeU32(os, symbols.size());
+    for (const auto & s : symbols) {
+      writeString(os, s.first);
+      writeString(os, s.second);
+    }
+  }
+
+  bool readSymbols(std::istream & is, CompilationCache::SymbolList & symbols) {
+    std::uint32_t n;
+    if (not readU32(is, n)) return false;
+    symbols.clear();
+    for (std::uint32_t i = 0; i < n; ++i) {
+      std::pair<std::string, std::string> s;
+      if (not readString(is, s.first) or not readString(is, s.second)) return false;
+      symbols.push_back(s);
+    }
+    return true;
+  }
+
+  void writeVars(std::ostream & os, const std::list<var> & vars) {
+    writeU32(os, vars.size());
+    for (const auto & v : vars) {
+      writeString(os, v.name);
+      writeString(os, v.type);
+      writeU32(os, v.nelem);
+    }
+  }
+
+  bool readVars(std::istream & is, std::list<var> & vars) {
+    std::uint32_t n, nelem;
+    if (not readU32(is, n)) return false;
+    vars.clear();
+    for (std::uint32_t i = 0; i < n; ++i) {
+      std::string name, type;
+      if (not readString(is, name) or not readString(is, type) or
+          not readU32(is, nelem))
+        return false;
+      vars.push_back(var(name, type, nelem));
+    }
+    return true;
+  }
+
+  // the kind, and the value or the text (the interned indices of the
+  // names only make sense in this process). A char constant is
+  // written as in the t-code
+  void writeOperand(std::ostream & os, const operand & op) {
+    writeU32(os, op.kind());
+    switch (op.kind()) {
+    case operand::NONE:  break;
+    case operand::TEMP:  writeU32(os, op.id()); break;
+    case operand::INT:   writeU32(os, std::uint32_t(op.intValue())); break;
+    case operand::FLOAT: {
+      float f = op.floatValue();
+      os.write(reinterpret_cast<const char *>(&f), sizeof(f));
+      break;
+    }
+    case operand::CHAR:  writeString(os, op.dump()); break;
+    default:             writeString(os, op.name()); break;
+    }
+  }
+
+  bool readOperand(std::istream & is, operand & op) {
+    std::uint32_t kind, n;
+    std::string text;
+    if (not readU32(is, kind)) return false;
+    switch (kind) {
+    case operand::NONE:
+      op = operand();
+      return true;
+    case operand::TEMP:
+      if (not readU32(is, n)) return false;
+      op = operand::temporal(n);
+      return true;
+    case operand::INT:
+      if (not readU32(is, n)) return false;
+      op = operand::intConst(std::int32_t(n));
+      return true;
+    case operand::FLOAT: {
+      float f;
+      if (not is.read(reinterpret_cast<char *>(&f), sizeof(f))) return false;
+      op = operand::floatConst(f);
+      return true;
+    }
+    case operand::CHAR:
+    case operand::VAR:
+    case operand::LABEL:
+    case operand::FUNC:
+    case operand::STRING:
+      if (not readString(is, text)) return false;
+      op = kind == operand::CHAR  ? operand::charConst(text) :
+           kind == operand::VAR   ? operand::variable(text) :
+           kind == operand::LABEL ? operand::label(text) :
+           kind == operand::FUNC  ? operand::function(text) : operand::stringConst(text);
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  void writeSubroutine(std::ostream & os, const subroutine & subr) {
+    writeString(os, subr.get_name());
+    writeVars(os, subr.params);
+    writeVars(os, subr.vars);
+    const instructionList & lins = subr.get_instructions();
+    writeU32(os, lins.size());
+    for (const auto & instr : lins) {
+      writeU32(os, instr.oper);
+      writeU32(os, instr.line);
+      writeOperand(os, instr.arg1);
+      writeOperand(os, instr.arg2);
+      writeOperand(os, instr.arg3);
+    }
+  }
+
+  bool readSubroutine(std::istream & is, subroutine & subr) {
+    std::string name;
+    if (not readString(is, name)) return false;
+    subr = subroutine(name);
+    if (not readVars(is, subr.params) or not readVars(is, subr.vars)) return false;
+    std::uint32_t n, oper, line;
+    if (not readU32(is, n)) return false;
+    instructionList lins;
+    for (std::uint32_t i = 0; i < n; ++i) {
+      operand a1, a2, a3;
+      if (not readU32(is, oper) or oper >= instruction::_INVALID or
+          not readU32(is, line) or
+          not readOperand(is, a1) or not readOperand(is, a2) or not readOperand(is, a3))
+        return false;
+      lins.push_back(instruction(instruction::Operation(oper), a1, a2, a3));
+      lins.back().line = line;
+    }
+    subr.set_instructions(std::move(lins));
+    return true;
+  }
+
+}  // namespace
+
+
+////////////////////////////////////////////////////////////////////
+// Class CompilationCache
+
+// (a new one when the format or the generated code change)
+const std::uint32_t CompilationCache::Version = 1;
+
+CompilationCache::Entry::Entry() : line(0), subr("") {
+}
+
+CompilationCache::CompilationCache(const std::string & directory) : Directory(directory) {
+  mkdir(Directory.c_str(), 0777);   // (it may exist)
+}
+
+// FNV-1a hash of the text and the options, as 16 hex digits
+std::string CompilationCache::key(const std::string & text, bool shortCircuit) {
+  std::uint64_t h = 14695981039346656037ull;
+  auto add = [&](unsigned char c) {
+    h ^= c;
+    h *= 1099511628211ull;
+  };
+  for (char c : text) add(c);
+  add(shortCircuit ? 1 : 0);
+  char buf[17];
+  std::snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)h);
+  return buf;
+}
+
+std::string CompilationCache::path(const std::string & key) const {
+  return Directory + "/" + key + ".fn";
+}
+
+bool CompilationCache::load(const std::string & key, const std::string & text,
+                            Entry & entry) const {
+  std::ifstream is(path(key), std::ifstream::in | std::ifstream::binary);
+  char magic[4];
+  std::uint32_t version, line;
+  if (not is.read(magic, 4) or std::string(magic, 4) != "ASLC" or
+      not readU32(is, version) or version != Version or
+      not readString(is, entry.text) or entry.text != text or
+      not readU32(is, line) or not readString(is, entry.type) or
+      not readSymbols(is, entry.callees) or not readSymbols(is, entry.params) or
+      not readSymbols(is, entry.vars) or not readSubroutine(is, entry.subr))
+    return false;
+  entry.line = line;
+  return is.peek() == EOF;
+}
+
+// written to a file of its own and renamed, so that a compilation
+// that reads it at the same time sees all of it or nothing
+bool CompilationCache::store(const std::string & key, const Entry & entry) const {
+  std::string fileName = path(key);
+  std::string tmpFileName = fileName + "." + std::to_string(getpid()) + ".tmp";
+  {
+    std::ofstream os(tmpFileName, std::ofstream::out | std::ofstream::binary);
+    os.write("ASLC", 4);
+    writeU32(os, Version);
+    writeString(os, entry.text);
+    writeU32(os, entry.line);
+    writeString(os, entry.type);
+    writeSymbols(os, entry.callees);
+    writeSymbols(os, entry.params);
+    writeSymbols(os, entry.vars);
+    writeSubroutine(os, entry.subr);
+    if (not os.flush()) {
+      os.close();
+      std::remove(tmpFileName.c_str());
+      return false;
+    }
+  }
+  if (std::rename(tmpFileName.c_str(), fileName.c_str()) != 0) {
+    std::remove(tmpFileName.c_str());
+    return false;
+  }
+  return true;
+}
+
+CompilationCache::Entry CompilationCache::makeEntry(const std::string & text, std::size_t line,
+                                                    const subroutine & subr,
+                                                    const TypesMgr & Types,
+                                                    const SymTable & Symbols) {
+  Entry entry;
+  entry.text = text;
+  entry.line = line;
+  const std::string & name = subr.get_name();
+  entry.type = Types.to_string(Symbols.getGlobalFunctionType(name));
+  std::set<std::string> callees;
+  for (const auto & instr : subr.get_instructions())
+    if (instr.oper == instruction::_CALL and callees.insert(instr.arg1.name()).second)
+      entry.callees.push_back({instr.arg1.name(),
+                               Types.to_string(Symbols.getGlobalFunctionType(instr.arg1.name()))});
+  for (const auto & p : subr.params)
+    if (p.name != "_result")
+      entry.params.push_back({p.name, Types.to_string(Symbols.getLocalSymbolType(name, p.name))});
+  for (const auto & v : subr.vars)
+    entry.vars.push_back({v.name, Types.to_string(Symbols.getLocalSymbolType(name, v.name))});
+  entry.subr = subr;
+  return entry;
+}
+
+bool CompilationCache::usable(const Entry & entry, const TypesMgr & Types,
+                              const SymTable & Symbols) {
+  for (const auto & callee : entry.callees)
+    if (not Symbols.isFunctionClass(callee.first) or
+        Types.to_string(Symbols.getType(callee.first)) != callee.second)
+      return false;
+  return true;
+}
+
+void CompilationCache::declareFunction(const Entry & entry, TypesMgr & Types, SymTable & Symbols) {
+  Symbols.addFunction(entry.subr.get_name(), Types.from_string(entry.type));
+}
+
+void CompilationCache::declareLocals(const Entry & entry, TypesMgr & Types, SymTable & Symbols) {
+  Symbols.pushNewScope(entry.subr.get_name());
+  for (const auto & p : entry.params)
+    Symbols.addParameter(p.first, Types.from_string(p.second));
+  for (const auto & v : entry.vars)
+    Symbols.addLocalVar(v.first, Types.from_string(v.second));
+  Symbols.popScope();
+}
+
+subroutine CompilationCache::codeAt(const Entry & entry, std::size_t line) {
+  subroutine subr = entry.subr;
+  if (line == entry.line) return subr;
+  instructionList lins = subr.get_instructions();
+  for (auto & instr : lins)
+    if (instr.line != 0)
+      instr.line += line - entry.line;
+  subr.set_instructions(std::move(lins));
+  return subr;
+}
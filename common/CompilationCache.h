@@ -0,0 +1,120 @@
+/////////////////////////////////////////////////////////////////
+//
+//    CompilationCache - code of the unchanged functions for the Asl programming language
+//
+//    Copyright (C) 2017-2023  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+#include "TypesMgr.h"
+#include "SymTable.h"
+
+#include <string>
+#include <vector>
+#include <utility>    // std::pair
+
+#include <cstddef>    // std::size_t
+#include <cstdint>    // std::uint32_t
+
+// using namespace std;
+
+
+////////////////////////////////////////////////////////////////////
+/// Class CompilationCache keeps on disk the code generated for each
+/// function of a program (--cache <dir>), so that a new compilation
+/// only checks and generates the functions that have changed.
+///
+/// The entry of a function is a file named after the hash of its text
+/// (and of the options that change its code), and it has the text
+/// itself, to tell a collision from a hit. It also has what the
+/// function takes from the rest of the program: the types of the
+/// functions it calls, which must not have changed for the entry to
+/// be used. The code is the one of the code generator, before the
+/// optimizations (which look at several functions), and its lines are
+/// moved to where the function is now.
+///
+/// Entry (integers are 32 bits in host byte order, strings are their
+/// length and their characters, types are written by to_string):
+///   "ASLC" | version | text | line | type | ncallees | (name type)[ncallees] |
+///   nparams | (name type)[nparams] | nvars | (name type)[nvars] | subroutine
+/// where the subroutine is its name, params, vars (name, type, nelem)
+/// and instructions (operation, line and three operands).
+
+class CompilationCache {
+
+ public:
+  /// names and types of symbols
+  typedef std::vector<std::pair<std::string, std::string>> SymbolList;
+
+  /// what is kept of a function
+  struct Entry {
+    std::string text;        // as read by FunctionReader
+    std::size_t line;        // first line of the text
+    std::string type;        // type of the function
+    SymbolList  callees;     // functions it calls
+    SymbolList  params;      // its symbols (for the LLVM code)
+    SymbolList  vars;
+    subroutine  subr;        // generated code (not optimized)
+
+    Entry();
+  };
+
+  /// constructor: the entries are in 'directory' (created if needed)
+  CompilationCache(const std::string & directory);
+
+  /// name of the entry of a function
+  static std::string key(const std::string & text, bool shortCircuit);
+
+  /// read the entry 'key' of the function 'text' (false if there is no
+  /// valid one)
+  bool load(const std::string & key, const std::string & text, Entry & entry) const;
+  /// write the entry (false if it cannot be written: the cache is only
+  /// a shortcut, and the compilation goes on)
+  bool store(const std::string & key, const Entry & entry) const;
+
+  /// the entry of a function that has been checked and generated,
+  /// with the types of its symbols and callees in 'Symbols'
+  static Entry makeEntry(const std::string & text, std::size_t line,
+                         const subroutine & subr,
+                         const TypesMgr & Types, const SymTable & Symbols);
+
+  /// true if every function the entry calls is declared with the same type
+  static bool usable(const Entry & entry, const TypesMgr & Types, const SymTable & Symbols);
+  /// declare the function in the current scope, and its symbols in a
+  /// new scope (as SymbolsVisitor does)
+  static void declareFunction(const Entry & entry, TypesMgr & Types, SymTable & Symbols);
+  static void declareLocals(const Entry & entry, TypesMgr & Types, SymTable & Symbols);
+
+  /// the code of the entry for the function at 'line'
+  static subroutine codeAt(const Entry & entry, std::size_t line);
+
+ private:
+  static const std::uint32_t Version;
+
+  std::string Directory;
+
+  std::string path(const std::string & key) const;
+};
@@ -0,0 +1,112 @@
+/////////////////////////////////////////////////////////////////
+//
+//    CompilerStats - time, memory and counters of the Asl compiler
+//
+//    Copyright (C) 2017-2023  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include "CompilerStats.h"
+
+#include <string>
+#include <iostream>
+#include <iomanip>    // std::setw, std::setprecision
+#include <chrono>
+
+#include <cstddef>    // std::size_t
+#include <sys/resource.h>   // getrusage
+
+// using namespace std;
+
+
+CompilerStats::CompilerStats() :
+  PhaseStart{Clock::now()} {
+}
+
+void CompilerStats::endPhase(const std::string & phase) {
+  Clock::time_point now = Clock::now();
+  double ms = std::chrono::duration<double, std::milli>(now - PhaseStart).count();
+  Phases.push_back({phase, ms, peakMemory()});
+  PhaseStart = now;
+}
+
+void CompilerStats::setCounter(const std::string & name, std::size_t value) {
+  for (auto & counter : Counters) {
+    if (counter.first == name) {
+      counter.second = value;
+      return;
+    }
+  }
+  Counters.push_back({name, value});
+}
+
+void CompilerStats::setInstructions(const std::string & function, std::size_t count) {
+  Instructions.push_back({function, count});
+}
+
+// the phases with their time and memory, the total, the counters and
+// the instructions of the functions (in source order)
+void CompilerStats::print(std::ostream & os) const {
+  std::ios::fmtflags flags = os.flags();
+  std::streamsize precision = os.precision();
+  double total = 0;
+  os << "phase               time (ms)   peak memory (KB)" << std::endl;
+  for (auto & phase : Phases) {
+    os << std::left << std::setw(18) << phase.name << std::right
+       << std::setw(11) << std::fixed << std::setprecision(3) << phase.milliseconds
+       << std::setw(19) << phase.peakKB << std::endl;
+    total += phase.milliseconds;
+  }
+  os << std::left << std::setw(18) << "total" << std::right
+     << std::setw(11) << total << std::setw(19) << peakMemory() << std::endl;
+  os.flags(flags);
+  os.precision(precision);
+  for (auto & counter : Counters)
+    os << counter.first << ": " << counter.second << std::endl;
+  for (auto & function : Instructions)
+    os << "instructions of " << function.first << ": " << function.second << std::endl;
+}
+
+void CompilerStats::printJSON(std::ostream & os) const {
+  double total = 0;
+  os << "{\"phases\": [";
+  for (std::size_t i = 0; i < Phases.size(); ++i) {
+    os << (i ? ", " : "") << "{\"name\": \"" << Phases[i].name << "\", \"ms\": "
+       << Phases[i].milliseconds << ", \"peak_kb\": " << Phases[i].peakKB << "}";
+    total += Phases[i].milliseconds;
+  }
+  os << "], \"total_ms\": " << total << ", \"peak_kb\": " << peakMemory();
+  for (auto & counter : Counters)
+    os << ", \"" << counter.first << "\": " << counter.second;
+  os << ", \"function_instructions\": {";
+  for (std::size_t i = 0; i < Instructions.size(); ++i)
+    os << (i ? ", " : "") << "\"" << Instructions[i].first << "\": " << Instructions[i].second;
+  os << "}}" << std::endl;
+}
+
+std::size_t CompilerStats::peakMemory() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+  return usage.ru_maxrss;     // (KB on Linux)
+}
@@ -0,0 +1,87 @@
+/////////////////////////////////////////////////////////////////
+//
+//    CompilerStats - time, memory and counters of the Asl compiler
+//
+//    Copyright (C) 2017-2023  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>    // std::pair
+#include <chrono>
+#include <iostream>
+
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+////////////////////////////////////////////////////////////////////
+/// Class CompilerStats collects the wall time and the peak resident
+/// memory of each phase of a compilation (lexing, parsing, semantic
+/// analysis, code generation, optimization and output), and some counters
+/// (tokens, parse tree nodes, symbols, types, instructions of each
+/// function), to print them as text or as JSON (--stats).
+///
+/// The peak memory of a phase is the peak of the process at its end
+/// (getrusage), so it only grows from one phase to the next: a phase
+/// that needs more memory than the previous ones shows up as a jump.
+
+class CompilerStats {
+
+ public:
+  /// constructor: the time starts now
+  CompilerStats();
+
+  /// end the current phase (the one started by the previous call, or
+  /// by the constructor) and start the next one, named 'phase'
+  void endPhase(const std::string & phase);
+
+  /// value of a counter (they are printed in this order)
+  void setCounter(const std::string & name, std::size_t value);
+  /// instructions of one function (after the optimizations)
+  void setInstructions(const std::string & function, std::size_t count);
+
+  /// print as lines of text, or as a JSON object
+  void print     (std::ostream & os = std::cerr) const;
+  void printJSON (std::ostream & os = std::cerr) const;
+
+  /// peak resident memory of the process, in KB
+  static std::size_t peakMemory();
+
+ private:
+  struct Phase {
+    std::string name;
+    double      milliseconds;
+    std::size_t peakKB;
+  };
+  typedef std::chrono::steady_clock Clock;
+
+  std::vector<Phase>                               Phases;
+  std::vector<std::pair<std::string, std::size_t>> Counters;
+  std::vector<std::pair<std::string, std::size_t>> Instructions;
+  Clock::time_point                                PhaseStart;
+};
@@ -0,0 +1,753 @@
+/////////////////////////////////////////////////////////////////
+//
+//    ControlFlow - control flow analysis of t-code for the Asl programming language
+//
+//    Copyright (C) 2017-2023  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include "ControlFlow.h"
+
+#include <map>
+#include <algorithm>  // std::find, std::reverse, std::binary_search, std::stable_sort
+#include <utility>    // std::pair, std::move
+#include <cstdint>    // std::uint32_t, std::int32_t, INT32_MAX
+
+// using namespace std;
+
+
+////////////////////////////////////////////////////////////////////
+// Operands of an instruction
+
+operand * definedOperand(instruction & instr) {
+  switch (instr.oper) {
+  case instruction::_ADD:  case instruction::_SUB:  case instruction::_MUL:
+  case instruction::_DIV:  case instruction::_EQ:   case instruction::_LT:
+  case instruction::_LE:   case instruction::_AND:  case instruction::_OR:
+  case instruction::_FADD: case instruction::_FSUB: case instruction::_FMUL:
+  case instruction::_FDIV: case instruction::_FEQ:  case instruction::_FLT:
+  case instruction::_FLE:  case instruction::_NOT:  case instruction::_NEG:
+  case instruction::_FNEG: case instruction::_FLOAT:
+  case instruction::_LOAD: case instruction::_ILOAD: case instruction::_CHLOAD:
+  case instruction::_FLOAD: case instruction::_LOADX: case instruction::_ALOAD:
+  case instruction::_LOADC: case instruction::_READI: case instruction::_READF:
+  case instruction::_READC:
+    return &instr.arg1;
+  case instruction::_POP:
+    return instr.arg1.isNone() ? nullptr : &instr.arg1;
+  default:
+    return nullptr;
+  }
+}
+
+std::vector<operand *> usedOperands(instruction & instr, bool arrays) {
+  std::vector<operand *> uses;
+  switch (instr.oper) {
+  case instruction::_ADD:  case instruction::_SUB:  case instruction::_MUL:
+  case instruction::_DIV:  case instruction::_EQ:   case instruction::_LT:
+  case instruction::_LE:   case instruction::_AND:  case instruction::_OR:
+  case instruction::_FADD: case instruction::_FSUB: case instruction::_FMUL:
+  case instruction::_FDIV: case instruction::_FEQ:  case instruction::_FLT:
+  case instruction::_FLE:
+    uses.push_back(&instr.arg2);
+    uses.push_back(&instr.arg3);
+    break;
+  case instruction::_NOT:  case instruction::_NEG:  case instruction::_FNEG:
+  case instruction::_FLOAT: case instruction::_LOADC: case instruction::_LOAD:
+    uses.push_back(&instr.arg2);
+    break;
+  case instruction::_LOADX:
+    if (arrays) uses.push_back(&instr.arg2);
+    uses.push_back(&instr.arg3);
+    break;
+  case instruction::_XLOAD:
+    if (arrays) uses.push_back(&instr.arg1);
+    uses.push_back(&instr.arg2);
+    uses.push_back(&instr.arg3);
+    break;
+  case instruction::_ALOAD:
+    if (arrays) uses.push_back(&instr.arg2);
+    break;
+  case instruction::_ACOPY:
+    if (arrays) {
+      uses.push_back(&instr.arg1);
+      uses.push_back(&instr.arg2);
+    }
+    uses.push_back(&instr.arg3);
+    break;
+  case instruction::_AFILL:
+    if (arrays) uses.push_back(&instr.arg1);
+    uses.push_back(&instr.arg2);
+    uses.push_back(&instr.arg3);
+    break;
+  case instruction::_CLOAD:
+    uses.push_back(&instr.arg1);
+    uses.push_back(&instr.arg2);
+    break;
+  case instruction::_FJUMP: case instruction::_PUSH:
+  case instruction::_WRITEI: case instruction::_WRITEF: case instruction::_WRITEC:
+    uses.push_back(&instr.arg1);
+    break;
+  default:
+    break;
+  }
+  std::vector<operand *> names;
+  for (operand * op : uses)
+    if (op->isTemp() or op->isVar()) names.push_back(op);
+  return names;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Calls
+
+bool isTailCall(const instructionList & lins, std::size_t pc) {
+  if (pc >= lins.size() or lins[pc].oper != instruction::_CALL) return false;
+  std::size_t i = pc + 1;
+  while (i < lins.size() and lins[i].oper == instruction::_POP) ++i;
+  if (i > pc + 1 and not lins[i-1].arg1.isNone()) {
+    // the result: "POP _result", or "POP %r" and "_result = %r"
+    const operand & result = lins[i-1].arg1;
+    const operand returned = operand::variable("_result");
+    if (result != returned) {
+      if (i == lins.size() or lins[i].oper != instruction::_LOAD or
+          lins[i].arg1 != returned or lins[i].arg2 != result)
+        return false;
+      ++i;
+    }
+  }
+  while (i < lins.size() and lins[i].oper == instruction::_LABEL) ++i;
+  return i < lins.size() and lins[i].oper == instruction::_RETURN;
+}
+
+bool callArguments(const instructionList & lins, std::size_t pc, std::size_t n,
+                   std::vector<std::size_t> & pushes) {
+  pushes.assign(n, 0);
+  unsigned nested = 0;
+  for (std::size_t i = pc; n > 0 and i-- > 0; ) {
+    if (lins[i].oper == instruction::_POP) ++nested;
+    else if (lins[i].oper == instruction::_PUSH) {
+      if (nested > 0) --nested;
+      else pushes[--n] = i;
+    }
+  }
+  return n == 0;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Class ControlFlowGraph
+
+const std::size_t ControlFlowGraph::NoBlock = static_cast<std::size_t>(-1);
+
+ControlFlowGraph::ControlFlowGraph(const subroutine & subr) {
+  buildBlocks(subr.get_instructions());
+  computeReversePostorder();
+  computeDominators();
+  computeDominanceFrontiers();
+}
+
+std::size_t ControlFlowGraph::getNumberOfBlocks() const {
+  return Blocks.size();
+}
+
+const ControlFlowGraph::BasicBlock & ControlFlowGraph::getBlock(std::size_t b) const {
+  return Blocks[b];
+}
+
+std::size_t ControlFlowGraph::getBlockOf(std::size_t pc) const {
+  return BlockOfPc[pc];
+}
+
+const std::vector<std::size_t> & ControlFlowGraph::getReversePostorder() const {
+  return RPO;
+}
+
+bool ControlFlowGraph::isReachable(std::size_t b) const {
+  return RPOIndex[b] != NoBlock;
+}
+
+std::size_t ControlFlowGraph::getImmediateDominator(std::size_t b) const {
+  return IDom[b];
+}
+
+const std::vector<std::size_t> & ControlFlowGraph::getDominatedBlocks(std::size_t b) const {
+  return DomChildren[b];
+}
+
+bool ControlFlowGraph::dominates(std::size_t a, std::size_t b) const {
+  if (not isReachable(a) or not isReachable(b)) return false;
+  while (b != NoBlock) {
+    if (a == b) return true;
+    b = IDom[b];
+  }
+  return false;
+}
+
+const std::vector<std::size_t> & ControlFlowGraph::getDominanceFrontier(std::size_t b) const {
+  return Frontier[b];
+}
+
+void ControlFlowGraph::buildBlocks(const instructionList & lins) {
+  std::size_t n = lins.size();
+  BlockOfPc.assign(n, 0);
+  std::map<operand, std::size_t> labelBlock;
+  for (std::size_t i = 0; i < n; ++i) {
+    bool leader = (i == 0 or lins[i].oper == instruction::_LABEL);
+    if (i > 0) {
+      instruction::Operation prev = lins[i-1].oper;
+      if (prev == instruction::_UJUMP or prev == instruction::_FJUMP or
+          prev == instruction::_RETURN or prev == instruction::_HALT)
+        leader = true;
+    }
+    if (leader) {
+      if (not Blocks.empty()) Blocks.back().last = i;
+      Blocks.push_back(BasicBlock{i, n, {}, {}});
+    }
+    BlockOfPc[i] = Blocks.size() - 1;
+    if (lins[i].oper == instruction::_LABEL)
+      labelBlock[lins[i].arg1] = Blocks.size() - 1;
+  }
+  std::size_t nb = Blocks.size();
+  for (std::size_t b = 0; b < nb; ++b) {
+    std::vector<std::size_t> & succs = Blocks[b].succs;
+    const instruction & last = lins[Blocks[b].last - 1];
+    bool fallsThrough = (last.oper != instruction::_UJUMP and
+                         last.oper != instruction::_RETURN and
+                         last.oper != instruction::_HALT);
+    if (fallsThrough and b + 1 < nb)
+      succs.push_back(b + 1);
+    if (last.oper == instruction::_UJUMP or last.oper == instruction::_FJUMP) {
+      const operand & label = (last.oper == instruction::_UJUMP ? last.arg1 : last.arg2);
+      auto it = labelBlock.find(label);
+      if (it != labelBlock.end() and
+          std::find(succs.begin(), succs.end(), it->second) == succs.end())
+        succs.push_back(it->second);
+    }
+    for (std::size_t s : succs)
+      Blocks[s].preds.push_back(b);
+  }
+}
+
+void ControlFlowGraph::computeReversePostorder() {
+  std::size_t nb = Blocks.size();
+  RPOIndex.assign(nb, NoBlock);
+  RPO.clear();
+  if (nb == 0) return;
+  // iterative depth-first search: (block, next successor to visit)
+  std::vector<bool> visited(nb, false);
+  std::vector<std::pair<std::size_t, std::size_t>> stack;
+  stack.push_back(std::make_pair(0, 0));
+  visited[0] = true;
+  while (not stack.empty()) {
+    std::size_t b = stack.back().first;
+    std::size_t & next = stack.back().second;
+    if (next < Blocks[b].succs.size()) {
+      std::size_t s = Blocks[b].succs[next++];
+      if (not visited[s]) {
+        visited[s] = true;
+        stack.push_back(std::make_pair(s, 0));
+      }
+    }
+    else {
+      RPO.push_back(b);
+      stack.pop_back();
+    }
+  }
+  std::reverse(RPO.begin(), RPO.end());
+  for (std::size_t i = 0; i < RPO.size(); ++i)
+    RPOIndex[RPO[i]] = i;
+}
+
+void ControlFlowGraph::computeDominators() {
+  std::size_t nb = Blocks.size();
+  IDom.assign(nb, NoBlock);
+  DomChildren.assign(nb, std::vector<std::size_t>());
+  if (nb == 0) return;
+  IDom[0] = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (std::size_t i = 1; i < RPO.size(); ++i) {
+      std::size_t b = RPO[i];
+      std::size_t newIDom = NoBlock;
+      for (std::size_t p : Blocks[b].preds) {
+        if (IDom[p] == NoBlock) continue;      // unreachable or not processed yet
+        if (newIDom == NoBlock) { newIDom = p; continue; }
+        // intersect the two paths up the (partial) dominator tree
+        std::size_t f1 = p, f2 = newIDom;
+        while (f1 != f2) {
+          while (RPOIndex[f1] > RPOIndex[f2]) f1 = IDom[f1];
+          while (RPOIndex[f2] > RPOIndex[f1]) f2 = IDom[f2];
+        }
+        newIDom = f1;
+      }
+      if (IDom[b] != newIDom) {
+        IDom[b] = newIDom;
+        changed = true;
+      }
+    }
+  }
+  IDom[0] = NoBlock;
+  for (std::size_t i = 1; i < RPO.size(); ++i)
+    DomChildren[IDom[RPO[i]]].push_back(RPO[i]);
+}
+
+void ControlFlowGraph::computeDominanceFrontiers() {
+  std::size_t nb = Blocks.size();
+  Frontier.assign(nb, std::vector<std::size_t>());
+  for (std::size_t b : RPO) {
+    if (Blocks[b].preds.size() < 2) continue;
+    for (std::size_t p : Blocks[b].preds) {
+      if (not isReachable(p)) continue;
+      std::size_t runner = p;
+      while (runner != IDom[b]) {
+        std::vector<std::size_t> & df = Frontier[runner];
+        if (std::find(df.begin(), df.end(), b) == df.end())
+          df.push_back(b);
+        runner = IDom[runner];
+      }
+    }
+  }
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Class SSAForm
+
+SSAForm::SSAForm(const subroutine & subr, const ControlFlowGraph & cfg)
+  : CFG{cfg}, Instructions(subr.get_instructions()),
+    Phis(cfg.getNumberOfBlocks())
+{
+  std::uint32_t maxTemp = 0;
+  for (auto & instr : Instructions) {
+    if (instr.arg1.isTemp()) maxTemp = std::max(maxTemp, instr.arg1.id());
+    if (instr.arg2.isTemp()) maxTemp = std::max(maxTemp, instr.arg2.id());
+    if (instr.arg3.isTemp()) maxTemp = std::max(maxTemp, instr.arg3.id());
+  }
+  FirstVersion = maxTemp + 1;
+  placePhis(subr);
+  rename();
+}
+
+const instructionList & SSAForm::getInstructions() const {
+  return Instructions;
+}
+
+const std::vector<SSAForm::Phi> & SSAForm::getPhis(std::size_t b) const {
+  return Phis[b];
+}
+
+void SSAForm::placePhis(const subroutine & subr) {
+  std::size_t nb = CFG.getNumberOfBlocks();
+  const std::vector<std::size_t> & rpo = CFG.getReversePostorder();
+  // temporals used before being defined (upward exposed) and defined
+  // in each block
+  std::vector<std::set<operand>> upUses(nb), defs(nb);
+  std::map<operand, std::vector<std::size_t>> defBlocks;
+  for (std::size_t b : rpo) {
+    const ControlFlowGraph::BasicBlock & block = CFG.getBlock(b);
+    for (std::size_t pc = block.first; pc < block.last; ++pc) {
+      instruction & instr = Instructions[pc];
+      for (operand * op : usedOperands(instr, true))
+        if (op->isTemp() and defs[b].count(*op) == 0)
+          upUses[b].insert(*op);
+      operand * def = definedOperand(instr);
+      if (def and def->isTemp() and defs[b].insert(*def).second)
+        defBlocks[*def].push_back(b);
+    }
+  }
+  // live temporals at the beginning of each block
+  std::vector<std::set<operand>> liveIn(upUses);
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto it = rpo.rbegin(); it != rpo.rend(); ++it) {
+      std::size_t b = *it;
+      for (std::size_t s : CFG.getBlock(b).succs)
+        for (const operand & t : liveIn[s])
+          if (defs[b].count(t) == 0 and liveIn[b].insert(t).second)
+            changed = true;
+    }
+  }
+  // a phi node in the iterated dominance frontier of the definitions
+  for (auto & pair : defBlocks) {
+    const operand & temp = pair.first;
+    std::vector<std::size_t> work(pair.second);
+    std::set<std::size_t> hasPhi, inWork(work.begin(), work.end());
+    while (not work.empty()) {
+      std::size_t d = work.back();
+      work.pop_back();
+      for (std::size_t f : CFG.getDominanceFrontier(d)) {
+        if (hasPhi.count(f) or liveIn[f].count(temp) == 0) continue;
+        hasPhi.insert(f);
+        Phi phi;
+        phi.temp = temp;
+        phi.args.assign(CFG.getBlock(f).preds.size(), operand());
+        Phis[f].push_back(std::move(phi));
+        if (inWork.insert(f).second) work.push_back(f);
+      }
+    }
+  }
+}
+
+void SSAForm::rename() {
+  if (CFG.getNumberOfBlocks() == 0) return;
+  std::uint32_t nextTemp = FirstVersion;
+  // current temporal of each original one, along the dominator tree
+  std::map<operand, std::vector<operand>> current;
+  // (block, entered) pairs: a block is visited on entry and on exit
+  std::vector<std::pair<std::size_t, bool>> stack;
+  std::vector<std::vector<operand>> pushed(CFG.getNumberOfBlocks());
+  stack.push_back(std::make_pair(0, false));
+  while (not stack.empty()) {
+    std::size_t b = stack.back().first;
+    bool entered = stack.back().second;
+    stack.pop_back();
+    if (entered) {
+      for (const operand & t : pushed[b])
+        current[t].pop_back();
+      continue;
+    }
+    stack.push_back(std::make_pair(b, true));
+    for (Phi & phi : Phis[b]) {
+      phi.dest = operand::temporal(nextTemp++);
+      Origin[phi.dest] = phi.temp;
+      current[phi.temp].push_back(phi.dest);
+      pushed[b].push_back(phi.temp);
+    }
+    const ControlFlowGraph::BasicBlock & block = CFG.getBlock(b);
+    for (std::size_t pc = block.first; pc < block.last; ++pc) {
+      instruction & instr = Instructions[pc];
+      for (operand * op : usedOperands(instr, true)) {
+        if (not op->isTemp()) continue;
+        auto it = current.find(*op);
+        if (it != current.end() and not it->second.empty())
+          *op = it->second.back();
+      }
+      operand * def = definedOperand(instr);
+      if (def and def->isTemp()) {
+        operand temp = *def;
+        *def = operand::temporal(nextTemp++);
+        Origin[*def] = temp;
+        current[temp].push_back(*def);
+        pushed[b].push_back(temp);
+      }
+    }
+    for (std::size_t s : block.succs) {
+      const std::vector<std::size_t> & preds = CFG.getBlock(s).preds;
+      std::size_t j = std::find(preds.begin(), preds.end(), b) - preds.begin();
+      for (Phi & phi : Phis[s]) {
+        auto it = current.find(phi.temp);
+        if (it != current.end() and not it->second.empty())
+          phi.args[j] = it->second.back();
+      }
+    }
+    for (std::size_t c : CFG.getDominatedBlocks(b))
+      stack.push_back(std::make_pair(c, false));
+  }
+}
+
+void SSAForm::toTCode(subroutine & subr, std::set<operand> & multiplyDefined) const {
+  // join the temporals of each phi node (union-find)
+  std::map<operand, operand> parent;
+  auto find = [&parent](operand t) {
+    auto it = parent.find(t);
+    while (it != parent.end() and it->second != t) {
+      t = it->second;
+      it = parent.find(t);
+    }
+    return t;
+  };
+  for (auto & blockPhis : Phis) {
+    for (const Phi & phi : blockPhis) {
+      for (const operand & arg : phi.args) {
+        if (arg.isNone()) continue;
+        operand r1 = find(phi.dest), r2 = find(arg);
+        if (r1 != r2) parent[std::max(r1, r2)] = std::min(r1, r2);
+      }
+    }
+  }
+  // the first group of versions of each temporal takes its name back
+  // (unless it is still used, where no definition reaches)
+  std::map<operand, operand> name;
+  std::set<operand> taken;
+  for (auto & instr : Instructions) {
+    const operand * args[3] = { &instr.arg1, &instr.arg2, &instr.arg3 };
+    for (const operand * op : args)
+      if (op->isTemp() and op->id() < FirstVersion) taken.insert(*op);
+  }
+  auto rename = [&](operand & t) {
+    if (not t.isTemp() or t.id() < FirstVersion) return;
+    operand root = find(t);
+    auto it = name.find(root);
+    if (it == name.end()) {
+      operand orig = Origin.at(root);
+      it = name.insert(std::make_pair(root, taken.insert(orig).second ? orig : root)).first;
+    }
+    t = it->second;
+  };
+  instructionList lins(Instructions);
+  std::map<operand, int> numDefs;
+  for (auto & instr : lins) {
+    for (operand * op : usedOperands(instr, true))
+      rename(*op);
+    operand * def = definedOperand(instr);
+    if (def and def->isTemp()) {
+      rename(*def);
+      numDefs[*def] += 1;
+    }
+  }
+  multiplyDefined.clear();
+  for (auto & pair : numDefs)
+    if (pair.second > 1) multiplyDefined.insert(pair.first);
+  subr.set_instructions(std::move(lins));
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Class LoopInfo
+
+const std::size_t LoopInfo::NoLoop = static_cast<std::size_t>(-1);
+
+LoopInfo::LoopInfo(const ControlFlowGraph & cfg)
+  : LoopOf(cfg.getNumberOfBlocks(), NoLoop)
+{
+  std::map<std::size_t, Loop> byHeader;
+  for (std::size_t b : cfg.getReversePostorder())
+    for (std::size_t h : cfg.getBlock(b).succs)
+      if (cfg.dominates(h, b)) {
+        Loop & loop = byHeader[h];
+        loop.header = h;
+        loop.latches.push_back(b);
+      }
+  for (auto & pair : byHeader) {
+    Loop & loop = pair.second;
+    std::vector<bool> inLoop(cfg.getNumberOfBlocks(), false);
+    inLoop[loop.header] = true;
+    std::vector<std::size_t> work;
+    for (std::size_t b : loop.latches)
+      if (not inLoop[b]) { inLoop[b] = true; work.push_back(b); }
+    while (not work.empty()) {
+      std::size_t b = work.back();
+      work.pop_back();
+      for (std::size_t p : cfg.getBlock(b).preds)
+        if (cfg.isReachable(p) and not inLoop[p]) { inLoop[p] = true; work.push_back(p); }
+    }
+    for (std::size_t b = 0; b < inLoop.size(); ++b)
+      if (inLoop[b]) loop.blocks.push_back(b);
+    Loops.push_back(loop);
+  }
+  std::stable_sort(Loops.begin(), Loops.end(), [](const Loop & x, const Loop & y) {
+      return x.blocks.size() < y.blocks.size();
+    });
+  for (std::size_t l = Loops.size(); l-- > 0; )
+    for (std::size_t b : Loops[l].blocks)
+      LoopOf[b] = l;
+}
+
+std::size_t LoopInfo::getNumberOfLoops() const {
+  return Loops.size();
+}
+
+const LoopInfo::Loop & LoopInfo::getLoop(std::size_t l) const {
+  return Loops[l];
+}
+
+bool LoopInfo::contains(std::size_t l, std::size_t b) const {
+  return std::binary_search(Loops[l].blocks.begin(), Loops[l].blocks.end(), b);
+}
+
+std::size_t LoopInfo::getLoopOf(std::size_t b) const {
+  return LoopOf[b];
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Array accesses
+
+namespace {
+
+  // bounds of a counter and of its increases in one iteration: below
+  // them it cannot wrap around before a comparison stops it
+  const std::int32_t MaxBound = 1 << 30;
+  const std::int32_t MaxStep = 1 << 20;
+
+  // the definitions of every temporal and variable of the subroutine
+  typedef std::map<operand, std::vector<std::size_t>> DefinitionMap;
+
+  // value of an int constant, or of a name only defined as one
+  bool intConstant(const operand & op, const instructionList & lins,
+                   const DefinitionMap & defs, std::int32_t & k) {
+    if (op.kind() == operand::INT) { k = op.intValue(); return true; }
+    DefinitionMap::const_iterator it = defs.find(op);
+    if (not op.isTemp() or it == defs.end() or it->second.size() != 1) return false;
+    const instruction & def = lins[it->second[0]];
+    if ((def.oper != instruction::_ILOAD and def.oper != instruction::_LOAD) or
+        def.arg2.kind() != operand::INT)
+      return false;
+    k = def.arg2.intValue();
+    return true;
+  }
+
+  // the increase of 'counter' at the definition (counter = counter + k,
+  // directly or through a temporal only defined there), or -1
+  std::int32_t stepOf(const instruction & def, const operand & counter,
+                      const instructionList & lins, const DefinitionMap & defs) {
+    const instruction * add = &def;
+    if (def.oper == instruction::_LOAD and def.arg2.isTemp()) {
+      DefinitionMap::const_iterator it = defs.find(def.arg2);
+      if (it == defs.end() or it->second.size() != 1) return -1;
+      add = &lins[it->second[0]];
+    }
+    if (add->oper != instruction::_ADD) return -1;
+    std::int32_t k;
+    if (add->arg2 == counter and intConstant(add->arg3, lins, defs, k)) return k;
+    if (add->arg3 == counter and intConstant(add->arg2, lins, defs, k)) return k;
+    return -1;
+  }
+
+  // the bound 'n' of "counter < n" checked at the header of the loop
+  // before going on in the loop, if no definition of the counter follows
+  bool headerBound(const operand & counter, const LoopInfo::Loop & loop,
+                   instructionList & lins, const DefinitionMap & defs,
+                   const ControlFlowGraph & cfg, const LoopInfo & loops,
+                   std::size_t l, std::int32_t & n) {
+    const ControlFlowGraph::BasicBlock & header = cfg.getBlock(loop.header);
+    const instruction & jump = lins[header.last - 1];
+    if (jump.oper != instruction::_FJUMP or header.succs.size() != 2 or
+        not loops.contains(l, header.succs[0]) or loops.contains(l, header.succs[1]))
+      return false;
+    for (std::size_t pc = header.last - 1; pc-- > header.first; ) {
+      const instruction & instr = lins[pc];
+      operand * d = definedOperand(lins[pc]);
+      if (d == nullptr) continue;
+      if (*d == counter) return false;
+      if (*d != jump.arg1) continue;
+      std::int32_t k;
+      if ((instr.oper != instruction::_LT and instr.oper != instruction::_LE) or
+          instr.arg2 != counter or not intConstant(instr.arg3, lins, defs, k) or
+          (instr.oper == instruction::_LE and k == INT32_MAX))
+        return false;
+      n = (instr.oper == instruction::_LT ? k : k + 1);
+      return true;
+    }
+    return false;
+  }
+
+  // true if 'counter' stays non-negative: it is only defined as a
+  // non-negative constant, or increased by one in the loops that
+  // compare it with a bound at their header (and whose innermost loop
+  // is the one of the increase, so it runs once per iteration)
+  bool isCounter(const operand & counter, instructionList & lins, const DefinitionMap & defs,
+                 const ControlFlowGraph & cfg, const LoopInfo & loops) {
+    DefinitionMap::const_iterator it = defs.find(counter);
+    if (it == defs.end()) return false;
+    std::map<std::size_t, std::int32_t> stepsOfLoop;
+    for (std::size_t pc : it->second) {
+      const instruction & def = lins[pc];
+      std::int32_t k, n;
+      if ((def.oper == instruction::_ILOAD or def.oper == instruction::_LOAD) and
+          intConstant(def.arg2, lins, defs, k) and k >= 0)
+        continue;
+      std::int32_t step = stepOf(def, counter, lins, defs);
+      std::size_t l = loops.getLoopOf(cfg.getBlockOf(pc));
+      if (step < 0 or step > MaxStep or l == LoopInfo::NoLoop or
+          not headerBound(counter, loops.getLoop(l), lins, defs, cfg, loops, l, n) or
+          n > MaxBound or (stepsOfLoop[l] += step) > MaxStep)
+        return false;
+    }
+    return true;
+  }
+
+  // true if a definition of 'name' can be executed between the header
+  // of the loop and the instruction at 'pc' (inside the loop)
+  bool definedSinceHeader(const operand & name, std::size_t pc, const LoopInfo::Loop & loop,
+                          instructionList & lins, const ControlFlowGraph & cfg) {
+    auto definesName = [&](std::size_t first, std::size_t last) {
+      for (std::size_t i = first; i < last; ++i) {
+        operand * d = definedOperand(lins[i]);
+        if (d and *d == name) return true;
+      }
+      return false;
+    };
+    std::size_t b = cfg.getBlockOf(pc);
+    if (b == loop.header or definesName(cfg.getBlock(b).first, pc)) return true;
+    std::vector<bool> visited(cfg.getNumberOfBlocks(), false);
+    std::vector<std::size_t> work(1, b);
+    while (not work.empty()) {
+      std::size_t x = work.back();
+      work.pop_back();
+      for (std::size_t p : cfg.getBlock(x).preds) {
+        if (p == loop.header or visited[p] or not cfg.isReachable(p)) continue;
+        visited[p] = true;
+        if (not std::binary_search(loop.blocks.begin(), loop.blocks.end(), p) or
+            definesName(cfg.getBlock(p).first, cfg.getBlock(p).last))
+          return true;
+        work.push_back(p);
+      }
+    }
+    return false;
+  }
+
+}  // namespace
+
+std::vector<bool> inBoundsAccesses(const subroutine & subr) {
+  instructionList lins = subr.get_instructions();
+  std::vector<bool> inBounds(lins.size(), false);
+  ControlFlowGraph cfg(subr);
+  LoopInfo loops(cfg);
+  if (loops.getNumberOfLoops() == 0) return inBounds;
+  // sizes of the local arrays, and definitions of every name
+  std::map<operand, std::int32_t> sizes;
+  for (auto & v : subr.vars)
+    sizes[operand::variable(v.name)] = std::int32_t(v.nelem);
+  DefinitionMap defs;
+  for (std::size_t pc = 0; pc < lins.size(); ++pc) {
+    operand * d = definedOperand(lins[pc]);
+    if (d) defs[*d].push_back(pc);
+  }
+  for (std::size_t pc = 0; pc < lins.size(); ++pc) {
+    const instruction & instr = lins[pc];
+    if (instr.oper != instruction::_LOADX and instr.oper != instruction::_XLOAD) continue;
+    std::size_t b = cfg.getBlockOf(pc);
+    if (loops.getLoopOf(b) == LoopInfo::NoLoop) continue;
+    const operand & array = (instr.oper == instruction::_LOADX ? instr.arg2 : instr.arg1);
+    const operand & index = (instr.oper == instruction::_LOADX ? instr.arg3 : instr.arg2);
+    // the counter is a local: params come with any value
+    if (sizes.count(array) == 0 or not (index.isTemp() or sizes.count(index)) or
+        not isCounter(index, lins, defs, cfg, loops))
+      continue;
+    for (std::size_t l = loops.getLoopOf(b); l < loops.getNumberOfLoops(); ++l) {
+      std::int32_t n;
+      if (not loops.contains(l, b) or
+          not headerBound(index, loops.getLoop(l), lins, defs, cfg, loops, l, n) or
+          n > sizes[array] or
+          definedSinceHeader(index, pc, loops.getLoop(l), lins, cfg))
+        continue;
+      inBounds[pc] = true;
+      break;
+    }
+  }
+  return inBounds;
+}
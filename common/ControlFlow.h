@@ -0,0 +1,233 @@
+/////////////////////////////////////////////////////////////////
+//
+//    ControlFlow - control flow analysis of t-code for the Asl programming language
+//
+//    Copyright (C) 2017-2023  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+
+#include <vector>
+#include <set>
+#include <map>
+
+#include <cstddef>    // std::size_t
+#include <cstdint>    // std::uint32_t
+
+// using namespace std;
+
+
+////////////////////////////////////////////////////////////////////
+/// Operands of an instruction
+
+/// operand written by the instruction (nullptr if none)
+operand * definedOperand(instruction & instr);
+
+/// operands (temporals and variables) read by the instruction. The
+/// array operands of XLOAD, LOADX, ALOAD, ACOPY and AFILL are only included if
+/// 'arrays' is true: they must stay a name or a temporal of the
+/// array kind they are declared with
+std::vector<operand *> usedOperands(instruction & instr, bool arrays);
+
+
+////////////////////////////////////////////////////////////////////
+/// Calls
+
+/// true if the instruction at 'pc' is a CALL in tail position: it is
+/// followed by the POPs of its arguments, the copy of its result (if
+/// any) to _result, and RETURN (maybe after some labels)
+bool isTailCall(const instructionList & lins, std::size_t pc);
+
+/// positions of the PUSHes of the 'n' arguments of the CALL at 'pc'
+/// (the calls in the code of the arguments pop what they push)
+bool callArguments(const instructionList & lins, std::size_t pc, std::size_t n,
+                   std::vector<std::size_t> & pushes);
+
+
+////////////////////////////////////////////////////////////////////
+/// Class ControlFlowGraph splits the instructions of a subroutine in
+/// basic blocks and computes its dominator tree.
+///
+/// A block starts at the first instruction, at every LABEL and after
+/// every UJUMP, FJUMP, RETURN and HALT. Block 0 is the entry block.
+/// Dominators are computed with the iterative algorithm of Cooper,
+/// Harvey and Kennedy over the reverse postorder of the blocks.
+/// Unreachable blocks have no dominator and are not in the
+/// reverse postorder.
+
+class ControlFlowGraph {
+
+ public:
+  /// "no block" (the dominator of the entry and of unreachable blocks)
+  static const std::size_t NoBlock;
+
+  /// the instructions [first, last) of the subroutine, and the
+  /// indices of the blocks that go to and come from this one
+  struct BasicBlock {
+    std::size_t              first;
+    std::size_t              last;
+    std::vector<std::size_t> succs;
+    std::vector<std::size_t> preds;
+  };
+
+  /// constructor: the graph of the current instructions of 'subr'
+  ControlFlowGraph(const subroutine & subr);
+
+  std::size_t getNumberOfBlocks() const;
+  const BasicBlock & getBlock(std::size_t b) const;
+  /// block of the instruction at position 'pc'
+  std::size_t getBlockOf(std::size_t pc) const;
+
+  /// reachable blocks in reverse postorder (the entry first)
+  const std::vector<std::size_t> & getReversePostorder() const;
+  bool isReachable(std::size_t b) const;
+
+  /// immediate dominator of the block (NoBlock for the entry)
+  std::size_t getImmediateDominator(std::size_t b) const;
+  /// blocks immediately dominated by 'b'
+  const std::vector<std::size_t> & getDominatedBlocks(std::size_t b) const;
+  /// true if every path from the entry to 'b' goes through 'a'
+  bool dominates(std::size_t a, std::size_t b) const;
+  /// blocks where the dominance of 'b' ends
+  const std::vector<std::size_t> & getDominanceFrontier(std::size_t b) const;
+
+ private:
+  std::vector<BasicBlock>               Blocks;
+  std::vector<std::size_t>              BlockOfPc;
+  std::vector<std::size_t>              RPO;
+  std::vector<std::size_t>              RPOIndex;   // NoBlock if unreachable
+  std::vector<std::size_t>              IDom;
+  std::vector<std::vector<std::size_t>> DomChildren;
+  std::vector<std::vector<std::size_t>> Frontier;
+
+  void buildBlocks(const instructionList & lins);
+  void computeReversePostorder();
+  void computeDominators();
+  void computeDominanceFrontiers();
+};
+
+
+////////////////////////////////////////////////////////////////////
+/// Class SSAForm renames the temporals of a subroutine so that each
+/// one is defined by a single instruction or phi node. Variables and
+/// parameters are memory (they can be arrays or be passed by
+/// reference) and keep their names.
+///
+/// Phi nodes are only placed where the temporal is live (pruned SSA).
+/// Every definition gets a new temporal, numbered after the last
+/// temporal of the subroutine; a use that no definition reaches
+/// keeps the original temporal. Unreachable blocks are not renamed.
+/// Back in t-code, a temporal that was already assigned once keeps
+/// its name.
+
+class SSAForm {
+
+ public:
+  /// phi node at the beginning of a block: 'dest' is the new temporal
+  /// for 'temp', and args[i] the one coming from the i-th predecessor
+  /// of the block (none if 'temp' is undefined on that path)
+  struct Phi {
+    operand              temp;
+    operand              dest;
+    std::vector<operand> args;
+  };
+
+  /// constructor: the SSA form of 'subr' with graph 'cfg'
+  SSAForm(const subroutine & subr, const ControlFlowGraph & cfg);
+
+  /// the instructions with the temporals renamed (in the same order,
+  /// so the blocks of 'cfg' still apply)
+  const instructionList & getInstructions() const;
+  /// the phi nodes at the beginning of block 'b'
+  const std::vector<Phi> & getPhis(std::size_t b) const;
+
+  /// back to t-code: replace the instructions of 'subr' with the
+  /// renamed ones, where the temporals joined by a phi node take the
+  /// same name. 'multiplyDefined' gets the temporals that are
+  /// still assigned more than once
+  void toTCode(subroutine & subr, std::set<operand> & multiplyDefined) const;
+
+ private:
+  const ControlFlowGraph &      CFG;
+  instructionList               Instructions;
+  std::vector<std::vector<Phi>> Phis;
+  std::uint32_t                 FirstVersion;   // the first new temporal
+  std::map<operand, operand>    Origin;         // new temporal -> original one
+
+  void placePhis(const subroutine & subr);
+  void rename();
+};
+
+
+////////////////////////////////////////////////////////////////////
+/// Class LoopInfo finds the natural loops of a control flow graph.
+/// An edge from a block to one that dominates it is a back edge: its
+/// target is the header of a loop, made of the blocks that reach the
+/// back edge without going through the header. The back edges to the
+/// same header make a single loop.
+
+class LoopInfo {
+
+ public:
+  /// "no loop" (the loop of the blocks that are in none)
+  static const std::size_t NoLoop;
+
+  /// the header, the sources of its back edges and all the blocks of
+  /// the loop (the header included), in increasing order
+  struct Loop {
+    std::size_t              header;
+    std::vector<std::size_t> latches;
+    std::vector<std::size_t> blocks;
+  };
+
+  /// constructor: the loops of 'cfg'
+  LoopInfo(const ControlFlowGraph & cfg);
+
+  /// loops from the smallest to the largest, so a loop comes before
+  /// the loops that contain it
+  std::size_t getNumberOfLoops() const;
+  const Loop & getLoop(std::size_t l) const;
+  bool contains(std::size_t l, std::size_t b) const;
+  /// innermost loop of the block
+  std::size_t getLoopOf(std::size_t b) const;
+
+ private:
+  std::vector<Loop>        Loops;
+  std::vector<std::size_t> LoopOf;
+};
+
+
+////////////////////////////////////////////////////////////////////
+/// Array accesses
+
+/// the LOADX and XLOAD (by position) of the subroutine whose index is
+/// proven to be inside a local array: a counter that is set to
+/// non-negative constants and only increased (by non-negative
+/// constants) in loops that compare it with a constant bound, and
+/// whose comparison at the header of a loop that contains the access
+/// is with a bound not greater than the size of the array, with no
+/// increase between the comparison and the access
+std::vector<bool> inBoundsAccesses(const subroutine & subr);
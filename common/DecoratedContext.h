@@ -0,0 +1,56 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    DecoratedContext - Parse tree nodes with decorations for
+//                       the Asl programming language
+//
+//    Copyright (C) 2017-2023  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+
+#pragma once
+
+#include "antlr4-runtime.h"
+
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Class DecoratedContext: the base class of every context of the
+// parse tree (option contextSuperClass of the grammar). It keeps the
+// index of the node in the attribute arrays of its TreeDecoration,
+// assigned when the node gets its first attribute, so the attributes
+// of a node are found without any lookup.
+
+class DecoratedContext : public antlr4::ParserRuleContext {
+
+public:
+  using antlr4::ParserRuleContext::ParserRuleContext;
+
+  // Index of a node without attributes
+  static const std::size_t NoIndex = static_cast<std::size_t>(-1);
+
+  // Index of the node in its TreeDecoration (NoIndex if none)
+  std::size_t decorationIndex = NoIndex;
+
+};  // class DecoratedContext
@@ -0,0 +1,1241 @@
+/////////////////////////////////////////////////////////////////
+//
+//    Interpreter - t-code execution engine for the Asl programming language
+//
+//    Copyright (C) 2017-2023  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include "Interpreter.h"
+#include "ControlFlow.h"
+#include "ProgramIO.h"
+#include "code.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+#include <cstdlib>    // EXIT_FAILURE, EXIT_SUCCESS, std::strtol, std::strtof
+#include <cstring>    // std::memcpy, std::memmove, std::memset
+#include <algorithm>  // std::fill, std::sort
+#include <chrono>
+#include <iomanip>    // std::setw, std::setprecision
+
+#include <sys/mman.h> // mmap, munmap
+#include <sys/stat.h> // fstat
+#include <fcntl.h>    // open
+#include <unistd.h>   // close
+
+// using namespace std;
+
+
+// maximum number of slots of the stack (256 MB)
+static const std::size_t MAX_STACK_SLOTS = std::size_t(64) * 1024 * 1024;
+
+
+// Constructors
+Interpreter::Interpreter(const code & program) :
+  Head(),
+  MappedAddr{nullptr},
+  MappedSize{0} {
+  compileProgram(program);
+  setImageToCompiledProgram();
+}
+
+Interpreter::Interpreter(const std::string & binaryFileName) :
+  Head(),
+  MappedAddr{nullptr},
+  MappedSize{0} {
+  setImageToCompiledProgram();
+  loadImage(binaryFileName);
+}
+
+// Destructor
+Interpreter::~Interpreter() {
+  if (MappedAddr) munmap(MappedAddr, MappedSize);
+}
+
+bool Interpreter::hasErrors() const {
+  return not ErrorMessage.empty();
+}
+
+const std::string & Interpreter::getErrorMessage() const {
+  return ErrorMessage;
+}
+
+void Interpreter::error(const std::string & subrName, const std::string & message) {
+  if (ErrorMessage.empty())
+    ErrorMessage = "function " + subrName + ": " + message;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Compilation of the t-code
+
+void Interpreter::compileProgram(const code & program) {
+  const std::vector<subroutine> & subrList = program.get_subroutine_list();
+  std::map<std::string, std::uint32_t> subrIndex;
+  for (std::uint32_t i = 0; i < subrList.size(); ++i)
+    subrIndex.insert(std::make_pair(subrList[i].get_name(), i));
+
+  std::map<std::string, std::uint32_t>::const_iterator it = subrIndex.find("main");
+  if (it == subrIndex.end()) {
+    error("main", "not found");
+    return;
+  }
+  Head.mainIndex = it->second;
+
+  for (auto & subr : subrList)
+    compileSubroutine(subr, subrIndex);
+}
+
+void Interpreter::compileSubroutine(const subroutine & subr,
+                                    const std::map<std::string, std::uint32_t> & subrIndex) {
+  SubrCompiler sc;
+  sc.subr = &subr;
+  sc.name = subr.get_name();
+  sc.nslots = 0;
+  Subr s;
+  s.name = addString(sc.name);
+  s.first = InstrVec.size();
+  s.firstConst = ConstVec.size();
+  s.firstLabel = LabelVec.size();
+  s.firstSymbol = SymbolVec.size();
+
+  // params (arrays are passed by reference: one slot)
+  for (auto & p : subr.params) {
+    operand name = operand::variable(p.name);
+    addSymbol(p.name, p.type, sc.nslots, SYMBOL_PARAM, p.nelem);
+    sc.slots[name] = sc.nslots++;
+    sc.isLocalVar[name] = false;
+  }
+  s.nparams = sc.nslots;
+  // local vars (arrays use one slot per element)
+  for (auto & v : subr.vars) {
+    operand name = operand::variable(v.name);
+    addSymbol(v.name, v.type, sc.nslots, SYMBOL_VAR, v.nelem);
+    sc.slots[name] = sc.nslots;
+    sc.isLocalVar[name] = true;
+    sc.nslots += (v.nelem > 0 ? v.nelem : 1);
+  }
+
+  // first pass: compile every instruction but labels, remembering their
+  // new program counter. Jumps still hold the t-code position of the label
+  const instructionList & lins = subr.get_instructions();
+  std::vector<std::uint32_t> newPc(lins.size() + 1);
+  std::uint32_t npushes = 0;
+  bool valid = true;
+  for (std::size_t pc = 0; pc < lins.size() and valid; ++pc) {
+    newPc[pc] = InstrVec.size();
+    const instruction & instr = lins[pc];
+    if (instr.oper == instruction::_LABEL) {
+      Label l = { addString(instr.arg1.name()), std::uint32_t(InstrVec.size()) };
+      LabelVec.push_back(l);
+      continue;
+    }
+    if (instr.oper == instruction::_PUSH) ++npushes;
+    InstrVec.push_back(compileInstruction(instr, sc, subrIndex, valid));
+    LineVec.push_back(instr.line);
+  }
+  newPc[lins.size()] = InstrVec.size();
+  if (not valid) return;
+  // a subroutine always ends returning to its caller
+  if (lins.empty() or lins.back().oper != instruction::_RETURN) {
+    Instr ret = { instruction::_RETURN, 0, 0, 0, 0 };
+    InstrVec.push_back(ret);
+    LineVec.push_back(0);
+  }
+
+  // the array accesses with an index proven in bounds, kept in the
+  // mode through the fusion of the superinstructions
+  std::vector<bool> inBounds = inBoundsAccesses(subr);
+  for (std::size_t pc = 0; pc < lins.size(); ++pc)
+    if (inBounds[pc]) InstrVec[newPc[pc]].mode |= MODE_IN_BOUNDS;
+
+  // superinstructions, with the temporals written and read only once
+  std::map<operand, std::uint32_t> occurrences;
+  for (auto & instr : lins) {
+    if (instr.arg1.isTemp()) ++occurrences[instr.arg1];
+    if (instr.arg2.isTemp()) ++occurrences[instr.arg2];
+    if (instr.arg3.isTemp()) ++occurrences[instr.arg3];
+  }
+  std::vector<bool> singleUse(sc.nslots, false);
+  for (auto & temp : occurrences)
+    if (temp.second == 2) singleUse[sc.slots[temp.first]] = true;
+  std::vector<std::uint32_t> fusedPc;
+  fuseInstructions(s.first, singleUse, s.firstLabel, fusedPc);
+  for (auto & pc : newPc) pc = fusedPc[pc - s.first];
+
+  // second pass: jumps to the new program counter of their labels, and
+  // the accesses in bounds of a local array without their check
+  for (std::size_t pc = s.first; pc < InstrVec.size(); ++pc) {
+    Instr & instr = InstrVec[pc];
+    if (instr.mode & MODE_IN_BOUNDS) {
+      instr.mode &= ~MODE_IN_BOUNDS;
+      if (instr.mode == MODE_LOCAL_ARRAY and instr.op == instruction::_LOADX) instr.op = _LOADXL;
+      if (instr.mode == MODE_LOCAL_ARRAY and instr.op == instruction::_XLOAD) instr.op = _XLOADL;
+    }
+    if (instr.op == instruction::_UJUMP) instr.a = newPc[instr.a];
+    else if (instr.op == instruction::_FJUMP or instr.op == _TJUMP) instr.b = newPc[instr.b];
+    else if (instr.op >= _BEQ and instr.op <= _BGTI) instr.c = newPc[instr.c];
+  }
+
+  s.ninstrs = InstrVec.size() - s.first;
+  s.framesize = sc.nslots;
+  s.extent = sc.nslots + npushes;
+  s.nconsts = ConstVec.size() - s.firstConst;
+  s.nlabels = LabelVec.size() - s.firstLabel;
+  s.nsymbols = SymbolVec.size() - s.firstSymbol;
+  SubrVec.push_back(s);
+}
+
+Interpreter::Instr Interpreter::compileInstruction(const instruction & instr, SubrCompiler & sc,
+                                                   const std::map<std::string, std::uint32_t> & subrIndex,
+                                                   bool & valid) {
+  Instr ci = { std::uint16_t(instr.oper), 0, 0, 0, 0 };
+  switch (instr.oper) {
+  case instruction::_UJUMP:
+  case instruction::_FJUMP: {
+    const operand & label = (instr.oper == instruction::_UJUMP ? instr.arg1 : instr.arg2);
+    // position of the label in the t-code (compileSubroutine translates
+    // it to the program counter of the compiled code)
+    if (not sc.subr->has_label(label)) {
+      error(sc.name, "undefined label " + label.dump());
+      valid = false;
+      break;
+    }
+    if (instr.oper == instruction::_UJUMP) ci.a = sc.subr->get_label_pc(label);
+    else {
+      ci.a = valueOperand(instr.arg1, sc, valid);
+      ci.b = sc.subr->get_label_pc(label);
+    }
+    break;
+  }
+  case instruction::_HALT:
+  case instruction::_WRITES: {
+    std::string s = (instr.oper == instruction::_HALT ? instr.arg1.name() : unescapeString(instr.arg1.name()));
+    ci.a = addString(s);
+    ci.b = s.size();
+    break;
+  }
+  case instruction::_PUSH:
+  case instruction::_POP:
+    if (not instr.arg1.isNone()) {
+      ci.mode = MODE_HAS_ARG;
+      ci.a = (instr.oper == instruction::_PUSH ? valueOperand(instr.arg1, sc, valid)
+                                               : destOperand(instr.arg1, sc, valid));
+    }
+    break;
+  case instruction::_CALL: {
+    std::map<std::string, std::uint32_t>::const_iterator it = subrIndex.find(instr.arg1.name());
+    if (it == subrIndex.end()) {
+      error(sc.name, "call to undefined function " + instr.arg1.dump());
+      valid = false;
+    }
+    else ci.a = it->second;
+    break;
+  }
+  case instruction::_ADD:  case instruction::_SUB:  case instruction::_MUL:
+  case instruction::_DIV:  case instruction::_EQ:   case instruction::_LT:
+  case instruction::_LE:   case instruction::_AND:  case instruction::_OR:
+  case instruction::_FADD: case instruction::_FSUB: case instruction::_FMUL:
+  case instruction::_FDIV: case instruction::_FEQ:  case instruction::_FLT:
+  case instruction::_FLE:
+    ci.a = destOperand(instr.arg1, sc, valid);
+    ci.b = valueOperand(instr.arg2, sc, valid);
+    ci.c = valueOperand(instr.arg3, sc, valid);
+    break;
+  case instruction::_NOT:  case instruction::_NEG:  case instruction::_FNEG:
+  case instruction::_FLOAT: case instruction::_LOADC:
+    ci.a = destOperand(instr.arg1, sc, valid);
+    ci.b = valueOperand(instr.arg2, sc, valid);
+    break;
+  case instruction::_CLOAD:
+    ci.a = valueOperand(instr.arg1, sc, valid);
+    ci.b = valueOperand(instr.arg2, sc, valid);
+    break;
+  case instruction::_LOAD:
+    ci.a = destOperand(instr.arg1, sc, valid);
+    // "a1 = 9" is an immediate load
+    if (instr.arg2.isConst()) {
+      ci.op = instruction::_ILOAD;
+      ci.b = constValue(instr.arg2).i;
+    }
+    else ci.b = valueOperand(instr.arg2, sc, valid);
+    break;
+  case instruction::_ILOAD:
+  case instruction::_FLOAD:
+  case instruction::_CHLOAD:
+    ci.a = destOperand(instr.arg1, sc, valid);
+    if (not instr.arg2.isConst()) {
+      error(sc.name, "invalid constant " + instr.arg2.dump());
+      valid = false;
+    }
+    else ci.b = constValue(instr.arg2).i;
+    break;
+  case instruction::_XLOAD:
+    ci.a = arrayOperand(instr.arg1, sc, ci.mode, valid);
+    ci.b = valueOperand(instr.arg2, sc, valid);
+    ci.c = valueOperand(instr.arg3, sc, valid);
+    break;
+  case instruction::_LOADX:
+    ci.a = destOperand(instr.arg1, sc, valid);
+    ci.b = arrayOperand(instr.arg2, sc, ci.mode, valid);
+    ci.c = valueOperand(instr.arg3, sc, valid);
+    break;
+  case instruction::_ALOAD:
+    ci.a = destOperand(instr.arg1, sc, valid);
+    ci.b = arrayOperand(instr.arg2, sc, ci.mode, valid);
+    break;
+  case instruction::_ACOPY:
+    ci.a = arrayOperand(instr.arg1, sc, ci.mode, valid);
+    ci.b = arrayOperand(instr.arg2, sc, ci.mode, valid, MODE_LOCAL_ARRAY2);
+    ci.c = valueOperand(instr.arg3, sc, valid);
+    break;
+  case instruction::_AFILL:
+    ci.a = arrayOperand(instr.arg1, sc, ci.mode, valid);
+    ci.b = valueOperand(instr.arg2, sc, valid);
+    ci.c = valueOperand(instr.arg3, sc, valid);
+    break;
+  case instruction::_READI: case instruction::_READF: case instruction::_READC:
+    ci.a = destOperand(instr.arg1, sc, valid);
+    break;
+  case instruction::_WRITEI: case instruction::_WRITEF: case instruction::_WRITEC:
+    ci.a = valueOperand(instr.arg1, sc, valid);
+    break;
+  case instruction::_RETURN:
+  case instruction::_WRITELN:
+  case instruction::_NOOP:
+    break;
+  default:
+    error(sc.name, "invalid instruction '" + instr.dump() + "'");
+    valid = false;
+    break;
+  }
+  return ci;
+}
+
+////////////////////////////////////////////////////////////////////
+// Superinstructions
+
+// Fuse the instructions of the subroutine starting at 'first', in
+// place: every new instruction is fused with the previous ones while
+// a pattern matches. A label target can only be the first instruction
+// of a fused group. 'singleUse' tells the slots of the temporals
+// written and read only once, and fusedPc gets the new pc of each
+// instruction (relative to 'first') and of the end
+void Interpreter::fuseInstructions(std::uint32_t first, const std::vector<bool> & singleUse,
+                                   std::uint32_t labelsFrom, std::vector<std::uint32_t> & fusedPc) {
+  std::uint32_t end = InstrVec.size();
+  std::vector<bool> isTarget(end - first + 1, false);
+  for (std::uint32_t l = labelsFrom; l < LabelVec.size(); ++l)
+    isTarget[LabelVec[l].pc - first] = true;
+  fusedPc.assign(end - first + 1, 0);
+  std::uint32_t out = first;
+  std::uint32_t barrier = first;   // no instruction before it can be fused
+  for (std::uint32_t pc = first; pc < end; ++pc) {
+    if (isTarget[pc - first]) barrier = out;
+    InstrVec[out] = InstrVec[pc];
+    LineVec[out] = LineVec[pc];
+    ++out;
+    for (bool fused = true; fused; ) {
+      Instr instr;
+      fused = false;
+      if (out - barrier >= 3 and
+          fuseArrayUpdate(InstrVec[out-3], InstrVec[out-2], InstrVec[out-1], singleUse, instr)) {
+        InstrVec[out-3] = instr;
+        out -= 2;
+        fused = true;
+      }
+      else if (out - barrier >= 2 and
+               fusePair(InstrVec[out-2], InstrVec[out-1], singleUse, instr)) {
+        InstrVec[out-2] = instr;
+        out -= 1;
+        fused = true;
+      }
+    }
+    fusedPc[pc - first] = out - 1;
+  }
+  fusedPc[end - first] = out;
+  for (std::uint32_t l = labelsFrom; l < LabelVec.size(); ++l)
+    LabelVec[l].pc = fusedPc[LabelVec[l].pc - first];
+  InstrVec.resize(out);
+  LineVec.resize(out);
+}
+
+namespace {
+  // the immediate form of an operation (_INVALID if none).
+  // 'swapped': the immediate is its first operand
+  std::uint16_t immediateForm(std::uint16_t op, bool swapped) {
+    switch (op) {
+    case instruction::_ADD: return Interpreter::_ADDI;
+    case instruction::_MUL: return Interpreter::_MULI;
+    case instruction::_EQ:  return Interpreter::_EQI;
+    case instruction::_SUB: return swapped ? Interpreter::_RSUBI : Interpreter::_SUBI;
+    case instruction::_LT:  return swapped ? Interpreter::_GTI : Interpreter::_LTI;
+    case instruction::_LE:  return swapped ? Interpreter::_GEI : Interpreter::_LEI;
+    default:                return instruction::_INVALID;
+    }
+  }
+
+  // true if the only slot written by the instruction is its operand a
+  bool writesOperandA(std::uint16_t op) {
+    switch (op) {
+    case instruction::_ADD:  case instruction::_SUB:  case instruction::_MUL:
+    case instruction::_DIV:  case instruction::_EQ:   case instruction::_LT:
+    case instruction::_LE:   case instruction::_AND:  case instruction::_OR:
+    case instruction::_NOT:  case instruction::_NEG:  case instruction::_FLOAT:
+    case instruction::_FADD: case instruction::_FSUB: case instruction::_FMUL:
+    case instruction::_FDIV: case instruction::_FEQ:  case instruction::_FLT:
+    case instruction::_FLE:  case instruction::_FNEG: case instruction::_LOAD:
+    case instruction::_ILOAD: case instruction::_CHLOAD: case instruction::_FLOAD:
+    case instruction::_LOADX: case instruction::_ALOAD: case instruction::_LOADC:
+    case Interpreter::_ADDI: case Interpreter::_SUBI: case Interpreter::_RSUBI:
+    case Interpreter::_MULI: case Interpreter::_EQI:  case Interpreter::_LTI:
+    case Interpreter::_LEI:  case Interpreter::_GTI:  case Interpreter::_GEI:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  // the branch taken when the comparison is true (or false)
+  std::uint16_t branchForm(std::uint16_t op, bool ifTrue) {
+    switch (op) {
+    case instruction::_EQ:    return ifTrue ? Interpreter::_BEQ  : Interpreter::_BNE;
+    case instruction::_LT:    return ifTrue ? Interpreter::_BLT  : Interpreter::_BGE;
+    case instruction::_LE:    return ifTrue ? Interpreter::_BLE  : Interpreter::_BGT;
+    case Interpreter::_EQI:   return ifTrue ? Interpreter::_BEQI : Interpreter::_BNEI;
+    case Interpreter::_LTI:   return ifTrue ? Interpreter::_BLTI : Interpreter::_BGEI;
+    case Interpreter::_LEI:   return ifTrue ? Interpreter::_BLEI : Interpreter::_BGTI;
+    case Interpreter::_GTI:   return ifTrue ? Interpreter::_BGTI : Interpreter::_BLEI;
+    case Interpreter::_GEI:   return ifTrue ? Interpreter::_BGEI : Interpreter::_BLTI;
+    default:                  return instruction::_INVALID;
+    }
+  }
+}
+
+// Pairs fused (%t is a single-use temporal):
+//   %t = ... ; a = %t            ->  a = ...           (operand fusion)
+//   %t = k ; a = b op %t         ->  a = b opI k       (ADDI, LTI...)
+//   %t = not c ; ifFalse %t goto L  ->  if c goto L    (TJUMP)
+//   %t = a cmp b ; ifFalse/if %t goto L  ->  goto L if (a cmp b) is false/true
+bool Interpreter::fusePair(const Instr & i1, const Instr & i2,
+                           const std::vector<bool> & singleUse, Instr & fused) {
+  if (std::size_t(i1.a) >= singleUse.size() or not singleUse[i1.a]) return false;
+  if (i2.op == instruction::_LOAD and i2.b == i1.a and writesOperandA(i1.op)) {
+    fused = i1;
+    fused.a = i2.a;
+    return true;
+  }
+  if (i1.op == instruction::_ILOAD or i1.op == instruction::_CHLOAD) {
+    bool swapped = (i2.b == i1.a);
+    if ((i2.c == i1.a) == swapped) return false;
+    std::uint16_t op = immediateForm(i2.op, swapped);
+    if (op == instruction::_INVALID) return false;
+    fused = { op, 0, i2.a, swapped ? i2.c : i2.b, i1.b };
+    return true;
+  }
+  if (i1.op == instruction::_NOT and i2.op == instruction::_FJUMP and i2.a == i1.a) {
+    fused = { _TJUMP, 0, i1.b, i2.b, 0 };
+    return true;
+  }
+  if ((i2.op == instruction::_FJUMP or i2.op == _TJUMP) and i2.a == i1.a) {
+    std::uint16_t op = branchForm(i1.op, i2.op == _TJUMP);
+    if (op == instruction::_INVALID) return false;
+    fused = { op, 0, i1.b, i1.c, i2.b };
+    return true;
+  }
+  return false;
+}
+
+// Indexed read-modify-write (%t and %u are single-use temporals):
+//   %t = a[i] ; %u = %t + x ; a[i] = %u   ->  a[i] = a[i] + x   (AADD)
+// or - x, + k, - k (ASUB, AADDI, ASUBI)
+bool Interpreter::fuseArrayUpdate(const Instr & i1, const Instr & i2, const Instr & i3,
+                                  const std::vector<bool> & singleUse, Instr & fused) {
+  if (i1.op != instruction::_LOADX or i3.op != instruction::_XLOAD or
+      i1.b != i3.a or i1.c != i3.b or i1.mode != i3.mode or
+      std::size_t(i1.a) >= singleUse.size() or not singleUse[i1.a] or
+      std::size_t(i2.a) >= singleUse.size() or not singleUse[i2.a] or i3.c != i2.a)
+    return false;
+  std::int32_t x;
+  std::uint16_t op;
+  if (i2.op == instruction::_ADD and (i2.b == i1.a) != (i2.c == i1.a)) {
+    op = _AADD;
+    x = (i2.b == i1.a ? i2.c : i2.b);
+  }
+  else if ((i2.op == instruction::_SUB or i2.op == _ADDI or i2.op == _SUBI) and i2.b == i1.a) {
+    op = (i2.op == instruction::_SUB ? _ASUB : i2.op == _ADDI ? _AADDI : _ASUBI);
+    x = i2.c;
+  }
+  else return false;
+  fused = { op, i1.mode, i1.b, i1.c, x };
+  return true;
+}
+
+
+// slot of a param, local var or temporal (temporals get a new slot
+// the first time they appear)
+std::int32_t Interpreter::destOperand(const operand & arg, SubrCompiler & sc, bool & valid) {
+  std::map<operand, std::uint32_t>::const_iterator it = sc.slots.find(arg);
+  if (it != sc.slots.end()) return it->second;
+  if (arg.isTemp()) {
+    addSymbol(arg.dump(), "", sc.nslots, SYMBOL_TEMP, 1);
+    sc.slots[arg] = sc.nslots;
+    sc.isLocalVar[arg] = false;
+    return sc.nslots++;
+  }
+  error(sc.name, "undefined identifier '" + arg.dump() + "'");
+  valid = false;
+  return 0;
+}
+
+// slot holding the value of the operand: numeric constants get a slot
+// of their own, initialized each time the subroutine is called
+std::int32_t Interpreter::valueOperand(const operand & arg, SubrCompiler & sc, bool & valid) {
+  if (not arg.isConst()) return destOperand(arg, sc, valid);
+  std::map<operand, std::uint32_t>::const_iterator it = sc.constSlots.find(arg);
+  if (it != sc.constSlots.end()) return it->second;
+  Constant k;
+  k.slot = sc.nslots++;
+  k.value = constValue(arg);
+  k.text = addString(arg.dump());
+  ConstVec.push_back(k);
+  sc.constSlots[arg] = k.slot;
+  return k.slot;
+}
+
+// array operand: local arrays are accessed relative to the frame,
+// params and temporals hold the address of the array
+std::int32_t Interpreter::arrayOperand(const operand & arg, SubrCompiler & sc,
+                                       std::uint16_t & mode, bool & valid,
+                                       std::uint16_t localMode) {
+  std::int32_t slot = destOperand(arg, sc, valid);
+  if (valid and sc.isLocalVar[arg]) mode |= localMode;
+  return slot;
+}
+
+void Interpreter::addSymbol(const std::string & name, const std::string & type,
+                            std::uint32_t slot, std::uint32_t kind, std::uint32_t nelem) {
+  Symbol sym = { addString(name), addString(type), slot, kind, nelem };
+  SymbolVec.push_back(sym);
+}
+
+// strings are stored once, terminated by '\0'
+std::uint32_t Interpreter::addString(const std::string & s) {
+  std::map<std::string, std::uint32_t>::const_iterator it = StringOffsets.find(s);
+  if (it != StringOffsets.end()) return it->second;
+  std::uint32_t offset = StringPool.size();
+  StringPool += s;
+  StringPool.push_back('\0');
+  StringOffsets.insert(std::make_pair(s, offset));
+  return offset;
+}
+
+// value of an int, float or char constant
+Interpreter::Value Interpreter::constValue(const operand & arg) {
+  Value v;
+  if (arg.kind() == operand::FLOAT) v.f = arg.floatValue();
+  else v.i = arg.intValue();
+  return v;
+}
+
+static char escapedChar(char c) {
+  switch (c) {
+  case 'b' : return '\b';
+  case 't' : return '\t';
+  case 'n' : return '\n';
+  case 'f' : return '\f';
+  case 'r' : return '\r';
+  default  : return c;    // \" \' and \\ .
+  }
+}
+
+// string constant of WRITES (with quotes and escape sequences)
+std::string Interpreter::unescapeString(const std::string & arg) {
+  std::string s;
+  std::size_t begin = 0, end = arg.size();
+  if (end >= 2 and arg[0] == '"' and arg[end-1] == '"') { begin = 1; --end; }
+  for (std::size_t i = begin; i < end; ++i) {
+    if (arg[i] == '\\' and i + 1 < end) s.push_back(escapedChar(arg[++i]));
+    else s.push_back(arg[i]);
+  }
+  return s;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Binary t-code: the image of the program
+
+void Interpreter::setImageToCompiledProgram() {
+  std::memcpy(Head.magic, "ASLT", 4);
+  Head.version = BINARY_VERSION;
+  Head.nsubrs = SubrVec.size();
+  Head.ninstrs = InstrVec.size();
+  Head.nconsts = ConstVec.size();
+  Head.nlabels = LabelVec.size();
+  Head.nsymbols = SymbolVec.size();
+  Head.strsize = StringPool.size();
+  Subrs = SubrVec.data();
+  Instrs = InstrVec.data();
+  Consts = ConstVec.data();
+  Labels = LabelVec.data();
+  Symbols = SymbolVec.data();
+  Strings = StringPool.data();
+}
+
+void Interpreter::writeImage(std::ostream & os) const {
+  os.write(reinterpret_cast<const char *>(&Head), sizeof(Header));
+  os.write(reinterpret_cast<const char *>(Subrs), Head.nsubrs * sizeof(Subr));
+  // the checks of LOADXL and XLOADL come back in the file, since
+  // validImage cannot prove the indices of the image it maps
+  for (std::uint32_t pc = 0; pc < Head.ninstrs; ++pc) {
+    Instr instr = Instrs[pc];
+    if (instr.op == _LOADXL) instr.op = instruction::_LOADX;
+    else if (instr.op == _XLOADL) instr.op = instruction::_XLOAD;
+    os.write(reinterpret_cast<const char *>(&instr), sizeof(Instr));
+  }
+  os.write(reinterpret_cast<const char *>(Consts), Head.nconsts * sizeof(Constant));
+  os.write(reinterpret_cast<const char *>(Labels), Head.nlabels * sizeof(Label));
+  os.write(reinterpret_cast<const char *>(Symbols), Head.nsymbols * sizeof(Symbol));
+  os.write(Strings, Head.strsize);
+}
+
+void Interpreter::loadImage(const std::string & binaryFileName) {
+  int fd = open(binaryFileName.c_str(), O_RDONLY);
+  if (fd < 0) {
+    ErrorMessage = "cannot open " + binaryFileName;
+    return;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 or st.st_size <= 0) {
+    close(fd);
+    ErrorMessage = binaryFileName + ": not a binary t-code file";
+    return;
+  }
+  void * addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    ErrorMessage = "cannot map " + binaryFileName;
+    return;
+  }
+  MappedAddr = addr;
+  MappedSize = st.st_size;
+  if (not validImage(static_cast<const char *>(addr), MappedSize))
+    ErrorMessage = binaryFileName + ": not a valid binary t-code file (version "
+                   + std::to_string(BINARY_VERSION) + ")";
+}
+
+// check the sizes, offsets and operands of a mapped image, so that a
+// corrupt file cannot make the interpreter access outside the image
+bool Interpreter::validImage(const char * base, std::size_t size) {
+  if (size < sizeof(Header)) return false;
+  std::memcpy(&Head, base, sizeof(Header));
+  if (std::memcmp(Head.magic, "ASLT", 4) != 0 or Head.version != BINARY_VERSION)
+    return false;
+  std::uint64_t offs = sizeof(Header);
+  std::uint64_t subrsOffs   = offs;  offs += std::uint64_t(Head.nsubrs)   * sizeof(Subr);
+  std::uint64_t instrsOffs  = offs;  offs += std::uint64_t(Head.ninstrs)  * sizeof(Instr);
+  std::uint64_t constsOffs  = offs;  offs += std::uint64_t(Head.nconsts)  * sizeof(Constant);
+  std::uint64_t labelsOffs  = offs;  offs += std::uint64_t(Head.nlabels)  * sizeof(Label);
+  std::uint64_t symbolsOffs = offs;  offs += std::uint64_t(Head.nsymbols) * sizeof(Symbol);
+  std::uint64_t stringsOffs = offs;  offs += Head.strsize;
+  if (offs != size or Head.strsize == 0 or base[size-1] != '\0' or
+      Head.mainIndex >= Head.nsubrs)
+    return false;
+  Subrs   = reinterpret_cast<const Subr *>(base + subrsOffs);
+  Instrs  = reinterpret_cast<const Instr *>(base + instrsOffs);
+  Consts  = reinterpret_cast<const Constant *>(base + constsOffs);
+  Labels  = reinterpret_cast<const Label *>(base + labelsOffs);
+  Symbols = reinterpret_cast<const Symbol *>(base + symbolsOffs);
+  Strings = base + stringsOffs;
+
+  for (std::uint32_t n = 0; n < Head.nsubrs; ++n) {
+    const Subr & s = Subrs[n];
+    if (s.name >= Head.strsize or s.ninstrs == 0 or
+        std::uint64_t(s.first) + s.ninstrs > Head.ninstrs or
+        std::uint64_t(s.firstConst) + s.nconsts > Head.nconsts or
+        std::uint64_t(s.firstLabel) + s.nlabels > Head.nlabels or
+        std::uint64_t(s.firstSymbol) + s.nsymbols > Head.nsymbols or
+        s.nparams > s.framesize or s.framesize > s.extent or
+        Instrs[s.first + s.ninstrs - 1].op != instruction::_RETURN)
+      return false;
+    for (std::uint32_t k = s.firstConst; k < s.firstConst + s.nconsts; ++k)
+      if (Consts[k].slot >= s.framesize) return false;
+    std::uint32_t npushes = 0;
+    for (std::uint32_t pc = s.first; pc < s.first + s.ninstrs; ++pc) {
+      const Instr & I = Instrs[pc];
+      // number of leading operands (a, b, c) that are frame slots
+      std::uint32_t nslots = 0;
+      switch (I.op) {
+      case instruction::_UJUMP:
+        if (std::uint32_t(I.a) < s.first or std::uint32_t(I.a) >= s.first + s.ninstrs) return false;
+        break;
+      case instruction::_FJUMP:
+        if (std::uint32_t(I.b) < s.first or std::uint32_t(I.b) >= s.first + s.ninstrs) return false;
+        nslots = 1;
+        break;
+      case instruction::_HALT:
+      case instruction::_WRITES:
+        if (std::uint64_t(std::uint32_t(I.a)) + std::uint32_t(I.b) >= Head.strsize) return false;
+        break;
+      case instruction::_PUSH:
+        ++npushes;
+        nslots = (I.mode & MODE_HAS_ARG ? 1 : 0);
+        break;
+      case instruction::_POP:
+        nslots = (I.mode & MODE_HAS_ARG ? 1 : 0);
+        break;
+      case instruction::_CALL:
+        if (std::uint32_t(I.a) >= Head.nsubrs) return false;
+        break;
+      case instruction::_RETURN: case instruction::_WRITELN: case instruction::_NOOP:
+        break;
+      case instruction::_ILOAD: case instruction::_FLOAD: case instruction::_CHLOAD:
+      case instruction::_READI: case instruction::_READF: case instruction::_READC:
+      case instruction::_WRITEI: case instruction::_WRITEF: case instruction::_WRITEC:
+        nslots = 1;
+        break;
+      case instruction::_NOT: case instruction::_NEG: case instruction::_FNEG:
+      case instruction::_FLOAT: case instruction::_LOAD: case instruction::_ALOAD:
+      case instruction::_LOADC: case instruction::_CLOAD:
+        nslots = 2;
+        break;
+      case instruction::_ADD:  case instruction::_SUB:  case instruction::_MUL:
+      case instruction::_DIV:  case instruction::_EQ:   case instruction::_LT:
+      case instruction::_LE:   case instruction::_AND:  case instruction::_OR:
+      case instruction::_FADD: case instruction::_FSUB: case instruction::_FMUL:
+      case instruction::_FDIV: case instruction::_FEQ:  case instruction::_FLT:
+      case instruction::_FLE:  case instruction::_XLOAD: case instruction::_LOADX:
+      case instruction::_ACOPY: case instruction::_AFILL:
+      case _AADD: case _ASUB:
+        nslots = 3;
+        break;
+      case _ADDI: case _SUBI: case _RSUBI: case _MULI:
+      case _EQI:  case _LTI:  case _LEI:   case _GTI: case _GEI:
+      case _AADDI: case _ASUBI:
+        nslots = 2;
+        break;
+      case _TJUMP:
+        if (std::uint32_t(I.b) < s.first or std::uint32_t(I.b) >= s.first + s.ninstrs) return false;
+        nslots = 1;
+        break;
+      case _BEQ: case _BNE: case _BLT: case _BGE: case _BLE: case _BGT:
+      case _BEQI: case _BNEI: case _BLTI: case _BGEI: case _BLEI: case _BGTI:
+        if (std::uint32_t(I.c) < s.first or std::uint32_t(I.c) >= s.first + s.ninstrs) return false;
+        nslots = (I.op <= _BGT ? 2 : 1);
+        break;
+      default:
+        return false;
+      }
+      const std::int32_t operands[3] = { I.a, I.b, I.c };
+      for (std::uint32_t k = 0; k < nslots; ++k)
+        if (operands[k] < 0 or std::uint32_t(operands[k]) >= s.framesize) return false;
+    }
+    if (npushes > s.extent - s.framesize) return false;
+  }
+  return true;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Execution
+
+void Interpreter::halt(std::ostream & err, const char * message) {
+  err << "VM_CRASH: Execution halted: " << message << std::endl;
+}
+
+namespace {
+  // return address and frame of the caller
+  struct CallFrame {
+    std::uint32_t ret;
+    std::uint32_t fp;
+    std::uint32_t subr;
+  };
+
+  // inclusive time of the subroutines being profiled: only the
+  // outermost activation of a recursive subroutine is timed. The ones
+  // still active when the execution ends (halt) are timed on destruction
+  class SubrTimes {
+  public:
+    // 'inclusiveMs' has an entry per subroutine (nullptr: no profile)
+    SubrTimes(std::vector<double> * inclusiveMs) :
+      Active(inclusiveMs ? inclusiveMs->size() : 0, 0), Started(Active.size()),
+      InclusiveMs(inclusiveMs) {
+    }
+    ~SubrTimes() {
+      for (std::size_t s = 0; s < Active.size(); ++s)
+        if (Active[s] > 0) addTime(s);
+    }
+    void enter(std::uint32_t s) {
+      if (Active[s]++ == 0) Started[s] = Clock::now();
+    }
+    void leave(std::uint32_t s) {
+      if (--Active[s] == 0) addTime(s);
+    }
+
+  private:
+    typedef std::chrono::steady_clock Clock;
+    std::vector<std::uint32_t>     Active;
+    std::vector<Clock::time_point> Started;
+    std::vector<double>          * InclusiveMs;
+
+    void addTime(std::size_t s) {
+      (*InclusiveMs)[s] += std::chrono::duration<double, std::milli>(Clock::now() - Started[s]).count();
+    }
+  };
+}
+
+int Interpreter::run(std::istream & in, std::ostream & out, std::ostream & err) const {
+  return execute<false>(in, out, err, nullptr);
+}
+
+int Interpreter::profile(std::istream & in, std::ostream & out, Profile & prof,
+                         std::ostream & err) const {
+  prof.executed.assign(Head.ninstrs, 0);
+  prof.elements.assign(Head.ninstrs, 0);
+  prof.calls.assign(Head.nsubrs, 0);
+  prof.inclusiveMs.assign(Head.nsubrs, 0);
+  prof.callTree.clear();
+  if (not hasErrors()) {
+    prof.calls[Head.mainIndex] = 1;
+    Profile::CallNode root = { Head.mainIndex, 0, 0, {} };
+    prof.callTree.push_back(root);
+  }
+  return execute<true>(in, out, err, &prof);
+}
+
+template <bool PROFILE>
+int Interpreter::execute(std::istream & in, std::ostream & out, std::ostream & err,
+                         Profile * prof) const {
+  if (hasErrors()) {
+    err << "VM_CRASH: " << ErrorMessage << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const Instr    * prog   = Instrs;
+  const Subr     * subrs  = Subrs;
+  const Constant * consts = Consts;
+  const char     * strs   = Strings;
+
+  OutputBuffer output(out);
+  InputReader  input(in, output);
+  std::vector<Value>     stack(subrs[Head.mainIndex].extent + 1024);
+  std::vector<CallFrame> calls;
+  std::uint32_t subr = Head.mainIndex;
+  std::uint32_t fp = 0;
+  std::uint32_t sp = subrs[subr].framesize;
+  std::memset(stack.data(), 0, stack.size() * sizeof(Value));
+  for (std::uint32_t k = 0; k < subrs[subr].nconsts; ++k)
+    stack[consts[subrs[subr].firstConst + k].slot] = consts[subrs[subr].firstConst + k].value;
+
+  Value * mem = stack.data();
+  Value * F   = mem;
+  std::size_t memsize = stack.size();
+  std::uint32_t pc = subrs[subr].first;
+
+  // profile: node of the call tree being executed, and inclusive times
+  std::uint32_t node = 0;
+  SubrTimes times(PROFILE ? &prof->inclusiveMs : nullptr);
+  if (PROFILE) times.enter(subr);
+
+  // integer arithmetic wraps around (as in the LLVM code)
+#define IOP(x, y, OP) std::int32_t(std::uint32_t(x) OP std::uint32_t(y))
+#define CHECK_ADDR(addr)                                                \
+  if (std::size_t(addr) >= memsize) { output.flush(); halt(err, code::INDEX_OUT_OF_RANGE.c_str()); return EXIT_FAILURE; }
+
+  for (;;) {
+    if (PROFILE) {
+      ++prof->executed[pc];
+      ++prof->callTree[node].instructions;
+    }
+    const Instr & I = prog[pc++];
+    switch (I.op) {
+    case instruction::_UJUMP:  pc = I.a; break;
+    case instruction::_FJUMP:  if (not F[I.a].i) pc = I.b; break;
+    case instruction::_HALT:
+      output.flush();
+      halt(err, strs + I.a);
+      return EXIT_FAILURE;
+    case instruction::_PUSH:
+      mem[sp++] = (I.mode & MODE_HAS_ARG) ? F[I.a] : Value{0};
+      break;
+    case instruction::_POP:
+      --sp;
+      if (I.mode & MODE_HAS_ARG) F[I.a] = mem[sp];
+      break;
+    case instruction::_CALL: {
+      const Subr & callee = subrs[I.a];
+      CallFrame cf = { pc, fp, subr };
+      calls.push_back(cf);
+      fp = sp - callee.nparams;
+      sp = fp + callee.framesize;
+      if (fp + callee.extent > memsize) {
+        std::size_t newsize = 2 * (fp + callee.extent);
+        if (newsize > MAX_STACK_SLOTS) {
+          output.flush();
+          halt(err, "Stack overflow.");
+          return EXIT_FAILURE;
+        }
+        stack.resize(newsize);
+        mem = stack.data();
+        memsize = newsize;
+      }
+      F = mem + fp;
+      std::memset(F + callee.nparams, 0, (callee.framesize - callee.nparams) * sizeof(Value));
+      for (std::uint32_t k = 0; k < callee.nconsts; ++k)
+        F[consts[callee.firstConst + k].slot] = consts[callee.firstConst + k].value;
+      subr = I.a;
+      pc = callee.first;
+      if (PROFILE) {
+        ++prof->calls[subr];
+        times.enter(subr);
+        std::map<std::uint32_t, std::uint32_t>::const_iterator child = prof->callTree[node].children.find(subr);
+        if (child != prof->callTree[node].children.end())
+          node = child->second;
+        else {
+          Profile::CallNode n = { subr, node, 0, {} };
+          prof->callTree.push_back(n);
+          prof->callTree[node].children[subr] = prof->callTree.size() - 1;
+          node = prof->callTree.size() - 1;
+        }
+      }
+      break;
+    }
+    case instruction::_RETURN: {
+      if (calls.empty()) {
+        output.flush();
+        return EXIT_SUCCESS;
+      }
+      if (PROFILE) {
+        times.leave(subr);
+        node = prof->callTree[node].parent;
+      }
+      sp = fp + subrs[subr].nparams;
+      const CallFrame & cf = calls.back();
+      pc = cf.ret;
+      fp = cf.fp;
+      subr = cf.subr;
+      calls.pop_back();
+      F = mem + fp;
+      break;
+    }
+    case instruction::_ADD:  F[I.a].i = IOP(F[I.b].i, F[I.c].i, +); break;
+    case instruction::_SUB:  F[I.a].i = IOP(F[I.b].i, F[I.c].i, -); break;
+    case instruction::_MUL:  F[I.a].i = IOP(F[I.b].i, F[I.c].i, *); break;
+    case instruction::_DIV: {
+      std::int32_t d = F[I.c].i;
+      if (d == 0) {
+        output.flush();
+        halt(err, code::INVALID_INTEGER_OPERAND.c_str());
+        return EXIT_FAILURE;
+      }
+      F[I.a].i = (d == -1 ? IOP(0, F[I.b].i, -) : F[I.b].i / d);
+      break;
+    }
+    case instruction::_EQ:   F[I.a].i = (F[I.b].i == F[I.c].i); break;
+    case instruction::_LT:   F[I.a].i = (F[I.b].i <  F[I.c].i); break;
+    case instruction::_LE:   F[I.a].i = (F[I.b].i <= F[I.c].i); break;
+    case instruction::_NEG:  F[I.a].i = IOP(0, F[I.b].i, -); break;
+    case instruction::_NOT:  F[I.a].i = not F[I.b].i; break;
+    case instruction::_AND:  F[I.a].i = (F[I.b].i and F[I.c].i); break;
+    case instruction::_OR:   F[I.a].i = (F[I.b].i or F[I.c].i); break;
+    case instruction::_FLOAT: F[I.a].f = float(F[I.b].i); break;
+    case instruction::_FADD: F[I.a].f = F[I.b].f + F[I.c].f; break;
+    case instruction::_FSUB: F[I.a].f = F[I.b].f - F[I.c].f; break;
+    case instruction::_FMUL: F[I.a].f = F[I.b].f * F[I.c].f; break;
+    case instruction::_FDIV: F[I.a].f = F[I.b].f / F[I.c].f; break;
+    case instruction::_FEQ:  F[I.a].i = (F[I.b].f == F[I.c].f); break;
+    case instruction::_FLT:  F[I.a].i = (F[I.b].f <  F[I.c].f); break;
+    case instruction::_FLE:  F[I.a].i = (F[I.b].f <= F[I.c].f); break;
+    case instruction::_FNEG: F[I.a].f = - F[I.b].f; break;
+    case instruction::_LOAD: F[I.a] = F[I.b]; break;
+    case instruction::_ILOAD:
+    case instruction::_FLOAD:
+    case instruction::_CHLOAD: F[I.a].i = I.b; break;
+    case instruction::_XLOAD: {
+      std::int64_t addr = (I.mode & MODE_LOCAL_ARRAY ? std::int64_t(fp) + I.a : F[I.a].i) + std::int64_t(F[I.b].i);
+      CHECK_ADDR(addr);
+      mem[addr] = F[I.c];
+      break;
+    }
+    case instruction::_LOADX: {
+      std::int64_t addr = (I.mode & MODE_LOCAL_ARRAY ? std::int64_t(fp) + I.b : F[I.b].i) + std::int64_t(F[I.c].i);
+      CHECK_ADDR(addr);
+      F[I.a] = mem[addr];
+      break;
+    }
+    case instruction::_ALOAD:
+      F[I.a].i = (I.mode & MODE_LOCAL_ARRAY ? std::int32_t(fp + I.b) : F[I.b].i);
+      break;
+    case _XLOADL: F[I.a + F[I.b].i] = F[I.c]; break;
+    case _LOADXL: F[I.a] = F[I.b + F[I.c].i]; break;
+    case instruction::_ACOPY: {
+      std::int64_t dst = (I.mode & MODE_LOCAL_ARRAY ? std::int64_t(fp) + I.a : F[I.a].i);
+      std::int64_t src = (I.mode & MODE_LOCAL_ARRAY2 ? std::int64_t(fp) + I.b : F[I.b].i);
+      std::int64_t n = F[I.c].i;
+      if (n > 0) {
+        CHECK_ADDR(dst);
+        CHECK_ADDR(dst + n - 1);
+        CHECK_ADDR(src);
+        CHECK_ADDR(src + n - 1);
+        std::memmove(mem + dst, mem + src, n * sizeof(Value));
+        if (PROFILE) prof->elements[pc - 1] += n;
+      }
+      break;
+    }
+    case instruction::_AFILL: {
+      std::int64_t dst = (I.mode & MODE_LOCAL_ARRAY ? std::int64_t(fp) + I.a : F[I.a].i);
+      std::int64_t n = F[I.c].i;
+      if (n > 0) {
+        CHECK_ADDR(dst);
+        CHECK_ADDR(dst + n - 1);
+        std::fill(mem + dst, mem + dst + n, F[I.b]);
+        if (PROFILE) prof->elements[pc - 1] += n;
+      }
+      break;
+    }
+    case instruction::_LOADC: {
+      std::int64_t addr = F[I.b].i;
+      CHECK_ADDR(addr);
+      F[I.a] = mem[addr];
+      break;
+    }
+    case instruction::_CLOAD: {
+      std::int64_t addr = F[I.a].i;
+      CHECK_ADDR(addr);
+      mem[addr] = F[I.b];
+      break;
+    }
+    case instruction::_READI: {
+      std::int32_t x;
+      input.readInt(x);
+      F[I.a].i = x;
+      break;
+    }
+    case instruction::_READF: {
+      float x;
+      input.readFloat(x);
+      F[I.a].f = x;
+      break;
+    }
+    case instruction::_READC: {
+      char x;
+      input.readChar(x);
+      F[I.a].i = (unsigned char)x;
+      break;
+    }
+    case instruction::_WRITEI: output.writeInt(F[I.a].i); break;
+    case instruction::_WRITEF: output.writeFloat(F[I.a].f); break;
+    case instruction::_WRITEC: output.writeChar(char(F[I.a].i)); break;
+    case instruction::_WRITES: output.write(strs + I.a, I.b); break;
+    case instruction::_WRITELN: output.writeChar('\n'); break;
+    case instruction::_NOOP: break;
+    case _ADDI:  F[I.a].i = IOP(F[I.b].i, I.c, +); break;
+    case _SUBI:  F[I.a].i = IOP(F[I.b].i, I.c, -); break;
+    case _RSUBI: F[I.a].i = IOP(I.c, F[I.b].i, -); break;
+    case _MULI:  F[I.a].i = IOP(F[I.b].i, I.c, *); break;
+    case _EQI:   F[I.a].i = (F[I.b].i == I.c); break;
+    case _LTI:   F[I.a].i = (F[I.b].i <  I.c); break;
+    case _LEI:   F[I.a].i = (F[I.b].i <= I.c); break;
+    case _GTI:   F[I.a].i = (F[I.b].i >  I.c); break;
+    case _GEI:   F[I.a].i = (F[I.b].i >= I.c); break;
+    case _TJUMP: if (F[I.a].i) pc = I.b; break;
+    case _BEQ:   if (F[I.a].i == F[I.b].i) pc = I.c; break;
+    case _BNE:   if (F[I.a].i != F[I.b].i) pc = I.c; break;
+    case _BLT:   if (F[I.a].i <  F[I.b].i) pc = I.c; break;
+    case _BGE:   if (F[I.a].i >= F[I.b].i) pc = I.c; break;
+    case _BLE:   if (F[I.a].i <= F[I.b].i) pc = I.c; break;
+    case _BGT:   if (F[I.a].i >  F[I.b].i) pc = I.c; break;
+    case _BEQI:  if (F[I.a].i == I.b) pc = I.c; break;
+    case _BNEI:  if (F[I.a].i != I.b) pc = I.c; break;
+    case _BLTI:  if (F[I.a].i <  I.b) pc = I.c; break;
+    case _BGEI:  if (F[I.a].i >= I.b) pc = I.c; break;
+    case _BLEI:  if (F[I.a].i <= I.b) pc = I.c; break;
+    case _BGTI:  if (F[I.a].i >  I.b) pc = I.c; break;
+    case _AADD: case _ASUB: case _AADDI: case _ASUBI: {
+      std::int64_t addr = (I.mode & MODE_LOCAL_ARRAY ? std::int64_t(fp) + I.a : F[I.a].i) + std::int64_t(F[I.b].i);
+      CHECK_ADDR(addr);
+      std::int32_t x = (I.op == _AADD or I.op == _ASUB ? F[I.c].i : I.c);
+      mem[addr].i = (I.op == _AADD or I.op == _AADDI ? IOP(mem[addr].i, x, +) : IOP(mem[addr].i, x, -));
+      break;
+    }
+    default:
+      output.flush();
+      halt(err, "invalid instruction.");
+      return EXIT_FAILURE;
+    }
+  }
+#undef IOP
+#undef CHECK_ADDR
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Profile
+
+namespace {
+  // names of the instruction::Operation codes and of the superinstructions
+  const char * const OPCODE_NAMES[] = {
+    "LABEL", "UJUMP", "FJUMP", "HALT", "PUSH", "POP", "CALL", "RETURN",
+    "ADD", "SUB", "MUL", "DIV", "EQ", "LT", "LE", "NEG", "NOT", "AND", "OR", "FLOAT",
+    "FADD", "FSUB", "FMUL", "FDIV", "FEQ", "FLT", "FLE", "FNEG",
+    "LOAD", "ILOAD", "CHLOAD", "FLOAD", "XLOAD", "LOADX", "ALOAD", "LOADC", "CLOAD",
+    "ACOPY", "AFILL",
+    "READI", "READF", "READC", "WRITEI", "WRITEF", "WRITEC", "WRITES", "WRITELN", "NOOP",
+    "INVALID",
+    // superinstructions
+    "ADDI", "SUBI", "RSUBI", "MULI", "EQI", "LTI", "LEI", "GTI", "GEI",
+    "TJUMP", "BEQ", "BNE", "BLT", "BGE", "BLE", "BGT",
+    "BEQI", "BNEI", "BLTI", "BGEI", "BLEI", "BGTI",
+    "AADD", "ASUB", "AADDI", "ASUBI",
+    "LOADXL", "XLOADL"
+  };
+  static_assert(sizeof(OPCODE_NAMES) / sizeof(OPCODE_NAMES[0]) == Interpreter::NUMBER_OF_OPCODES,
+                "an opcode has no name");
+
+  // the 'n' first rows of the table, by decreasing count
+  template <typename Row>
+  void sortByCount(std::vector<Row> & rows, std::size_t n) {
+    std::stable_sort(rows.begin(), rows.end(),
+                     [](const Row & r1, const Row & r2) { return r1.count > r2.count; });
+    if (rows.size() > n) rows.resize(n);
+  }
+
+  const std::size_t HOT_LINES = 20;
+}
+
+std::uint32_t Interpreter::lineOf(std::uint32_t pc) const {
+  return pc < LineVec.size() ? LineVec[pc] : 0;
+}
+
+// The loops are the labels that are the target of a backward jump
+// (While and ACopy labels): their iterations are the executions of
+// the jump. ACOPY and AFILL are loops over the elements they move.
+void Interpreter::printProfile(const Profile & prof, std::ostream & os) const {
+  struct Row {
+    std::string   name;
+    std::uint32_t line;
+    std::uint64_t count;
+  };
+  struct SubrRow {
+    std::uint32_t subr;
+    std::uint64_t count;
+  };
+  std::ios::fmtflags flags = os.flags();
+  std::streamsize precision = os.precision();
+
+  std::uint64_t total = 0;
+  std::vector<std::uint64_t> self(Head.nsubrs, 0);
+  for (auto & node : prof.callTree) {
+    self[node.subr] += node.instructions;
+    total += node.instructions;
+  }
+  os << "instructions executed: " << total << std::endl << std::endl;
+
+  std::vector<SubrRow> subrRows;
+  for (std::uint32_t s = 0; s < Head.nsubrs; ++s)
+    if (prof.calls[s] > 0)
+      subrRows.push_back({s, self[s]});
+  sortByCount(subrRows, subrRows.size());
+  os << "subroutine                 calls   instructions   inclusive ms" << std::endl;
+  for (auto & row : subrRows)
+    os << std::left << std::setw(22) << Strings + Subrs[row.subr].name << std::right
+       << std::setw(10) << prof.calls[row.subr] << std::setw(15) << row.count
+       << std::setw(15) << std::fixed << std::setprecision(3) << prof.inclusiveMs[row.subr]
+       << std::endl;
+
+  std::vector<Row> loopRows, lineRows;
+  std::uint64_t opcodes[NUMBER_OF_OPCODES] = { 0 };
+  for (std::uint32_t s = 0; s < Head.nsubrs; ++s) {
+    const Subr & subr = Subrs[s];
+    std::string subrName = Strings + subr.name;
+    std::map<std::uint32_t, std::uint64_t> lines;
+    for (std::uint32_t pc = subr.first; pc < subr.first + subr.ninstrs; ++pc) {
+      const Instr & I = Instrs[pc];
+      if (I.op < NUMBER_OF_OPCODES) opcodes[I.op] += prof.executed[pc];
+      if (prof.executed[pc] > 0 and lineOf(pc) > 0) lines[lineOf(pc)] += prof.executed[pc];
+      if (I.op == instruction::_ACOPY or I.op == instruction::_AFILL)
+        loopRows.push_back({subrName + ":" + OPCODE_NAMES[I.op], lineOf(pc), prof.elements[pc]});
+      else if (I.op == instruction::_UJUMP and std::uint32_t(I.a) <= pc) {
+        std::string label = "?";
+        for (std::uint32_t l = subr.firstLabel; l < subr.firstLabel + subr.nlabels; ++l)
+          if (Labels[l].pc == std::uint32_t(I.a)) {
+            label = Strings + Labels[l].name;
+            break;
+          }
+        loopRows.push_back({subrName + ":" + label, lineOf(pc), prof.executed[pc]});
+      }
+    }
+    for (auto & line : lines)
+      lineRows.push_back({subrName, line.first, line.second});
+  }
+
+  sortByCount(loopRows, loopRows.size());
+  os << std::endl << "loop                         line     iterations" << std::endl;
+  for (auto & row : loopRows)
+    os << std::left << std::setw(26) << row.name << std::right << std::setw(7)
+       << (row.line > 0 ? std::to_string(row.line) : "-") << std::setw(15) << row.count << std::endl;
+
+  // (no lines in a binary t-code file)
+  if (not LineVec.empty()) {
+    sortByCount(lineRows, HOT_LINES);
+    os << std::endl << "line   subroutine             instructions" << std::endl;
+    for (auto & row : lineRows)
+      os << std::setw(4) << row.line << "   " << std::left << std::setw(20) << row.name
+         << std::right << std::setw(15) << row.count << std::endl;
+  }
+
+  std::vector<Row> opcodeRows;
+  for (std::uint32_t op = 0; op < NUMBER_OF_OPCODES; ++op)
+    if (opcodes[op] > 0)
+      opcodeRows.push_back({OPCODE_NAMES[op], 0, opcodes[op]});
+  sortByCount(opcodeRows, opcodeRows.size());
+  os << std::endl << "opcode         executed" << std::endl;
+  for (auto & row : opcodeRows)
+    os << std::left << std::setw(8) << row.name << std::right
+       << std::setw(15) << row.count << std::endl;
+
+  os.flags(flags);
+  os.precision(precision);
+}
+
+void Interpreter::printFlameGraph(const Profile & prof, std::ostream & os) const {
+  if (prof.callTree.empty()) return;
+  // depth-first, with the length of the path of the parent of each node
+  std::vector<std::pair<std::uint32_t, std::size_t>> pending(1, std::make_pair(0u, std::size_t(0)));
+  std::string path;
+  while (not pending.empty()) {
+    const Profile::CallNode & node = prof.callTree[pending.back().first];
+    path.resize(pending.back().second);
+    pending.pop_back();
+    if (not path.empty()) path += ';';
+    path += Strings + Subrs[node.subr].name;
+    if (node.instructions > 0)
+      os << path << ' ' << node.instructions << '\n';
+    for (auto & child : node.children)
+      pending.push_back(std::make_pair(child.second, path.size()));
+  }
+  os.flush();
+}
@@ -0,0 +1,302 @@
+/////////////////////////////////////////////////////////////////
+//
+//    Interpreter - t-code execution engine for the Asl programming language
+//
+//    Copyright (C) 2017-2023  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+
+#include <cstddef>    // std::size_t
+#include <cstdint>    // std::int32_t, std::uint32_t
+
+// using namespace std;
+
+
+////////////////////////////////////////////////////////////////////
+/// Class Interpreter executes the t-code of a whole program (class
+/// 'code') without going through its textual representation.
+///
+/// The constructor translates every subroutine into a flat array of
+/// fixed-width instructions: labels are resolved to program counters
+/// (through the labels of each subroutine), calls to subroutine
+/// indices, and every parameter, local variable and temporal to a
+/// slot of the frame of its subroutine. So no string is looked up
+/// while the program runs.
+///
+/// Frame of a subroutine (all slots are 32 bits wide):
+///   [ params (_result first) | local vars | temporals | pushed params ]
+/// The params of the callee are the slots its caller has pushed, and
+/// array addresses are (absolute) indices in the stack of slots.
+///
+/// Then the regular sequences of the generated code are fused into
+/// superinstructions (see fuseInstructions): a temporal that is only
+/// written by one instruction and read by the next one disappears
+/// with them, so the loop dispatches fewer instructions. The accesses
+/// to local arrays whose index is proven in bounds skip its check.
+///
+/// The compiled program (its "image") is also the binary t-code
+/// format: writeImage() saves it, and the constructor from a file
+/// name maps the file in memory and executes it in place.
+///
+/// Binary t-code (all fields are 32 bits, in host byte order):
+///   Header | Subr[nsubrs] | Instr[ninstrs] | Constant[nconsts] |
+///   Label[nlabels] | Symbol[nsymbols] | char strings[strsize]
+
+class Interpreter {
+
+ public:
+  /// one 32-bit memory cell: integers, booleans, characters and
+  /// addresses use 'i', floats use 'f'
+  union Value {
+    std::int32_t i;
+    float        f;
+  };
+
+  /// compiled instruction. 'op' is the instruction::Operation, 'mode'
+  /// selects the addressing variant, and a/b/c are the resolved
+  /// operands (slots, program counters, immediates, pool offsets...)
+  struct Instr {
+    std::uint16_t op;
+    std::uint16_t mode;
+    std::int32_t  a, b, c;
+  };
+
+  /// compiled subroutine
+  struct Subr {
+    std::uint32_t name;        // offset of the name in the string pool
+    std::uint32_t first;       // pc of its first instruction
+    std::uint32_t ninstrs;
+    std::uint32_t nparams;     // number of params (including _result)
+    std::uint32_t framesize;   // params + local vars + temporals
+    std::uint32_t extent;      // framesize + room for pushed params
+    std::uint32_t firstConst;  // constants stored in the frame on entry
+    std::uint32_t nconsts;
+    std::uint32_t firstLabel;  // labels of the subroutine
+    std::uint32_t nlabels;
+    std::uint32_t firstSymbol; // params, vars and temporals
+    std::uint32_t nsymbols;
+  };
+
+  /// constant operand copied into a frame slot on each call
+  struct Constant {
+    std::uint32_t slot;
+    Value         value;
+    std::uint32_t text;        // the constant as written in the t-code
+  };
+
+  /// label of a subroutine and its program counter
+  struct Label {
+    std::uint32_t name;
+    std::uint32_t pc;
+  };
+
+  /// name of each slot of a frame
+  struct Symbol {
+    std::uint32_t name;
+    std::uint32_t type;        // offset of the type name ("" for temporals)
+    std::uint32_t slot;
+    std::uint32_t kind;        // SYMBOL_PARAM, SYMBOL_VAR or SYMBOL_TEMP
+    std::uint32_t nelem;
+  };
+
+  /// header of the binary t-code format
+  struct Header {
+    char          magic[4];    // "ASLT"
+    std::uint32_t version;
+    std::uint32_t nsubrs;
+    std::uint32_t ninstrs;
+    std::uint32_t nconsts;
+    std::uint32_t nlabels;
+    std::uint32_t nsymbols;
+    std::uint32_t strsize;
+    std::uint32_t mainIndex;
+  };
+
+  /// superinstructions (Instr::op), after the instruction::Operation codes
+  enum Superinstruction {
+    // a = b op c, where c is an immediate (RSUBI: a = c - b)
+    _ADDI = instruction::_INVALID + 1, _SUBI, _RSUBI, _MULI,
+    _EQI, _LTI, _LEI, _GTI, _GEI,
+    // goto c if (a op b) / if (a op immediate b); TJUMP: goto b if a
+    _TJUMP,
+    _BEQ,  _BNE,  _BLT,  _BGE,  _BLE,  _BGT,
+    _BEQI, _BNEI, _BLTI, _BGEI, _BLEI, _BGTI,
+    // a[b] = a[b] op c (AADDI, ASUBI: c is an immediate)
+    _AADD, _ASUB, _AADDI, _ASUBI,
+    // a = b[c] and a[b] = c of a local array, with no check of the index
+    // (proven in its bounds: see inBoundsAccesses)
+    _LOADXL, _XLOADL,
+    NUMBER_OF_OPCODES
+  };
+
+  static const std::uint32_t BINARY_VERSION = 3;
+
+  /// addressing variants (Instr::mode)
+  static const std::uint16_t MODE_LOCAL_ARRAY = 1;  // array operand is a local var
+  static const std::uint16_t MODE_HAS_ARG     = 2;  // PUSH/POP with an operand
+  static const std::uint16_t MODE_LOCAL_ARRAY2 = 4; // second array operand (ACOPY) is a local var
+  static const std::uint16_t MODE_IN_BOUNDS   = 8;  // index proven in bounds (only while compiling)
+
+  /// kinds of symbols
+  static const std::uint32_t SYMBOL_PARAM = 0;
+  static const std::uint32_t SYMBOL_VAR   = 1;
+  static const std::uint32_t SYMBOL_TEMP  = 2;
+
+  /// constructor: compile the program
+  Interpreter(const code & program);
+  /// constructor: map a binary t-code file
+  Interpreter(const std::string & binaryFileName);
+  ~Interpreter();
+
+  /// true if the program could not be compiled or loaded (see getErrorMessage)
+  bool hasErrors() const;
+  const std::string & getErrorMessage() const;
+
+  /// execute the program, starting at 'main'. Returns EXIT_SUCCESS,
+  /// or EXIT_FAILURE if the program has been halted (and the reason
+  /// is written to 'err')
+  int run(std::istream & in = std::cin, std::ostream & out = std::cout,
+          std::ostream & err = std::cerr) const;
+
+  /// write the compiled program in binary t-code format
+  void writeImage(std::ostream & os) const;
+
+  /// what has been executed by profile(). Vectors indexed by pc have
+  /// an entry per instruction of the image, the ones indexed by
+  /// subroutine an entry per subroutine
+  struct Profile {
+    /// node of the call tree: the instructions executed by one
+    /// subroutine (not by its callees) when called through the path
+    /// from the root (main, node 0) to the node
+    struct CallNode {
+      std::uint32_t                          subr;
+      std::uint32_t                          parent;
+      std::uint64_t                          instructions;
+      std::map<std::uint32_t, std::uint32_t> children;   // subr -> node
+    };
+    std::vector<std::uint64_t> executed;     // times each pc has been executed
+    std::vector<std::uint64_t> elements;     // elements copied or filled (ACOPY and AFILL)
+    std::vector<std::uint64_t> calls;        // calls to each subroutine
+    std::vector<double>        inclusiveMs;  // time inside each subroutine and its callees
+    std::vector<CallNode>      callTree;
+  };
+
+  /// execute the program as run() does, recording its execution in
+  /// 'prof' (slower: only for --profile)
+  int profile(std::istream & in, std::ostream & out, Profile & prof,
+              std::ostream & err = std::cerr) const;
+  /// print the profile as tables: subroutines, loops, source lines
+  /// and opcodes. The lines are only known for a compiled program
+  void printProfile(const Profile & prof, std::ostream & os) const;
+  /// print the call tree as folded stacks ("main;f;g 1234", the
+  /// instructions executed by g), the input of flamegraph.pl
+  void printFlameGraph(const Profile & prof, std::ostream & os) const;
+
+ private:
+  /// compiled program (see compileProgram)
+  std::vector<Instr>    InstrVec;
+  std::vector<Subr>     SubrVec;
+  std::vector<Constant> ConstVec;
+  std::vector<Label>    LabelVec;
+  std::vector<Symbol>   SymbolVec;
+  std::string           StringPool;
+  std::map<std::string, std::uint32_t> StringOffsets;
+  /// source line of each compiled instruction (not in the image: empty
+  /// for a mapped file)
+  std::vector<std::uint32_t> LineVec;
+
+  /// image being executed: the compiled program or a mapped file
+  Header           Head;
+  const Subr     * Subrs;
+  const Instr    * Instrs;
+  const Constant * Consts;
+  const Label    * Labels;
+  const Symbol   * Symbols;
+  const char     * Strings;
+
+  void        * MappedAddr;
+  std::size_t   MappedSize;
+
+  std::string ErrorMessage;
+
+  /// information about the subroutine being compiled
+  struct SubrCompiler {
+    std::map<operand, std::uint32_t>     slots;
+    std::map<operand, std::uint32_t>     constSlots;
+    std::map<operand, bool>              isLocalVar;
+    std::uint32_t                        nslots;
+    std::string                          name;
+    const subroutine                   * subr;
+  };
+
+  // the image is referenced by pointers: objects cannot be copied
+  Interpreter(const Interpreter &);
+  Interpreter & operator=(const Interpreter &);
+
+  void compileProgram(const code & program);
+  void compileSubroutine(const subroutine & subr,
+                         const std::map<std::string, std::uint32_t> & subrIndex);
+  Instr compileInstruction(const instruction & instr, SubrCompiler & sc,
+                           const std::map<std::string, std::uint32_t> & subrIndex,
+                           bool & valid);
+  void setImageToCompiledProgram();
+  void loadImage(const std::string & binaryFileName);
+  bool validImage(const char * base, std::size_t size);
+
+  std::int32_t destOperand(const operand & arg, SubrCompiler & sc, bool & valid);
+  std::int32_t valueOperand(const operand & arg, SubrCompiler & sc, bool & valid);
+  std::int32_t arrayOperand(const operand & arg, SubrCompiler & sc,
+                            std::uint16_t & mode, bool & valid,
+                            std::uint16_t localMode = MODE_LOCAL_ARRAY);
+  void addSymbol(const std::string & name, const std::string & type,
+                 std::uint32_t slot, std::uint32_t kind, std::uint32_t nelem);
+  std::uint32_t addString(const std::string & s);
+
+  void fuseInstructions(std::uint32_t first, const std::vector<bool> & singleUse,
+                        std::uint32_t labelsFrom, std::vector<std::uint32_t> & fusedPc);
+  static bool fusePair(const Instr & i1, const Instr & i2,
+                       const std::vector<bool> & singleUse, Instr & fused);
+  static bool fuseArrayUpdate(const Instr & i1, const Instr & i2, const Instr & i3,
+                              const std::vector<bool> & singleUse, Instr & fused);
+
+  void error(const std::string & subrName, const std::string & message);
+
+  static Value constValue(const operand & arg);
+  static std::string unescapeString(const std::string & arg);
+
+  static void halt(std::ostream & err, const char * message);
+
+  /// the loop of run() and profile(); 'prof' is only used if PROFILE
+  template <bool PROFILE>
+  int execute(std::istream & in, std::ostream & out, std::ostream & err, Profile * prof) const;
+  std::uint32_t lineOf(std::uint32_t pc) const;
+};
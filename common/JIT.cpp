@@ -0,0 +1,335 @@
+/////////////////////////////////////////////////////////////////
+//
+//    JIT - in-process execution of the LLVM code for the Asl programming language
+//
+//    Copyright (C) 2017-2023  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include "JIT.h"
+
+#include <vector>
+#include <iostream>
+#include <cstdio>     // std::fflush
+#include <cstdlib>    // std::exit, EXIT_FAILURE
+#include <cstdint>    // std::uintptr_t
+
+#ifdef WITH_LLVM
+#include <llvm-c/Core.h>
+#include <llvm-c/Analysis.h>
+#include <llvm-c/IRReader.h>
+#include <llvm-c/Target.h>
+#include <llvm-c/TargetMachine.h>
+#include <llvm-c/Orc.h>
+#include <llvm-c/LLJIT.h>
+#include <llvm-c/Transforms/PassBuilder.h>
+#endif
+
+// using namespace std;
+
+
+#ifdef WITH_LLVM
+
+// the JIT, the stubs of the functions not compiled yet, and the
+// target machine of the optimization passes
+struct JIT::Impl {
+  LLVMOrcLLJITRef                  LLJIT    = nullptr;
+  LLVMOrcIndirectStubsManagerRef   Stubs    = nullptr;
+  LLVMOrcLazyCallThroughManagerRef Lazy     = nullptr;
+  LLVMTargetMachineRef             Machine  = nullptr;
+  std::string                      Pipeline;
+
+  // name of the definition of a function in its own module (the
+  // function name itself is its lazy stub)
+  static std::string bodyName(const std::string & funcName) {
+    return funcName + ".body";
+  }
+
+  static std::string takeError(LLVMErrorRef error) {
+    char *msg = LLVMGetErrorMessage(error);
+    std::string str = msg;
+    LLVMDisposeErrorMessage(msg);
+    return str;
+  }
+
+  // a function is compiled when a stub is first called: if that
+  // fails there is no way back to the caller
+  static void lazyCompileFailed() {
+    std::cerr << "JIT: cannot compile the called function" << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
+  // IR transform of the JIT: the optimization pipeline, run on each
+  // module when its function is compiled
+  static LLVMErrorRef optimizeModule(void *ctx, LLVMModuleRef module) {
+    Impl *impl = static_cast<Impl *>(ctx);
+    LLVMPassBuilderOptionsRef options = LLVMCreatePassBuilderOptions();
+    LLVMErrorRef error = LLVMRunPasses(module, impl->Pipeline.c_str(), impl->Machine, options);
+    LLVMDisposePassBuilderOptions(options);
+    return error;
+  }
+  static LLVMErrorRef optimize(void *ctx, LLVMOrcThreadSafeModuleRef *moduleInOut,
+                               LLVMOrcMaterializationResponsibilityRef) {
+    return LLVMOrcThreadSafeModuleWithModuleDo(*moduleInOut, optimizeModule, ctx);
+  }
+
+  // remove the body of a function (it becomes a declaration)
+  static void deleteBody(LLVMValueRef func) {
+    for (LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(func); bb; bb = LLVMGetNextBasicBlock(bb))
+      for (LLVMValueRef i = LLVMGetFirstInstruction(bb); i; i = LLVMGetNextInstruction(i))
+        if (LLVMGetTypeKind(LLVMTypeOf(i)) != LLVMVoidTypeKind)
+          LLVMReplaceAllUsesWith(i, LLVMGetUndef(LLVMTypeOf(i)));
+    for (LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(func); bb; bb = LLVMGetNextBasicBlock(bb))
+      while (LLVMValueRef i = LLVMGetFirstInstruction(bb))
+        LLVMInstructionEraseFromParent(i);
+    while (LLVMBasicBlockRef bb = LLVMGetFirstBasicBlock(func))
+      LLVMDeleteBasicBlock(bb);
+  }
+
+  // the module of function 'funcName': a copy of the program where
+  // the other functions are declarations, the constants are internal
+  // and the function is renamed to its body name. The internal
+  // functions (the read/write runtime) keep their body, to be inlined,
+  // and the variables are declarations of the ones of the data module
+  static LLVMModuleRef functionModule(LLVMModuleRef program, const std::string & funcName) {
+    LLVMModuleRef module = LLVMCloneModule(program);
+    LLVMValueRef  body   = nullptr;
+    for (LLVMValueRef f = LLVMGetFirstFunction(module); f; f = LLVMGetNextFunction(f)) {
+      if (LLVMIsDeclaration(f)) continue;
+      std::size_t len;
+      const char *name = LLVMGetValueName2(f, &len);
+      if (std::string(name, len) == funcName)
+        body = f;
+      else if (LLVMGetLinkage(f) != LLVMInternalLinkage)
+        deleteBody(f);
+    }
+    std::vector<LLVMValueRef> variables;
+    for (LLVMValueRef g = LLVMGetFirstGlobal(module); g; g = LLVMGetNextGlobal(g)) {
+      if (LLVMIsGlobalConstant(g))
+        LLVMSetLinkage(g, LLVMInternalLinkage);
+      else
+        variables.push_back(g);
+    }
+    for (LLVMValueRef g : variables) {
+      std::size_t len;
+      std::string name = LLVMGetValueName2(g, &len);
+      LLVMSetValueName2(g, "", 0);
+      LLVMValueRef decl = LLVMAddGlobal(module, LLVMGlobalGetValueType(g), name.c_str());
+      LLVMReplaceAllUsesWith(g, decl);
+      LLVMDeleteGlobal(g);
+    }
+    std::string name = bodyName(funcName);
+    LLVMSetValueName2(body, name.data(), name.size());
+    LLVMSetLinkage(body, LLVMExternalLinkage);
+    return module;
+  }
+
+  // the module of the variables of the program (the buffers of the
+  // runtime), shared by all the functions
+  static LLVMModuleRef dataModule(LLVMModuleRef program) {
+    LLVMModuleRef module = LLVMCloneModule(program);
+    for (LLVMValueRef f = LLVMGetFirstFunction(module); f; f = LLVMGetNextFunction(f))
+      deleteBody(f);
+    while (LLVMValueRef f = LLVMGetFirstFunction(module))
+      LLVMDeleteFunction(f);
+    for (LLVMValueRef g = LLVMGetFirstGlobal(module); g; g = LLVMGetNextGlobal(g))
+      LLVMSetLinkage(g, LLVMIsGlobalConstant(g) ? LLVMInternalLinkage : LLVMExternalLinkage);
+    return module;
+  }
+};
+
+JIT::JIT(const std::string & llvmCode, int optLevel) :
+  State{new Impl}, OptLevel{optLevel < 0 ? 0 : (optLevel > 3 ? 3 : optLevel)} {
+  LLVMInitializeNativeTarget();
+  LLVMInitializeNativeAsmPrinter();
+
+  LLVMErrorRef error = LLVMOrcCreateLLJIT(&State->LLJIT, nullptr);
+  if (error) {
+    ErrorMessage = "cannot create the JIT: " + Impl::takeError(error);
+    return;
+  }
+  const char *triple = LLVMOrcLLJITGetTripleString(State->LLJIT);
+  LLVMOrcExecutionSessionRef session = LLVMOrcLLJITGetExecutionSession(State->LLJIT);
+  LLVMOrcJITDylibRef         dylib   = LLVMOrcLLJITGetMainJITDylib(State->LLJIT);
+
+  // read, write, snprintf, strtof and exit come from the compiler process
+  LLVMOrcDefinitionGeneratorRef process;
+  error = LLVMOrcCreateDynamicLibrarySearchGeneratorForProcess(
+            &process, LLVMOrcLLJITGetGlobalPrefix(State->LLJIT), nullptr, nullptr);
+  if (error) {
+    ErrorMessage = "cannot link the JIT with the C library: " + Impl::takeError(error);
+    return;
+  }
+  LLVMOrcJITDylibAddGenerator(dylib, process);
+
+  // the lazy compilation stubs
+  State->Stubs = LLVMOrcCreateLocalIndirectStubsManager(triple);
+  error = LLVMOrcCreateLocalLazyCallThroughManager(
+            triple, session,
+            static_cast<LLVMOrcJITTargetAddress>(reinterpret_cast<std::uintptr_t>(&Impl::lazyCompileFailed)),
+            &State->Lazy);
+  if (error) {
+    ErrorMessage = "cannot create the JIT stubs: " + Impl::takeError(error);
+    return;
+  }
+
+  // the optimization passes
+  if (OptLevel > 0) {
+    LLVMTargetRef target;
+    char *msg = nullptr;
+    if (not LLVMGetTargetFromTriple(triple, &target, &msg)) {
+      static const LLVMCodeGenOptLevel codeGenLevel[] = {
+        LLVMCodeGenLevelNone, LLVMCodeGenLevelLess, LLVMCodeGenLevelDefault, LLVMCodeGenLevelAggressive
+      };
+      char *cpu      = LLVMGetHostCPUName();
+      char *features = LLVMGetHostCPUFeatures();
+      State->Machine = LLVMCreateTargetMachine(target, triple, cpu, features, codeGenLevel[OptLevel],
+                                               LLVMRelocDefault, LLVMCodeModelJITDefault);
+      LLVMDisposeMessage(cpu);
+      LLVMDisposeMessage(features);
+    }
+    if (msg) LLVMDisposeMessage(msg);
+    State->Pipeline = "default<O" + std::to_string(OptLevel) + ">";
+    LLVMOrcIRTransformLayerSetTransform(LLVMOrcLLJITGetIRTransformLayer(State->LLJIT),
+                                        Impl::optimize, State);
+  }
+
+  // parse and verify the program
+  LLVMOrcThreadSafeContextRef tsContext = LLVMOrcCreateNewThreadSafeContext();
+  LLVMContextRef context = LLVMOrcThreadSafeContextGetContext(tsContext);
+  LLVMMemoryBufferRef buffer =
+    LLVMCreateMemoryBufferWithMemoryRangeCopy(llvmCode.data(), llvmCode.size(), "asl");
+  LLVMModuleRef program;
+  char *msg = nullptr;
+  if (LLVMParseIRInContext(context, buffer, &program, &msg) or
+      LLVMVerifyModule(program, LLVMReturnStatusAction, &msg)) {
+    ErrorMessage = "invalid LLVM code: " + std::string(msg ? msg : "");
+    if (msg) LLVMDisposeMessage(msg);
+    LLVMOrcDisposeThreadSafeContext(tsContext);
+    return;
+  }
+  if (msg) LLVMDisposeMessage(msg);
+  LLVMSetTarget(program, triple);
+  LLVMSetDataLayout(program, LLVMOrcLLJITGetDataLayoutStr(State->LLJIT));
+
+  // the variables, one module per (not internal) function, and its
+  // stub in the main library
+  std::vector<std::string> funcNames;
+  for (LLVMValueRef f = LLVMGetFirstFunction(program); f; f = LLVMGetNextFunction(f)) {
+    std::size_t len;
+    const char *name = LLVMGetValueName2(f, &len);
+    if (not LLVMIsDeclaration(f) and LLVMGetLinkage(f) != LLVMInternalLinkage)
+      funcNames.push_back(std::string(name, len));
+  }
+  error = LLVMOrcLLJITAddLLVMIRModule(State->LLJIT, dylib,
+                                      LLVMOrcCreateNewThreadSafeModule(Impl::dataModule(program), tsContext));
+  if (error)
+    ErrorMessage = "cannot add the variables to the JIT: " + Impl::takeError(error);
+  std::vector<LLVMOrcCSymbolAliasMapPair> stubs;
+  for (const std::string & funcName : funcNames) {
+    if (not ErrorMessage.empty()) break;
+    LLVMModuleRef module = Impl::functionModule(program, funcName);
+    error = LLVMOrcLLJITAddLLVMIRModule(State->LLJIT, dylib,
+                                        LLVMOrcCreateNewThreadSafeModule(module, tsContext));
+    if (error) {
+      ErrorMessage = "cannot add " + funcName + " to the JIT: " + Impl::takeError(error);
+      break;
+    }
+    LLVMOrcCSymbolAliasMapPair stub;
+    stub.Name         = LLVMOrcLLJITMangleAndIntern(State->LLJIT, funcName.c_str());
+    stub.Entry.Name   = LLVMOrcLLJITMangleAndIntern(State->LLJIT, Impl::bodyName(funcName).c_str());
+    stub.Entry.Flags  = { LLVMJITSymbolGenericFlagsExported | LLVMJITSymbolGenericFlagsCallable, 0 };
+    stubs.push_back(stub);
+  }
+  LLVMDisposeModule(program);
+  LLVMOrcDisposeThreadSafeContext(tsContext);
+  if (not ErrorMessage.empty()) {
+    for (auto & stub : stubs) {
+      LLVMOrcReleaseSymbolStringPoolEntry(stub.Name);
+      LLVMOrcReleaseSymbolStringPoolEntry(stub.Entry.Name);
+    }
+  }
+  else if (not stubs.empty()) {
+    LLVMOrcMaterializationUnitRef reexports =
+      LLVMOrcLazyReexports(State->Lazy, State->Stubs, dylib, stubs.data(), stubs.size());
+    error = LLVMOrcJITDylibDefine(dylib, reexports);
+    if (error)
+      ErrorMessage = "cannot define the JIT stubs: " + Impl::takeError(error);
+  }
+}
+
+JIT::~JIT() {
+  if (State->LLJIT)   LLVMOrcDisposeLLJIT(State->LLJIT);
+  if (State->Lazy)    LLVMOrcDisposeLazyCallThroughManager(State->Lazy);
+  if (State->Stubs)   LLVMOrcDisposeIndirectStubsManager(State->Stubs);
+  if (State->Machine) LLVMDisposeTargetMachine(State->Machine);
+  delete State;
+}
+
+bool JIT::isAvailable() {
+  return true;
+}
+
+int JIT::run() {
+  LLVMOrcExecutorAddress mainAddr;
+  LLVMErrorRef error = LLVMOrcLLJITLookup(State->LLJIT, &mainAddr, "main");
+  if (error) {
+    std::cerr << "JIT: no main function: " << Impl::takeError(error) << std::endl;
+    return EXIT_FAILURE;
+  }
+  int (*mainFunc)() = reinterpret_cast<int (*)()>(static_cast<std::uintptr_t>(mainAddr));
+  int status = mainFunc();
+  std::fflush(stdout);
+  return status;
+}
+
+#else
+
+struct JIT::Impl {
+};
+
+JIT::JIT(const std::string & llvmCode, int optLevel) :
+  State{nullptr}, OptLevel{optLevel},
+  ErrorMessage{"the JIT is not available (build the compiler with make WITH_LLVM=1)"} {
+}
+
+JIT::~JIT() {
+}
+
+bool JIT::isAvailable() {
+  return false;
+}
+
+int JIT::run() {
+  return EXIT_FAILURE;
+}
+
+#endif
+
+bool JIT::hasErrors() const {
+  return not ErrorMessage.empty();
+}
+
+const std::string & JIT::getErrorMessage() const {
+  return ErrorMessage;
+}
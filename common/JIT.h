@@ -0,0 +1,78 @@
+/////////////////////////////////////////////////////////////////
+//
+//    JIT - in-process execution of the LLVM code for the Asl programming language
+//
+//    Copyright (C) 2017-2023  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+
+// using namespace std;
+
+
+////////////////////////////////////////////////////////////////////
+/// Class JIT executes the LLVM code of a program (the text of
+/// code::dumpLLVM) in the compiler process, with the ORC LLJIT of the
+/// LLVM libraries.
+///
+/// Every function is compiled (and optimized, by the pass pipeline
+/// of the optimization level) on its first call: the module is split
+/// in one module per function, where the other functions are only
+/// declared and their calls go through lazy call-through stubs. The
+/// format strings and the scratch globals of read are private to
+/// each module; printf, putchar, scanf and exit are the ones of the
+/// compiler process.
+///
+/// It is only available if the compiler is built with LLVM
+/// (make WITH_LLVM=1); otherwise the constructor fails.
+
+class JIT {
+
+ public:
+  /// constructor: prepare the lazy compilation of the LLVM code
+  /// (with LLVM optimization level 0..3)
+  JIT(const std::string & llvmCode, int optLevel = 0);
+  ~JIT();
+
+  JIT(const JIT &) = delete;
+  JIT & operator=(const JIT &) = delete;
+
+  /// true if the compiler has been built with LLVM
+  static bool isAvailable();
+
+  /// true if the LLVM code could not be prepared (see getErrorMessage)
+  bool hasErrors() const;
+  const std::string & getErrorMessage() const;
+
+  /// execute the program (its main function) and return its exit status
+  int run();
+
+ private:
+  struct Impl;
+  Impl        *State;
+  int         OptLevel;
+  std::string ErrorMessage;
+};
@@ -28,11 +28,13 @@
 
 
 #include "LLVMCodeGen.h"
+#include "ControlFlow.h"
 #include "SymTable.h"
 #include "TypesMgr.h"
 #include "code.h"
 
 #include <string>
+#include <sstream>
 #include <cctype>
 // uncomment to disable assert()
 // #define NDEBUG
@@ -105,76 +107,438 @@ const std::map<instruction::Operation, std::string> LLVMCodeGen::tcode2llvmInstr
 };
 
 
+namespace {
+
+  // The runtime of read and write, in the generated code itself (the
+  // executables only need the C library). The output is kept in a
+  // buffer that is written when it is full, before waiting for input,
+  // at HALT and at the end of main. The input is read in big blocks
+  // and tokenized by hand with the rules of the interpreter (see
+  // ProgramIO.h): spaces are skipped and, once a read fails, every read
+  // gets 0. Each piece is only added if the program uses it
+
+  // the buffer of the output, written with write(2)
+  const char * const RuntimeOutput = R"(
+@.rt.out = internal global [65536 x i8] zeroinitializer
+@.rt.out.size = internal global i64 0
+
+declare dso_local i64 @write(i32, i8*, i64)
+
+define internal void @.rt.flush() {
+.entry:
+  %n = load i64, i64* @.rt.out.size
+  store i64 0, i64* @.rt.out.size
+  br label %.loop
+.loop:
+  %done = phi i64 [ 0, %.entry ], [ %done.next, %.written ]
+  %left = sub i64 %n, %done
+  %empty = icmp sle i64 %left, 0
+  br i1 %empty, label %.end, label %.write
+.write:
+  %p = getelementptr inbounds [65536 x i8], [65536 x i8]* @.rt.out, i64 0, i64 %done
+  %w = call i64 @write(i32 1, i8* %p, i64 %left)
+  %error = icmp sle i64 %w, 0
+  br i1 %error, label %.end, label %.written
+.written:
+  %done.next = add i64 %done, %w
+  br label %.loop
+.end:
+  ret void
+}
+
+define internal i8* @.rt.reserve(i64 %k) {
+.entry:
+  %n = load i64, i64* @.rt.out.size
+  %m = add i64 %n, %k
+  %full = icmp ugt i64 %m, 65536
+  br i1 %full, label %.flush, label %.end
+.flush:
+  call void @.rt.flush()
+  br label %.end
+.end:
+  %size = load i64, i64* @.rt.out.size
+  %p = getelementptr inbounds [65536 x i8], [65536 x i8]* @.rt.out, i64 0, i64 %size
+  %size.next = add i64 %size, %k
+  store i64 %size.next, i64* @.rt.out.size
+  ret i8* %p
+}
+)";
+
+  // an int, formatted by hand
+  const char * const RuntimeWriteInt = R"(
+define internal void @.rt.write.i(i32 %x) {
+.entry:
+  %neg = icmp slt i32 %x, 0
+  %minus.x = sub i32 0, %x
+  %u = select i1 %neg, i32 %minus.x, i32 %x
+  br label %.count
+.count:
+  %ndigits = phi i64 [ 1, %.entry ], [ %ndigits.next, %.count.next ]
+  %t = phi i32 [ %u, %.entry ], [ %t.next, %.count.next ]
+  %big = icmp uge i32 %t, 10
+  br i1 %big, label %.count.next, label %.counted
+.count.next:
+  %t.next = udiv i32 %t, 10
+  %ndigits.next = add i64 %ndigits, 1
+  br label %.count
+.counted:
+  %sign = zext i1 %neg to i64
+  %len = add i64 %ndigits, %sign
+  %p = call i8* @.rt.reserve(i64 %len)
+  br i1 %neg, label %.minus, label %.digits
+.minus:
+  store i8 45, i8* %p
+  br label %.digits
+.digits:
+  %i = phi i64 [ %len, %.counted ], [ %len, %.minus ], [ %i.next, %.digits ]
+  %v = phi i32 [ %u, %.counted ], [ %u, %.minus ], [ %v.next, %.digits ]
+  %i.next = sub i64 %i, 1
+  %digit = urem i32 %v, 10
+  %v.next = udiv i32 %v, 10
+  %digit.i8 = trunc i32 %digit to i8
+  %char = add i8 %digit.i8, 48
+  %pi = getelementptr inbounds i8, i8* %p, i64 %i.next
+  store i8 %char, i8* %pi
+  %more = icmp ne i32 %v.next, 0
+  br i1 %more, label %.digits, label %.end
+.end:
+  ret void
+}
+)";
+
+  // a float, with "%g" (as the interpreter)
+  const char * const RuntimeWriteFloat = R"(
+declare dso_local i32 @snprintf(i8*, i64, i8*, ...)
+
+define internal void @.rt.write.f(double %x) {
+.entry:
+  %p = call i8* @.rt.reserve(i64 32)
+  %n = call i32 (i8*, i64, i8*, ...) @snprintf(i8* %p, i64 32, i8* getelementptr inbounds ([3 x i8], [3 x i8]* @.str.f, i64 0, i64 0), double %x)
+  %unused = sub i32 32, %n
+  %unused.i64 = sext i32 %unused to i64
+  %size = load i64, i64* @.rt.out.size
+  %size.next = sub i64 %size, %unused.i64
+  store i64 %size.next, i64* @.rt.out.size
+  ret void
+}
+)";
+
+  // a char
+  const char * const RuntimeWriteChar = R"(
+define internal void @.rt.write.c(i32 %c) {
+.entry:
+  %p = call i8* @.rt.reserve(i64 1)
+  %c.i8 = trunc i32 %c to i8
+  store i8 %c.i8, i8* %p
+  ret void
+}
+)";
+
+  // a string (straight with write(2) if it does not fit in the buffer)
+  const char * const RuntimeWriteString = R"(
+define internal void @.rt.write.s(i8* %s, i64 %n) {
+.entry:
+  %big = icmp ugt i64 %n, 65536
+  br i1 %big, label %.direct, label %.copy
+.direct:
+  call void @.rt.flush()
+  br label %.loop
+.loop:
+  %done = phi i64 [ 0, %.direct ], [ %done.next, %.written ]
+  %left = sub i64 %n, %done
+  %empty = icmp sle i64 %left, 0
+  br i1 %empty, label %.end, label %.write
+.write:
+  %ps = getelementptr inbounds i8, i8* %s, i64 %done
+  %w = call i64 @write(i32 1, i8* %ps, i64 %left)
+  %error = icmp sle i64 %w, 0
+  br i1 %error, label %.end, label %.written
+.written:
+  %done.next = add i64 %done, %w
+  br label %.loop
+.copy:
+  %p = call i8* @.rt.reserve(i64 %n)
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %p, i8* %s, i64 %n, i1 false)
+  br label %.end
+.end:
+  ret void
+}
+)";
+
+  // the buffer of the input, read with read(2) after flushing the output
+  const char * const RuntimeInput = R"(
+@.rt.in = internal global [65536 x i8] zeroinitializer
+@.rt.in.pos = internal global i64 0
+@.rt.in.end = internal global i64 0
+@.rt.in.failed = internal global i1 false
+
+declare dso_local i64 @read(i32, i8*, i64)
+
+define internal i32 @.rt.peek() {
+.entry:
+  %pos = load i64, i64* @.rt.in.pos
+  %end = load i64, i64* @.rt.in.end
+  %avail = icmp ult i64 %pos, %end
+  br i1 %avail, label %.get, label %.fill
+.fill:
+  call void @.rt.flush()
+  %buf = getelementptr inbounds [65536 x i8], [65536 x i8]* @.rt.in, i64 0, i64 0
+  %r = call i64 @read(i32 0, i8* %buf, i64 65536)
+  %eof = icmp sle i64 %r, 0
+  br i1 %eof, label %.eof, label %.filled
+.eof:
+  ret i32 -1
+.filled:
+  store i64 0, i64* @.rt.in.pos
+  store i64 %r, i64* @.rt.in.end
+  br label %.get
+.get:
+  %i = phi i64 [ %pos, %.entry ], [ 0, %.filled ]
+  %p = getelementptr inbounds [65536 x i8], [65536 x i8]* @.rt.in, i64 0, i64 %i
+  %c = load i8, i8* %p
+  %c.i32 = zext i8 %c to i32
+  ret i32 %c.i32
+}
+
+define internal void @.rt.next() {
+.entry:
+  %pos = load i64, i64* @.rt.in.pos
+  %pos.next = add i64 %pos, 1
+  store i64 %pos.next, i64* @.rt.in.pos
+  ret void
+}
+
+define internal i1 @.rt.isdigit(i32 %c) {
+.entry:
+  %d = sub i32 %c, 48
+  %is = icmp ult i32 %d, 10
+  ret i1 %is
+}
+
+define internal i1 @.rt.skipspaces() {
+.entry:
+  %failed = load i1, i1* @.rt.in.failed
+  br i1 %failed, label %.fail, label %.loop
+.loop:
+  %c = call i32 @.rt.peek()
+  %eof = icmp eq i32 %c, -1
+  br i1 %eof, label %.setfail, label %.test
+.test:
+  %space = icmp eq i32 %c, 32
+  %ctl = sub i32 %c, 9
+  %isctl = icmp ult i32 %ctl, 5
+  %skip = or i1 %space, %isctl
+  br i1 %skip, label %.skip, label %.ok
+.skip:
+  call void @.rt.next()
+  br label %.loop
+.ok:
+  ret i1 true
+.setfail:
+  store i1 true, i1* @.rt.in.failed
+  br label %.fail
+.fail:
+  ret i1 false
+}
+)";
+
+  // an int
+  const char * const RuntimeReadInt = R"(
+define internal void @.rt.read.i(i32* %p) {
+.entry:
+  store i32 0, i32* %p
+  %ok = call i1 @.rt.skipspaces()
+  br i1 %ok, label %.sign, label %.end
+.sign:
+  %c0 = call i32 @.rt.peek()
+  %minus = icmp eq i32 %c0, 45
+  %plus = icmp eq i32 %c0, 43
+  %hassign = or i1 %minus, %plus
+  br i1 %hassign, label %.skipsign, label %.first
+.skipsign:
+  call void @.rt.next()
+  br label %.first
+.first:
+  %c1 = call i32 @.rt.peek()
+  %digit1 = call i1 @.rt.isdigit(i32 %c1)
+  %limit = select i1 %minus, i64 2147483648, i64 2147483647
+  br i1 %digit1, label %.loop, label %.fail
+.loop:
+  %v = phi i64 [ 0, %.first ], [ %v.next, %.digit ]
+  %over = phi i1 [ false, %.first ], [ %over.next, %.digit ]
+  %c = call i32 @.rt.peek()
+  %isdigit = call i1 @.rt.isdigit(i32 %c)
+  br i1 %isdigit, label %.digit, label %.done
+.digit:
+  call void @.rt.next()
+  %v10 = mul i64 %v, 10
+  %d = sub i32 %c, 48
+  %d.i64 = zext i32 %d to i64
+  %v1 = add i64 %v10, %d.i64
+  %big = icmp sgt i64 %v1, %limit
+  %v.next = select i1 %big, i64 %limit, i64 %v1
+  %over.next = or i1 %over, %big
+  br label %.loop
+.done:
+  %minus.v = sub i64 0, %v
+  %value = select i1 %minus, i64 %minus.v, i64 %v
+  %value.i32 = trunc i64 %value to i32
+  store i32 %value.i32, i32* %p
+  br i1 %over, label %.fail, label %.end
+.fail:
+  store i1 true, i1* @.rt.in.failed
+  br label %.end
+.end:
+  ret void
+}
+)";
+
+  // a float: [sign] digits [. digits] [e [sign] digits], converted by strtof
+  const char * const RuntimeReadFloat = R"(
+declare dso_local float @strtof(i8*, i8**)
+
+define internal void @.rt.take(i8* %buf, i64* %n) {
+.entry:
+  %c = call i32 @.rt.peek()
+  call void @.rt.next()
+  %len = load i64, i64* %n
+  %room = icmp ult i64 %len, 64
+  br i1 %room, label %.store, label %.end
+.store:
+  %p = getelementptr inbounds i8, i8* %buf, i64 %len
+  %c.i8 = trunc i32 %c to i8
+  store i8 %c.i8, i8* %p
+  %len.next = add i64 %len, 1
+  store i64 %len.next, i64* %n
+  br label %.end
+.end:
+  ret void
+}
+
+define internal i1 @.rt.issign(i32 %c) {
+.entry:
+  %minus = icmp eq i32 %c, 45
+  %plus = icmp eq i32 %c, 43
+  %is = or i1 %minus, %plus
+  ret i1 %is
+}
+
+define internal void @.rt.read.f(float* %p) {
+.entry:
+  %chars = alloca [65 x i8]
+  %n = alloca i64
+  %endp = alloca i8*
+  %buf = getelementptr inbounds [65 x i8], [65 x i8]* %chars, i64 0, i64 0
+  store i64 0, i64* %n
+  store float 0.0, float* %p
+  %ok = call i1 @.rt.skipspaces()
+  br i1 %ok, label %.sign, label %.end
+.sign:
+  %c0 = call i32 @.rt.peek()
+  %sign = call i1 @.rt.issign(i32 %c0)
+  br i1 %sign, label %.takesign, label %.int
+.takesign:
+  call void @.rt.take(i8* %buf, i64* %n)
+  br label %.int
+.int:
+  %digits.int = phi i1 [ false, %.sign ], [ false, %.takesign ], [ true, %.intdigit ]
+  %c1 = call i32 @.rt.peek()
+  %isdigit1 = call i1 @.rt.isdigit(i32 %c1)
+  br i1 %isdigit1, label %.intdigit, label %.dot
+.intdigit:
+  call void @.rt.take(i8* %buf, i64* %n)
+  br label %.int
+.dot:
+  %isdot = icmp eq i32 %c1, 46
+  br i1 %isdot, label %.takedot, label %.exp
+.takedot:
+  call void @.rt.take(i8* %buf, i64* %n)
+  br label %.frac
+.frac:
+  %digits.frac = phi i1 [ %digits.int, %.takedot ], [ true, %.fracdigit ]
+  %c2 = call i32 @.rt.peek()
+  %isdigit2 = call i1 @.rt.isdigit(i32 %c2)
+  br i1 %isdigit2, label %.fracdigit, label %.exp
+.fracdigit:
+  call void @.rt.take(i8* %buf, i64* %n)
+  br label %.frac
+.exp:
+  %digits = phi i1 [ %digits.int, %.dot ], [ %digits.frac, %.frac ]
+  %c3 = call i32 @.rt.peek()
+  %lower.e = icmp eq i32 %c3, 101
+  %upper.e = icmp eq i32 %c3, 69
+  %ise = or i1 %lower.e, %upper.e
+  %hasexp = and i1 %ise, %digits
+  br i1 %hasexp, label %.takee, label %.convert
+.takee:
+  call void @.rt.take(i8* %buf, i64* %n)
+  %c4 = call i32 @.rt.peek()
+  %expsign = call i1 @.rt.issign(i32 %c4)
+  br i1 %expsign, label %.takeexpsign, label %.expdigits
+.takeexpsign:
+  call void @.rt.take(i8* %buf, i64* %n)
+  br label %.expdigits
+.expdigits:
+  %c5 = call i32 @.rt.peek()
+  %isdigit5 = call i1 @.rt.isdigit(i32 %c5)
+  br i1 %isdigit5, label %.expdigit, label %.convert
+.expdigit:
+  call void @.rt.take(i8* %buf, i64* %n)
+  br label %.expdigits
+.convert:
+  %len = load i64, i64* %n
+  %last = getelementptr inbounds i8, i8* %buf, i64 %len
+  store i8 0, i8* %last
+  %value = call float @strtof(i8* %buf, i8** %endp)
+  %end = load i8*, i8** %endp
+  %all = icmp eq i8* %end, %last
+  %valid = and i1 %all, %digits
+  br i1 %valid, label %.store, label %.fail
+.store:
+  store float %value, float* %p
+  br label %.end
+.fail:
+  store i1 true, i1* @.rt.in.failed
+  br label %.end
+.end:
+  ret void
+}
+)";
+
+  // a char (after the spaces)
+  const char * const RuntimeReadChar = R"(
+define internal void @.rt.read.c(i8* %p) {
+.entry:
+  store i8 0, i8* %p
+  %ok = call i1 @.rt.skipspaces()
+  br i1 %ok, label %.get, label %.end
+.get:
+  %c = call i32 @.rt.peek()
+  %c.i8 = trunc i32 %c to i8
+  store i8 %c.i8, i8* %p
+  call void @.rt.next()
+  br label %.end
+.end:
+  ret void
+}
+)";
+
+}  // namespace
+
 LLVMCodeGen::LLVMCodeGen(const TypesMgr & Types, const SymTable & Symbols, const code & tCode)
   : Types{Types}, Symbols{Symbols}, tCode{tCode},
     writeI(false), writeF(false), writeC(false), writeLN(false),
     readI(false), readF(false), readC(false),
-    haltAndExit(false),
-    globalI(false), globalF(false), globalC(false)
+    haltAndExit(false), memCopy(false),
+    globalI(false), globalF(false), globalC(false), bufferedIO(false)
 {
-  std::string failFunc, failTempVar;
-  check_SSA_tCode(failFunc, failTempVar);
-  if (failFunc != "") {
-    std::cerr << std::endl;
-    std::cerr << ";;; *****************************************************************************" << std::endl;
-    std::cerr << ";;; WARNING: in order to generate LLVM code, this emitter impose the following"    << std::endl;
-    std::cerr << ";;;          restriction: the temporal variables in the t-code cannot be multiply" << std::endl;
-    std::cerr << ";;;          defined inside a function."                                           << std::endl;
-    std::cerr << ";;;          For example, this happens in function '";
-    std::cerr << failFunc << "' with temporal '" << failTempVar << "'"       << std::endl;
-    std::cerr << ";;; *****************************************************************************" << std::endl;
-    std::cerr << std::endl;
-    std::exit(EXIT_SUCCESS);
-  }
-}
-
-void LLVMCodeGen::check_SSA_tCode(std::string & failFunc, std::string & failTempVar) const {
-  failFunc = "";
-  failTempVar = "";
-  for (auto & subr: tCode.get_subroutine_list()) {
-    std::map<std::string, int> modTempCounts;
-    for (auto & instr: subr.get_instructions()) {
-      switch (instr.oper) {
-      case instruction::_LABEL:
-      case instruction::_UJUMP:
-      case instruction::_FJUMP:
-      case instruction::_HALT:
-      case instruction::_PUSH:
-      case instruction::_RETURN:
-      case instruction::_XLOAD:
-      case instruction::_CLOAD:
-      case instruction::_WRITEI:
-      case instruction::_WRITEF:
-      case instruction::_WRITEC:
-      case instruction::_WRITES:
-      case instruction::_WRITELN:
-      case instruction::_NOOP:
-      case instruction::_INVALID:
-        break;
-      default:                 // Except in instruction::_POP, where is optional (arg1 may be ""),
-                               // the argument arg1 always does exist.
-        std::string arg1 = getTCodeArg(instr, 1);
-        if (isTCodeTemporal(arg1)) {
-          modTempCounts[arg1] += 1;
-        }
-        break;
-      }
-    }
-    for (auto & pair : modTempCounts) {
-      if (pair.second > 1) {
-        failFunc = subr.get_name();
-        failTempVar = pair.first;
-        return;
-      }
-    }
-  }
 }
 
 bool LLVMCodeGen::isTCodeTemporal(const std::string & tcodeArg) const {
   if (tcodeArg.size() < 2) return false;
   if (tcodeArg[0] != '%')  return false;
   if (not std::isdigit(tcodeArg[1])) return false;
-  return true;
+  return demotedTemps.count(tcodeArg) == 0;
 }
 
 bool LLVMCodeGen::isTCodeIdentifier(const std::string & tcodeArg) const {
@@ -182,7 +546,7 @@ bool LLVMCodeGen::isTCodeIdentifier(const std::string & tcodeArg) const {
   // tcodeArg can not be the arg2 argument of a CHLOAD instruction:
   // %7 = 'a' where oper = _CHLOAD, arg1 = "%7", arg2 = "a"
   if (tcodeArg.size() < 1)  return false;
-  if (tcodeArg[0] == '%')   return false;
+  if (tcodeArg[0] == '%')   return demotedTemps.count(tcodeArg) > 0;
   if (std::isdigit(tcodeArg[0])) return false;
   return true;
 }
@@ -190,9 +554,6 @@ bool LLVMCodeGen::isTCodeIdentifier(const std::string & tcodeArg) const {
 void LLVMCodeGen::computeReadWriteHaltInfo() {
   for (auto & subr: tCode.get_subroutine_list()) {
     for (auto & instr: subr.get_instructions()) {
-      std::string arg1 = getTCodeArg(instr, 1);
-      std::string arg2 = getTCodeArg(instr, 2);
-      std::string arg3 = getTCodeArg(instr, 3);
       switch (instr.oper) {
       case instruction::_WRITEI:
         writeI = true;
@@ -204,8 +565,8 @@ void LLVMCodeGen::computeReadWriteHaltInfo() {
         writeC = true;
         break;
       case instruction::_WRITES:
-        if (std::find(writeSAslStrVec.begin(), writeSAslStrVec.end(), arg1) == writeSAslStrVec.end()) {
-          writeSAslStrVec.push_back(arg1);
+        if (std::find(writeSAslStrVec.begin(), writeSAslStrVec.end(), instr.arg1.name()) == writeSAslStrVec.end()) {
+          writeSAslStrVec.push_back(instr.arg1.name());
         }
         writeS = true;
         break;
@@ -214,22 +575,25 @@ void LLVMCodeGen::computeReadWriteHaltInfo() {
         break;
       case instruction::_READI:
         readI = true;
-        if (isTCodeTemporal(arg1))
+        if (instr.arg1.isTemp())
           globalI = true;
         break;
       case instruction::_READF:
         readF = true;
-        if (isTCodeTemporal(arg1))
+        if (instr.arg1.isTemp())
           globalF = true;
         break;
       case instruction::_READC:
         readC = true;
-        if (isTCodeTemporal(arg1))
+        if (instr.arg1.isTemp())
           globalC = true;
         break;
       case instruction::_HALT:
 	haltAndExit = true;
 	break;
+      case instruction::_ACOPY:
+        memCopy = true;
+        break;
       default:
         break;
       }
@@ -237,13 +601,99 @@ void LLVMCodeGen::computeReadWriteHaltInfo() {
   }
 }
 
+// The array params are pointers to the elements of an array of the
+// caller. A param only gets "noalias" if, at every call, the argument
+// is a local array not passed in another argument, or a param of the
+// caller that is itself "noalias" (or that is not the other argument).
+// Starting with all of them, the params that fail at some call are
+// removed until nothing changes
+void LLVMCodeGen::computeNoAliasArrayParams() {
+  noAliasArrayParams.clear();
+  std::map<std::string, const subroutine *> subroutines;
+  for (auto & subr: tCode.get_subroutine_list()) {
+    subroutines[subr.get_name()] = &subr;
+    for (auto & p : subr.params)
+      if (p.name != "_result" and
+          Types.isArrayTy(Symbols.getLocalSymbolType(subr.get_name(), p.name)))
+        noAliasArrayParams[subr.get_name()].insert(p.name);
+  }
+  // the array of an argument: "param", "local" and its name, or
+  // "unknown" (a temporal that is not only the address of one array)
+  typedef std::pair<std::string, std::string> ArrayArg;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto & subr: tCode.get_subroutine_list()) {
+      const std::string & caller = subr.get_name();
+      instructionList lins = subr.get_instructions();
+      std::map<operand, std::vector<std::size_t>> defs;
+      for (std::size_t pc = 0; pc < lins.size(); ++pc)
+        if (operand * d = definedOperand(lins[pc]))
+          defs[*d].push_back(pc);
+      auto arrayArg = [&](const operand & arg) {
+        operand name = arg;
+        if (arg.isTemp()) {
+          auto it = defs.find(arg);
+          if (it == defs.end() or it->second.size() != 1 or
+              (lins[it->second[0]].oper != instruction::_ALOAD and
+               lins[it->second[0]].oper != instruction::_LOAD) or
+              not lins[it->second[0]].arg2.isVar())
+            return ArrayArg("unknown", arg.name());
+          name = lins[it->second[0]].arg2;
+        }
+        for (auto & p : subr.params)
+          if (p.name == name.name()) return ArrayArg("param", name.name());
+        return ArrayArg("local", name.name());
+      };
+      auto mayAlias = [&](const ArrayArg & a, const ArrayArg & b) {
+        if (a.first == "unknown" or b.first == "unknown" or a == b) return true;
+        if (a.first != b.first) return false;
+        if (a.first == "local") return false;
+        const std::set<std::string> & noAlias = noAliasArrayParams[caller];
+        return noAlias.count(a.second) == 0 and noAlias.count(b.second) == 0;
+      };
+      for (std::size_t pc = 0; pc < lins.size(); ++pc) {
+        if (lins[pc].oper != instruction::_CALL) continue;
+        auto callee = subroutines.find(lins[pc].arg1.name());
+        if (callee == subroutines.end()) continue;
+        std::set<std::string> & noAlias = noAliasArrayParams[callee->first];
+        if (noAlias.empty()) continue;
+        const std::vector<var> params(callee->second->params.begin(),
+                                      callee->second->params.end());
+        std::vector<std::size_t> pushes;
+        if (not callArguments(lins, pc, params.size(), pushes)) {
+          noAlias.clear();
+          changed = true;
+          continue;
+        }
+        std::vector<ArrayArg> args(params.size());
+        for (std::size_t i = 0; i < params.size(); ++i)
+          if (params[i].name != "_result" and
+              Types.isArrayTy(Symbols.getLocalSymbolType(callee->first, params[i].name)))
+            args[i] = arrayArg(lins[pushes[i]].arg1);
+        for (std::size_t i = 0; i < params.size(); ++i) {
+          if (args[i].first.empty() or noAlias.count(params[i].name) == 0) continue;
+          for (std::size_t j = 0; j < params.size(); ++j)
+            if (j != i and not args[j].first.empty() and mayAlias(args[i], args[j])) {
+              noAlias.erase(params[i].name);
+              changed = true;
+              break;
+            }
+        }
+      }
+    }
+  }
+}
+
 void LLVMCodeGen::startNewFunction(const subroutine & subr) {
   currentFunctionName = subr.get_name();
   isMain = (currentFunctionName == "main");
   prevInstrIsTerminator = false;
+  pendingCallIsTail = false;
 }
 
-void LLVMCodeGen::bindTCodeLocalSymbolsToLLVMTypes(const subroutine & subr) {
+bool LLVMCodeGen::bindTCodeLocalSymbolsToLLVMTypes(const subroutine & subr,
+                                                   std::string & errorMessage) {
   llvmLocalValueVec.clear();
   llvmLocalValueTypeMap.clear();
   llvmLocalValueCountMap.clear();
@@ -260,6 +710,9 @@ void LLVMCodeGen::bindTCodeLocalSymbolsToLLVMTypes(const subroutine & subr) {
     std::string llvmType = getLocalSymbolLLVMType(funcName, varlocal.name);
     bindTCodeLocalValueWithType(varlocal.name, llvmType);
   }
+  // twice: a temporal assigned more than once (short-circuit "and" and
+  // "or") can get its type after being copied from a 0/1 constant
+  for (int pass = 0; pass < 2; ++pass)
   for (auto instr : subr.get_instructions()) {
     std::string arg1 = getTCodeArg(instr, 1);
     std::string arg2 = getTCodeArg(instr, 2);
@@ -301,6 +754,9 @@ void LLVMCodeGen::bindTCodeLocalSymbolsToLLVMTypes(const subroutine & subr) {
           std::string llvmValue2 = getLLVMValue(arg2);
           std::string llvmType2 = getLLVMTypeOfValue(llvmValue2);
           bindTCodeLocalValueWithType(arg1, llvmType2);
+          // a 0/1 constant copied to a temporal takes its type
+          if (llvmType2 == LLVM_INT_BOOL)
+            bindTCodeLocalValueWithType(arg2, getLLVMTypeOfValue(getLLVMValue(arg1)));
         }
         break;
       }
@@ -397,6 +853,26 @@ void LLVMCodeGen::bindTCodeLocalSymbolsToLLVMTypes(const subroutine & subr) {
         bindTCodeLocalValueWithType(arg3, LLVM_INT);
         break;
       }
+    case instruction::_ACOPY:
+      {
+        bindTCodeLocalValueWithType(arg3, LLVM_INT);
+        break;
+      }
+    case instruction::_AFILL:
+      {
+        std::string llvmValue1 = getLLVMValue(arg1);
+        std::string llvmType1 = getLLVMTypeOfValue(llvmValue1);
+        std::string llvmElemType;
+        if (isLLVMArrayType(llvmType1))
+          llvmElemType = getLLVMElementOfArrayType(llvmType1);
+        else if (isPointerType(llvmType1))
+          llvmElemType = getPointedType(llvmType1);
+        else
+          llvmElemType = LLVM_TYERR;
+        bindTCodeLocalValueWithType(arg2, llvmElemType);
+        bindTCodeLocalValueWithType(arg3, LLVM_INT);
+        break;
+      }
     case instruction::_LOADC:
       {
         // only: address ASSIG MUL TEMP   (x = *t1)
@@ -553,19 +1029,20 @@ void LLVMCodeGen::bindTCodeLocalSymbolsToLLVMTypes(const subroutine & subr) {
     }
   }
   if (errors) {
-    std::cerr << "ERROR: some local values of this function can not been binded to a valid type:" << std::endl;
-    std::cerr << "++++++++++++++++++++++++++++++++ function: " << funcName << std::endl;
+    errorMessage  = "ERROR: some local values of this function can not been binded to a valid type:\n";
+    errorMessage += "++++++++++++++++++++++++++++++++ function: " + funcName + "\n";
     for (auto & value : llvmLocalValueVec) {
-      std::cerr << value << ": \t" << llvmLocalValueTypeMap.at(value) << std::endl;
+      errorMessage += value + ": \t" + llvmLocalValueTypeMap.at(value) + "\n";
     }
-    std::cerr << "--------------------------------" << std::endl;
-    std::exit(EXIT_FAILURE);
+    errorMessage += "--------------------------------";
+    return false;
   }
   for (auto & llvmValue : llvmLocalValueVec) {
     std::string llvmType = llvmLocalValueTypeMap.at(llvmValue);
     if (llvmType == LLVM_INT_BOOL)
       llvmLocalValueTypeMap[llvmValue] = LLVM_INT;
   }
+  return true;
 }
 
 std::string LLVMCodeGen::getFuncReturnLLVMType(const std::string & tcodeFuncIdent) const {
@@ -651,12 +1128,8 @@ void LLVMCodeGen::generateReadWriteHaltBeginEndCode(std::string & begin, std::st
   computeReadWriteHaltInfo();
   if (writeI or writeF or writeC or writeS or writeLN or readI or readF or readC)
     begin += "\n";
-  if (writeI or readI)
-    begin += "@.str.i = constant [3 x i8] c\"%d\\00\"\n";
-  if (writeF or readF)
+  if (writeF)
     begin += "@.str.f = constant [3 x i8] c\"%g\\00\"\n";
-  if (writeC or readC)
-    begin += "@.str.c = constant [3 x i8] c\"%c\\00\"\n";
   std::string::size_type n = writeSAslStrVec.size();
   writeSLLVMStrSizeVec = std::vector<std::string::size_type>(n);
   for (std::string::size_type i = 0; i < n; ++i) {
@@ -676,35 +1149,79 @@ void LLVMCodeGen::generateReadWriteHaltBeginEndCode(std::string & begin, std::st
     begin += "@.global.c.addr = common dso_local global i8 0\n";
   if (writeI or readI or writeF or readF or writeC or readC)
     begin += "\n\n";
-  if (writeI or writeF or writeC or writeLN or readI or readF or readC or haltAndExit)
+  if (writeI or writeF or writeC or writeLN or readI or readF or readC or haltAndExit or memCopy)
     end += "\n";
-  if (writeI or writeF or writeC or writeS or writeLN) {
-    if (writeI or writeF or writeS)
-      end += "declare dso_local i32 @printf(i8*, ...)\n";
-    if (writeC or writeLN)
-      end += "declare dso_local i32 @putchar(i32)\n";
-  }
-  if (readI or readF or readC) {
-    end += "declare dso_local i32 @__isoc99_scanf(i8*, ...)\n";
-  }
+  bufferedIO = (writeI or writeF or writeC or writeS or writeLN or
+                readI or readF or readC or haltAndExit);
   if (haltAndExit) {
     end += "declare dso_local void @exit(i32) noreturn nounwind\n";
   }
-  if (writeI or writeF or writeC or writeS or writeLN or readI or readF or readC or haltAndExit)
+  if (memCopy or writeS) {
+    end += "declare void @llvm.memcpy.p0i8.p0i8.i64(i8*, i8*, i64, i1)\n";
+  }
+  if (bufferedIO)
+    end += RuntimeOutput;
+  if (writeI)
+    end += RuntimeWriteInt;
+  if (writeF)
+    end += RuntimeWriteFloat;
+  if (writeC or writeLN)
+    end += RuntimeWriteChar;
+  if (writeS)
+    end += RuntimeWriteString;
+  if (readI or readF or readC)
+    end += RuntimeInput;
+  if (readI)
+    end += RuntimeReadInt;
+  if (readF)
+    end += RuntimeReadFloat;
+  if (readC)
+    end += RuntimeReadChar;
+  if (writeI or writeF or writeC or writeS or writeLN or readI or readF or readC or haltAndExit or memCopy)
     end += "\n";
 }
 
 std::string LLVMCodeGen::dumpLLVM() {
-  std::string llvmCode, llvmBegin, llvmEnd;
+  std::string llvmCode, errorMessage;
+  if (not dumpLLVM(llvmCode, errorMessage)) {
+    std::cerr << errorMessage << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+  return llvmCode;
+}
+
+bool LLVMCodeGen::dumpLLVM(std::string & llvmCode, std::string & errorMessage) {
+  std::ostringstream os;
+  bool ok = dumpLLVM(os, errorMessage);
+  llvmCode = ok ? os.str() : "";
+  return ok;
+}
+
+bool LLVMCodeGen::dumpLLVM(std::ostream & os, std::string & errorMessage) {
+  std::string llvmBegin, llvmEnd;
   generateReadWriteHaltBeginEndCode(llvmBegin, llvmEnd);
   bindGlobalValuesWithTypes();
+  computeNoAliasArrayParams();
+  os << llvmBegin;
   for (auto & subr: tCode.get_subroutine_list()) {
-    bindTCodeLocalSymbolsToLLVMTypes(subr);
-    startNewFunction(subr);
-    llvmCode += dumpSubroutine(subr);
+    // LLVM values are assigned once: split the temporals through the
+    // SSA form of the subroutine, and keep the ones still assigned more
+    // than once (joined by a phi node) in memory, as local variables
+    subroutine ssaSubr = subr;
+    ControlFlowGraph cfg(ssaSubr);
+    SSAForm ssa(ssaSubr, cfg);
+    std::set<operand> multiplyDefined;
+    ssa.toTCode(ssaSubr, multiplyDefined);
+    demotedTemps.clear();
+    if (not bindTCodeLocalSymbolsToLLVMTypes(ssaSubr, errorMessage))
+      return false;
+    for (const operand & temp : multiplyDefined)
+      demotedTemps.insert(temp.dump());
+    startNewFunction(ssaSubr);
+    os << dumpSubroutine(ssaSubr);
   }
-  llvmCode = llvmBegin + llvmCode + llvmEnd;
-  return llvmCode;
+  os << llvmEnd;
+  return bool(os);
 }
 
 std::string LLVMCodeGen::dumpSubroutine(const subroutine & subr) {
@@ -742,7 +1259,7 @@ std::string LLVMCodeGen::dumpHeader(const subroutine & subr) {
         std::string llvmType  = getLocalSymbolLLVMType(funcName, p.name, true);
         if (not firstParam) llvmCode += ", ";
         else firstParam = false;
-        llvmCode += llvmType + " " + llvmValue;
+        llvmCode += llvmType + arrayParamAttributes(funcName, p.name) + " " + llvmValue;
       }
     }
     llvmCode += ") ";
@@ -750,6 +1267,24 @@ std::string LLVMCodeGen::dumpHeader(const subroutine & subr) {
   return llvmCode;
 }
 
+// attributes of an array param: it points to the whole array (of the
+// size of its declaration), so the loops over its elements can be
+// vectorized without checking at run time whether it overlaps others
+std::string LLVMCodeGen::arrayParamAttributes(const std::string & funcName,
+                                              const std::string & paramName) const {
+  TypesMgr::TypeId tid = Symbols.getLocalSymbolType(funcName, paramName);
+  if (not Types.isArrayTy(tid)) return "";
+  TypesMgr::TypeId te = Types.getArrayElemType(tid);
+  std::size_t elemSize = (Types.isIntegerTy(te) or Types.isFloatTy(te)) ? 4 : 1;
+  std::string attributes;
+  auto it = noAliasArrayParams.find(funcName);
+  if (it != noAliasArrayParams.end() and it->second.count(paramName))
+    attributes += " noalias";
+  attributes += " nonnull dereferenceable(" +
+                std::to_string(Types.getArraySize(tid) * elemSize) + ")";
+  return attributes;
+}
+
 std::string LLVMCodeGen::dumpAllocaParams(const subroutine & subr) {
   std::string llvmCode;
   std::string funcName = subr.get_name();
@@ -781,6 +1316,17 @@ std::string LLVMCodeGen::dumpAllocaLocalVars(const subroutine & subr) {
     llvmCode += llvmComment("   localVar " + v.name +  " " + llvmType);
     llvmCode += createALLOCA(llvmValueAddr, llvmType);
   }
+  for (auto & temp : demotedTemps) {
+    std::string llvmValue     = getLLVMValue(temp);
+    std::string llvmType      = getLLVMTypeOfValue(llvmValue);
+    if (llvmType == LLVM_INT_BOOL) llvmType = LLVM_INT;
+    llvmLocalValueTypeMap[llvmValue] = llvmType;
+    std::string llvmValueAddr = getLLVMValueAddr(llvmValue);
+    std::string llvmTypePtr   = getPointerToType(llvmType);
+    bindLLVMLocalValueWithType(llvmValueAddr, llvmTypePtr);
+    llvmCode += llvmComment("   temporal " + temp +  " " + llvmType);
+    llvmCode += createALLOCA(llvmValueAddr, llvmType);
+  }
   return llvmCode;
 }
 
@@ -814,6 +1360,8 @@ std::string LLVMCodeGen::dumpInstructionList(const subroutine & subr) {
   int n = subr.get_instructions().size();
   instructionList instrList = subr.get_instructions();
   for (int i = 0; i < n-1; ++i) {
+    if (instrList[i].oper == instruction::_CALL)
+      pendingCallIsTail = isTailCall(instrList, i);
     llvmCode += llvmComment(instrList[i].dump());
     llvmCode += dumpInstruction(instrList[i], instrList[i+1]);
   }
@@ -868,7 +1416,7 @@ std::string LLVMCodeGen::dumpInstruction(const instruction & instr,
         llvmCode += createLABEL(labelContName);
       }
       else {
-        std::string labelCont = getLLVMValue(next.arg1);
+        std::string labelCont = getLLVMValue(getTCodeArg(next, 1));
         llvmCode += createBR(llvmValue1, labelCont, labelJump);
       }
       break;
@@ -929,15 +1477,17 @@ std::string LLVMCodeGen::dumpInstruction(const instruction & instr,
       if (isTCodeTemporal(tcodeArg1))
         llvmCode += createCONVERSION(LLVM_FPTRUNC, llvmValue1, llvmValue2, LLVM_DOUBLE);
       else {
-        std::string llvmValue1Addr = getLLVMValueAddr(llvmValue1);
-        llvmCode += createSTORE(llvmValue2, llvmValue1Addr);
+        // a float constant must be exact: go through a double
+        modifyValueOfArgument(tcodeArg1, llvmValue1, llvmMemCodeValue1);
+        llvmCode += createCONVERSION(LLVM_FPTRUNC, llvmValue1, llvmValue2, LLVM_DOUBLE);
+        llvmCode += llvmMemCodeValue1;
       }
       break;
     }
   case instruction::_CHLOAD:
     {
       llvmValue1 = getLLVMValue(tcodeArg1);
-      int asciiCode = getAsciiCode(tcodeArg2);
+      int asciiCode = instr.arg2.intValue();
       llvmValue2 = std::to_string(asciiCode);
       if (isTCodeTemporal(tcodeArg1))
         llvmCode += createCONVERSION(LLVM_TRUNC, llvmValue1, llvmValue2, LLVM_INT32);
@@ -987,8 +1537,10 @@ std::string LLVMCodeGen::dumpInstruction(const instruction & instr,
     {
       std::string retType = getFuncReturnLLVMType(currentFunctionName);
       if (retType == LLVM_VOID) {
-        if (isMain)
+        if (isMain) {
+          llvmCode += createFLUSH();
           llvmCode += createRET(LLVM_ZERO_INT, LLVM_INT);
+        }
         else
           llvmCode += createRET();
       }
@@ -1056,6 +1608,69 @@ std::string LLVMCodeGen::dumpInstruction(const instruction & instr,
       llvmCode += llvmMemCodeValue1;
       break;
     }
+  case instruction::_ACOPY:
+    {
+      std::string llvmElemType, llvmDstPtr, llvmSrcPtr;
+      llvmCode += createArrayFirstElemPointer(tcodeArg1, llvmDstPtr, llvmElemType);
+      llvmCode += createArrayFirstElemPointer(tcodeArg2, llvmSrcPtr, llvmElemType);
+      std::string llvmElemTypePtr = getPointerToType(llvmElemType);
+      std::string dstBytes = createNewPrefixedValueWithType("%.acopy.dst", LLVM_CHAR_PTR);
+      std::string srcBytes = createNewPrefixedValueWithType("%.acopy.src", LLVM_CHAR_PTR);
+      llvmCode += createCONVERSION("bitcast", dstBytes, llvmDstPtr, llvmElemTypePtr);
+      llvmCode += createCONVERSION("bitcast", srcBytes, llvmSrcPtr, llvmElemTypePtr);
+      accessValueOfArgument(tcodeArg3, llvmValue3, llvmMemCodeValue3);
+      llvmCode += llvmMemCodeValue3;
+      std::string nElems64 = createNewPrefixedValueWithType("%.acopy.n64", LLVM_INT64);
+      std::string nBytes   = createNewPrefixedValueWithType("%.acopy.size", LLVM_INT64);
+      std::string elemSize = (llvmElemType == LLVM_INT or llvmElemType == LLVM_FLOAT ? "4" : "1");
+      llvmCode += createCONVERSION(LLVM_SEXT, nElems64, llvmValue3, LLVM_INT);
+      llvmCode += createARITHMETIC(instruction::_MUL, nBytes, nElems64, elemSize, LLVM_INT64);
+      llvmCode += INDENT_INSTR + "call void @llvm.memcpy.p0i8.p0i8.i64(i8* " + dstBytes +
+                  ", i8* " + srcBytes + ", i64 " + nBytes + ", i1 false)\n";
+      break;
+    }
+  case instruction::_AFILL:
+    {
+      // a loop storing the value (LLVM turns it into a memset when it can)
+      std::string llvmElemType, llvmBasePtr;
+      llvmCode += createArrayFirstElemPointer(tcodeArg1, llvmBasePtr, llvmElemType);
+      if (instr.arg2.kind() == operand::FLOAT) {
+        llvmValue2 = createNewPrefixedValueWithType("%.afill.value", LLVM_FLOAT);
+        llvmCode += createCONVERSION(LLVM_FPTRUNC, llvmValue2, tcodeArg2, LLVM_DOUBLE);
+      }
+      else if (instr.arg2.kind() == operand::CHAR)
+        llvmValue2 = std::to_string(instr.arg2.intValue());
+      else {
+        accessValueOfArgument(tcodeArg2, llvmValue2, llvmMemCodeValue2);
+        llvmCode += llvmMemCodeValue2;
+      }
+      accessValueOfArgument(tcodeArg3, llvmValue3, llvmMemCodeValue3);
+      llvmCode += llvmMemCodeValue3;
+      std::string nElems64  = createNewPrefixedValueWithType("%.afill.n64", LLVM_INT64);
+      std::string labelPre  = createNewPrefixedValueWithType("%.afill.pre", LLVM_LABEL);
+      std::string labelLoop = createNewPrefixedValueWithType("%.afill.loop", LLVM_LABEL);
+      std::string labelEnd  = createNewPrefixedValueWithType("%.afill.end", LLVM_LABEL);
+      std::string nonEmpty  = createNewPrefixedValueWithType("%.afill.nonempty", LLVM_INT1);
+      std::string index     = createNewPrefixedValueWithType("%.afill.i", LLVM_INT64);
+      std::string nextIndex = createNewPrefixedValueWithType("%.afill.next", LLVM_INT64);
+      std::string elemPtr   = createNewPrefixedValueWithType("%.afill.ptr", getPointerToType(llvmElemType));
+      std::string more      = createNewPrefixedValueWithType("%.afill.more", LLVM_INT1);
+      llvmCode += createCONVERSION(LLVM_SEXT, nElems64, llvmValue3, LLVM_INT);
+      llvmCode += createBR(labelPre);
+      llvmCode += createLABEL(labelPre.substr(1));
+      llvmCode += createCOMPARISON(instruction::_LT, nonEmpty, LLVM_ZERO_INT, nElems64, LLVM_INT64);
+      llvmCode += createBR(nonEmpty, labelLoop, labelEnd);
+      llvmCode += createLABEL(labelLoop.substr(1));
+      llvmCode += INDENT_INSTR + index + " = phi i64 [ 0, " + labelPre + " ], [ " +
+                  nextIndex + ", " + labelLoop + " ]\n";
+      llvmCode += createGETELEMENTPTR(elemPtr, llvmBasePtr, index);
+      llvmCode += createSTORE(llvmValue2, elemPtr);
+      llvmCode += createARITHMETIC(instruction::_ADD, nextIndex, index, LLVM_ONE_INT, LLVM_INT64);
+      llvmCode += createCOMPARISON(instruction::_LT, more, nextIndex, nElems64, LLVM_INT64);
+      llvmCode += createBR(more, labelLoop, labelEnd);
+      llvmCode += createLABEL(labelEnd.substr(1));
+      break;
+    }
   case instruction::_ALOAD:
     {
       llvmValue1 = getLLVMValue(tcodeArg1);
@@ -1324,11 +1939,11 @@ std::string LLVMCodeGen::dumpInstruction(const instruction & instr,
 std::string LLVMCodeGen::getTCodeArg(const instruction & instr, int i) const {
   std::string arg;
   if (i == 1)
-    arg = instr.arg1;
+    arg = instr.arg1.dump();
   else if (i == 2)
-    arg = instr.arg2;
+    arg = instr.arg2.dump();
   else     // i == 3
-    arg = instr.arg3;
+    arg = instr.arg3.dump();
   return arg;
 }
 
@@ -1431,44 +2046,52 @@ std::string LLVMCodeGen::createSITOFP(const std::string & llvmValue1, const std:
 
 std::string LLVMCodeGen::createPRINTF(const std::string & llvmValue, const std::string & llvmType) const {
   std::string llvmCode;
-  std::string format;
+  std::string func;
   if (llvmType == LLVM_INT)
-    format = "@.str.i";
+    func = "@.rt.write.i";
   else if (llvmType == LLVM_DOUBLE)
-    format = "@.str.f";
-  llvmCode += INDENT_INSTR + "call i32 (i8*, ...) @printf(i8* getelementptr inbounds ([3 x i8], [3 x i8]* " + format + ", i64 0, i64 0), " + llvmType + " " + llvmValue + ")\n";
+    func = "@.rt.write.f";
+  llvmCode += INDENT_INSTR + "call void " + func + "(" + llvmType + " " + llvmValue + ")\n";
   return llvmCode;
 }
 
-std::string LLVMCodeGen::createPRINTS(const std::string & strFormat, const int strSize) const {
+std::string LLVMCodeGen::createPRINTS(const std::string & str, const int strSize) const {
   std::string llvmCode;
-  llvmCode += INDENT_INSTR + "call i32 (i8*, ...) @printf(i8* getelementptr inbounds ([" + std::to_string(strSize) + " x i8], [" + std::to_string(strSize) + " x i8]* " + strFormat + ", i64 0, i64 0))\n";
+  llvmCode += INDENT_INSTR + "call void @.rt.write.s(i8* getelementptr inbounds ([" + std::to_string(strSize) + " x i8], [" + std::to_string(strSize) + " x i8]* " + str + ", i64 0, i64 0), i64 " + std::to_string(strSize - 1) + ")\n";
   return llvmCode;
 }
 
 std::string LLVMCodeGen::createPUTCHAR(const std::string & llvmValue) const {
   std::string llvmCode;
-  llvmCode += INDENT_INSTR + "call i32 @putchar(i32 " + llvmValue+ ")\n";
+  llvmCode += INDENT_INSTR + "call void @.rt.write.c(i32 " + llvmValue+ ")\n";
   return llvmCode;
 }
 
 std::string LLVMCodeGen::createSCANF(const std::string & llvmValueAddr) const {
   std::string llvmCode;
-  std::string format;
+  std::string func;
   std::string llvmTypePtr = getLLVMTypeOfValue(llvmValueAddr);
   std::string llvmType = getPointedType(llvmTypePtr);
   if (llvmType == LLVM_INT)
-    format = "@.str.i";
+    func = "@.rt.read.i";
   else if (llvmType == LLVM_FLOAT)
-    format = "@.str.f";
+    func = "@.rt.read.f";
   else  // LLVM_CHAR
-    format = "@.str.c";
-  llvmCode += INDENT_INSTR + "call i32 (i8*, ...) @__isoc99_scanf(i8* getelementptr inbounds ([3 x i8], [3 x i8]* " + format + ", i64 0, i64 0), " + llvmTypePtr + " " + llvmValueAddr + ")\n";
+    func = "@.rt.read.c";
+  llvmCode += INDENT_INSTR + "call void " + func + "(" + llvmTypePtr + " " + llvmValueAddr + ")\n";
+  return llvmCode;
+}
+
+std::string LLVMCodeGen::createFLUSH() const {
+  std::string llvmCode;
+  if (bufferedIO)
+    llvmCode += INDENT_INSTR + "call void @.rt.flush()\n";
   return llvmCode;
 }
 
 std::string LLVMCodeGen::createHALT() const {
   std::string llvmCode;
+  llvmCode += createFLUSH();
   llvmCode += INDENT_INSTR + "call void @exit(i32 1)" + "\n";
   return llvmCode;
 }
@@ -1505,6 +2128,17 @@ std::string LLVMCodeGen::createRET() const {
   return llvmCode;
 }
 
+// "tail call" for the calls in tail position, unless they get a
+// pointer, that could be to an alloca of the caller (a local array).
+// Not "musttail": the result is stored to _result and loaded again
+// before the ret, and the callee rarely has the prototype of the caller
+std::string LLVMCodeGen::callKeyword(const std::vector<std::string> & llvmArgs) const {
+  if (not pendingCallIsTail) return "call";
+  for (auto & arg : llvmArgs)
+    if (isPointerType(getLLVMTypeOfValue(arg))) return "call";
+  return "tail call";
+}
+
 std::string LLVMCodeGen::createCALL(const std::string & tcodeFunc, const std::string & llvmValue1,
                                     const std::vector<std::string> & llvmArgs) const {
   std::string llvmCode;
@@ -1519,7 +2153,7 @@ std::string LLVMCodeGen::createCALL(const std::string & tcodeFunc, const std::st
     else
       llvmCodeArgs += ", " + paramType + " " + param;
   }
-  llvmCode += INDENT_INSTR + llvmValue1 + " = call " + llvmRetType + " @" + tcodeFunc + "(" + llvmCodeArgs + ")\n";
+  llvmCode += INDENT_INSTR + llvmValue1 + " = " + callKeyword(llvmArgs) + " " + llvmRetType + " @" + tcodeFunc + "(" + llvmCodeArgs + ")\n";
   return llvmCode;
 }
 
@@ -1537,10 +2171,31 @@ std::string LLVMCodeGen::createCALL(const std::string & tcodeFunc,
     else
       llvmCodeArgs += ", " + paramType + " " + param;
   }
-  llvmCode += INDENT_INSTR + "call " + llvmRetType + " @" + tcodeFunc + "(" + llvmCodeArgs + ")\n";
+  llvmCode += INDENT_INSTR + callKeyword(llvmArgs) + " " + llvmRetType + " @" + tcodeFunc + "(" + llvmCodeArgs + ")\n";
   return llvmCode;
 }
 
+std::string LLVMCodeGen::createArrayFirstElemPointer(const std::string & tcodeArray,
+                                                     std::string & llvmElemPtrOut,
+                                                     std::string & llvmElemTypeOut) {
+  // Post: * llvmElemPtrOut is a new llvm value pointing to the first element of
+  //         tcodeArray (a local array, or a temporal holding the address of an array)
+  //       * llvmElemTypeOut is the llvm type of the elements
+  std::string llvmValue = getLLVMValue(tcodeArray);
+  std::string llvmType  = getLLVMTypeOfValue(llvmValue);   // it can  be "array of" or "pointer to"
+  if (isLLVMArrayType(llvmType))
+    llvmElemTypeOut = getLLVMElementOfArrayType(llvmType);
+  else if (isPointerType(llvmType))
+    llvmElemTypeOut = getPointedType(llvmType);
+  std::string llvmValueAddr;
+  if (isTCodeIdentifier(tcodeArray))
+    llvmValueAddr = getLLVMValueAddr(llvmValue);
+  else
+    llvmValueAddr = llvmValue;
+  llvmElemPtrOut = createNewPrefixedValueWithType("%.arrPtr", getPointerToType(llvmElemTypeOut));
+  return createGETELEMENTPTR(llvmElemPtrOut, llvmValueAddr, LLVM_ZERO_INT);
+}
+
 std::string LLVMCodeGen::createGETELEMENTPTR(const std::string & llvmArrayPointerValue,
                                              const std::string & llvmArrayBaseValue,
                                              const std::string & llvmArrayIndexValue) const {
@@ -1826,24 +2481,6 @@ bool LLVMCodeGen::isEmptyLLVMParamCallStack() const {
 }
 
 
-int LLVMCodeGen::getAsciiCode(const std::string & s) const {
-  if (s.size() == 1)
-    return int(s[0]);
-  else if (s == "\\n")
-    return int('\n');
-  else if (s == "\\t")
-    return int('\t');
-  else if (s == "\\\\")
-    return int('\\');
-  else if (s == "\\\"")
-    return int('\"');
-  else if (s == "\\\'")
-    return int('\'');
-  else
-    return int(s[1]);
-}
-
-
 std::string LLVMCodeGen::llvmComment(const std::string & comm) const {
   if (COMMENTS_ENABLED) return ";   " + comm + "\n";
   return "";
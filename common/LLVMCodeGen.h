@@ -33,8 +33,10 @@
 #include "code.h"
 
 #include <string>
+#include <iosfwd>
 #include <vector>
 #include <map>
+#include <set>
 #include <stack>
 
 // using namespace std;
@@ -87,7 +89,10 @@ class LLVMCodeGen {
   bool writeI, writeF, writeC, writeS, writeLN;
   bool readI, readF, readC;
   bool haltAndExit;
+  bool memCopy;
   bool globalI, globalF, globalC, globalS;
+  // the program reads or writes: the runtime of the buffers is added
+  bool bufferedIO;
   std::vector<std::string>            writeSAslStrVec;
   std::vector<std::string::size_type> writeSLLVMStrSizeVec;
   std::string currentFunctionName;
@@ -102,12 +107,20 @@ class LLVMCodeGen {
   std::string                        pendingCallLLVMRetType;
   std::string                        pendingCallFunc;
   std::vector<std::string>           pendingCallArgs;
+  // the pending call is followed by the return of its result
+  bool                               pendingCallIsTail;
+  // temporals of the current subroutine assigned more than once (they
+  // live in memory, like the local variables)
+  std::set<std::string>              demotedTemps;
+  // array params of every function that never share their elements
+  // with another array param at any call (so they can be "noalias")
+  std::map<std::string, std::set<std::string>> noAliasArrayParams;
 
-  void check_SSA_tCode(std::string & failFunc, std::string & failTempVar) const;
   bool isTCodeTemporal   (const std::string & tcodeArg) const;
   bool isTCodeIdentifier (const std::string & tcodeArg) const;
 
   void computeReadWriteHaltInfo();
+  void computeNoAliasArrayParams();
   std::string              getFuncReturnLLVMType  (const std::string & tcodeFuncIdent)        const;
   int                      getFuncNumberOfParams  (const std::string & tcodeFuncIdent)        const;
   std::string              getFuncParamLLVMType   (const std::string & tcodeFuncIdent, int n) const;
@@ -123,9 +136,11 @@ class LLVMCodeGen {
 				  std::string::size_type & llvmStringSize);
   void generateReadWriteHaltBeginEndCode(std::string & begin, std::string & end) ;
   void startNewFunction(const subroutine & subr);
-  void bindTCodeLocalSymbolsToLLVMTypes(const subroutine & subr);
+  bool bindTCodeLocalSymbolsToLLVMTypes(const subroutine & subr, std::string & errorMessage);
   std::string dumpSubroutine(const subroutine & subr);
   std::string dumpHeader(const subroutine & subr);
+  std::string arrayParamAttributes(const std::string & funcName,
+                                   const std::string & paramName) const;
   std::string dumpAllocaParams(const subroutine & subr);
   std::string dumpAllocaLocalVars(const subroutine & subr);
   std::string dumpStoreParams(const subroutine & subr);
@@ -158,6 +173,7 @@ class LLVMCodeGen {
   std::string createPRINTS(const std::string & str, const int sz) const;
   std::string createPUTCHAR(const std::string & llvmValue) const;
   std::string createSCANF(const std::string & llvmValueAddr) const;
+  std::string createFLUSH() const;
   std::string createHALT() const;
   std::string createBR(const std::string & llvmValue) const;
   std::string createBR(const std::string & llvmValue,
@@ -169,6 +185,10 @@ class LLVMCodeGen {
                          const std::vector<std::string> & llvmArgs) const;
   std::string createCALL(const std::string & tcodeFunc,
                          const std::vector<std::string> & llvmArgs) const;
+  std::string callKeyword(const std::vector<std::string> & llvmArgs) const;
+  std::string createArrayFirstElemPointer(const std::string & tcodeArray,
+                                          std::string & llvmElemPtrOut,
+                                          std::string & llvmElemTypeOut);
   std::string createGETELEMENTPTR(const std::string & llvmArrayPointerValue,
                                   const std::string & llvmArrayBaseValue,
                                   const std::string & llvmArrayIndexValue) const;
@@ -202,11 +222,16 @@ class LLVMCodeGen {
   std::string topPopLLVMParamCallStack();
   bool        isEmptyLLVMParamCallStack() const;
 
-  int getAsciiCode(const std::string & s) const;
-
   std::string llvmComment(const std::string & comm) const;
 
 public:
   LLVMCodeGen(const TypesMgr & Types, const SymTable & Symbols, const code & tCode);
+  // the LLVM code of the program (exits if some function has values
+  // that can not be bound to an LLVM type)
   std::string dumpLLVM();
+  // the same, but returning false (and the reason) on those errors
+  bool dumpLLVM(std::string & llvmCode, std::string & errorMessage);
+  // the same, written to the stream one function at a time (it has
+  // the code of the functions before the one that fails)
+  bool dumpLLVM(std::ostream & os, std::string & errorMessage);
 };
@@ -0,0 +1,182 @@
+/////////////////////////////////////////////////////////////////
+//
+//    NativeBackend - native code generation for the Asl programming language
+//
+//    Copyright (C) 2017-2023  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include "NativeBackend.h"
+
+#include <cstdlib>    // std::getenv, std::system
+#include <cstdio>     // std::remove
+
+#ifdef WITH_LLVM
+#include <llvm-c/Core.h>
+#include <llvm-c/Analysis.h>
+#include <llvm-c/IRReader.h>
+#include <llvm-c/Target.h>
+#include <llvm-c/TargetMachine.h>
+#include <llvm-c/Transforms/PassBuilder.h>
+#endif
+
+// using namespace std;
+
+
+NativeBackend::NativeBackend(int optLevel) :
+  OptLevel{optLevel < 0 ? 0 : (optLevel > 3 ? 3 : optLevel)} {
+}
+
+bool NativeBackend::isAvailable() {
+#ifdef WITH_LLVM
+  return true;
+#else
+  return false;
+#endif
+}
+
+const std::string & NativeBackend::getErrorMessage() const {
+  return ErrorMessage;
+}
+
+#ifdef WITH_LLVM
+
+namespace {
+
+  // take an LLVM message (and dispose it)
+  std::string takeMessage(char *msg) {
+    std::string str = msg ? msg : "";
+    if (msg) LLVMDisposeMessage(msg);
+    return str;
+  }
+
+  bool initializeNativeTarget() {
+    LLVMInitializeNativeTarget();
+    LLVMInitializeNativeAsmPrinter();
+    return true;
+  }
+
+}
+
+bool NativeBackend::emitObject(const std::string & llvmCode, const std::string & objFileName) {
+  ErrorMessage.clear();
+  // once, even if several programs are compiled in parallel
+  static const bool initialized = initializeNativeTarget();
+  (void) initialized;
+
+  // parse and verify the module (the buffer belongs to the parser)
+  LLVMContextRef context = LLVMContextCreate();
+  LLVMMemoryBufferRef buffer =
+    LLVMCreateMemoryBufferWithMemoryRangeCopy(llvmCode.data(), llvmCode.size(), "asl");
+  LLVMModuleRef module;
+  char *msg = nullptr;
+  if (LLVMParseIRInContext(context, buffer, &module, &msg)) {
+    ErrorMessage = "invalid LLVM code: " + takeMessage(msg);
+    LLVMContextDispose(context);
+    return false;
+  }
+  if (LLVMVerifyModule(module, LLVMReturnStatusAction, &msg)) {
+    ErrorMessage = "invalid LLVM code: " + takeMessage(msg);
+    LLVMDisposeModule(module);
+    LLVMContextDispose(context);
+    return false;
+  }
+  takeMessage(msg);
+
+  // a target machine for the host
+  char *triple = LLVMGetDefaultTargetTriple();
+  LLVMTargetRef target;
+  if (LLVMGetTargetFromTriple(triple, &target, &msg)) {
+    ErrorMessage = "no LLVM target for " + std::string(triple) + ": " + takeMessage(msg);
+    LLVMDisposeMessage(triple);
+    LLVMDisposeModule(module);
+    LLVMContextDispose(context);
+    return false;
+  }
+  static const LLVMCodeGenOptLevel codeGenLevel[] = {
+    LLVMCodeGenLevelNone, LLVMCodeGenLevelLess, LLVMCodeGenLevelDefault, LLVMCodeGenLevelAggressive
+  };
+  char *cpu      = LLVMGetHostCPUName();
+  char *features = LLVMGetHostCPUFeatures();
+  LLVMTargetMachineRef machine =
+    LLVMCreateTargetMachine(target, triple, cpu, features, codeGenLevel[OptLevel],
+                            LLVMRelocPIC, LLVMCodeModelDefault);
+  LLVMDisposeMessage(cpu);
+  LLVMDisposeMessage(features);
+  LLVMSetTarget(module, triple);
+  LLVMDisposeMessage(triple);
+  LLVMTargetDataRef dataLayout = LLVMCreateTargetDataLayout(machine);
+  char *dataLayoutStr = LLVMCopyStringRepOfTargetData(dataLayout);
+  LLVMSetDataLayout(module, dataLayoutStr);
+  LLVMDisposeMessage(dataLayoutStr);
+  LLVMDisposeTargetData(dataLayout);
+
+  // optimize and emit the object file
+  bool ok = true;
+  if (OptLevel > 0) {
+    std::string pipeline = "default<O" + std::to_string(OptLevel) + ">";
+    LLVMPassBuilderOptionsRef options = LLVMCreatePassBuilderOptions();
+    LLVMErrorRef error = LLVMRunPasses(module, pipeline.c_str(), machine, options);
+    LLVMDisposePassBuilderOptions(options);
+    if (error) {
+      char *errMsg = LLVMGetErrorMessage(error);
+      ErrorMessage = "cannot optimize the LLVM code: " + std::string(errMsg);
+      LLVMDisposeErrorMessage(errMsg);
+      ok = false;
+    }
+  }
+  if (ok and LLVMTargetMachineEmitToFile(machine, module, const_cast<char *>(objFileName.c_str()),
+                                         LLVMObjectFile, &msg)) {
+    ErrorMessage = "cannot write " + objFileName + ": " + takeMessage(msg);
+    ok = false;
+  }
+  LLVMDisposeTargetMachine(machine);
+  LLVMDisposeModule(module);
+  LLVMContextDispose(context);
+  return ok;
+}
+
+#else
+
+bool NativeBackend::emitObject(const std::string & llvmCode, const std::string & objFileName) {
+  ErrorMessage = "native code generation is not available (build the compiler with make WITH_LLVM=1)";
+  return false;
+}
+
+#endif
+
+bool NativeBackend::emitExecutable(const std::string & llvmCode, const std::string & exeFileName) {
+  std::string objFileName = exeFileName + ".o";
+  if (not emitObject(llvmCode, objFileName))
+    return false;
+  const char *cc = std::getenv("CC");
+  std::string command = std::string(cc and *cc ? cc : "cc") +
+                        " -o '" + exeFileName + "' '" + objFileName + "'";
+  int status = std::system(command.c_str());
+  std::remove(objFileName.c_str());
+  if (status != 0) {
+    ErrorMessage = "cannot link " + exeFileName + " (" + command + ")";
+    return false;
+  }
+  return true;
+}
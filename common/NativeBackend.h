@@ -0,0 +1,71 @@
+/////////////////////////////////////////////////////////////////
+//
+//    NativeBackend - native code generation for the Asl programming language
+//
+//    Copyright (C) 2017-2023  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+
+// using namespace std;
+
+
+////////////////////////////////////////////////////////////////////
+/// Class NativeBackend compiles the LLVM code of a program (the text
+/// of code::dumpLLVM) into an object file or an executable, with the
+/// LLVM libraries instead of separate llc and clang steps.
+///
+/// The module is parsed and verified, optimized with the LLVM pass
+/// pipeline of the optimization level ("default<On>", nothing at
+/// -O0) and emitted for the host. The read/write/halt runtime is in
+/// the module itself (format strings and calls to printf, putchar,
+/// scanf and exit), so an executable only needs the C library: the
+/// object file is linked with the C compiler ($CC, or cc).
+///
+/// It is only available if the compiler is built with LLVM
+/// (make WITH_LLVM=1); otherwise every emission fails.
+
+class NativeBackend {
+
+ public:
+  /// constructor: LLVM optimization level 0..3
+  NativeBackend(int optLevel = 0);
+
+  /// true if the compiler has been built with LLVM
+  static bool isAvailable();
+
+  /// write the object file of the LLVM code; false on errors
+  bool emitObject(const std::string & llvmCode, const std::string & objFileName);
+  /// write the executable of the LLVM code; false on errors
+  bool emitExecutable(const std::string & llvmCode, const std::string & exeFileName);
+
+  /// the reason of the last failed emission
+  const std::string & getErrorMessage() const;
+
+ private:
+  int         OptLevel;
+  std::string ErrorMessage;
+};
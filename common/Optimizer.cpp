@@ -0,0 +1,902 @@
+/////////////////////////////////////////////////////////////////
+//
+//    Optimizer - t-code optimization passes for the Asl programming language
+//
+//    Copyright (C) 2017-2023  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include "Optimizer.h"
+#include "ControlFlow.h"
+
+#include <map>
+#include <set>
+#include <vector>
+#include <string>
+#include <algorithm>  // std::find, std::reverse
+#include <cmath>      // std::isfinite, std::signbit
+#include <cstdint>    // std::int32_t, std::uint32_t
+
+// using namespace std;
+
+
+////////////////////////////////////////////////////////////////////
+// Auxiliary functions on instructions
+
+namespace {
+
+  // true if the instruction only computes the value of its destination
+  // (DIV is not, since a division by zero halts the program)
+  bool isPure(instruction::Operation oper) {
+    switch (oper) {
+    case instruction::_ADD:  case instruction::_SUB:  case instruction::_MUL:
+    case instruction::_EQ:   case instruction::_LT:   case instruction::_LE:
+    case instruction::_AND:  case instruction::_OR:   case instruction::_FADD:
+    case instruction::_FSUB: case instruction::_FMUL: case instruction::_FDIV:
+    case instruction::_FEQ:  case instruction::_FLT:  case instruction::_FLE:
+    case instruction::_NOT:  case instruction::_NEG:  case instruction::_FNEG:
+    case instruction::_FLOAT: case instruction::_LOAD: case instruction::_ILOAD:
+    case instruction::_CHLOAD: case instruction::_FLOAD: case instruction::_LOADX:
+    case instruction::_ALOAD: case instruction::_LOADC:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  // true if the next instruction is not executed after this one
+  // (unless it has a label)
+  bool endsBlock(instruction::Operation oper) {
+    return oper == instruction::_UJUMP or oper == instruction::_FJUMP or
+           oper == instruction::_HALT  or oper == instruction::_RETURN;
+  }
+
+  // use (and def) counts of the temporals, indexed by temporal number
+  void countTempUses(const instructionList & lins, std::vector<unsigned> & uses,
+                     std::vector<unsigned> * defs = nullptr) {
+    for (auto & constInstr : lins) {
+      // the operands are only read
+      instruction & instr = const_cast<instruction &>(constInstr);
+      for (operand * op : usedOperands(instr, true)) {
+        if (not op->isTemp()) continue;
+        if (op->id() >= uses.size()) uses.resize(op->id() + 1, 0);
+        ++uses[op->id()];
+      }
+      if (not defs) continue;
+      operand * d = definedOperand(instr);
+      if (d and d->isTemp()) {
+        if (d->id() >= defs->size()) defs->resize(d->id() + 1, 0);
+        ++(*defs)[d->id()];
+      }
+    }
+  }
+
+  unsigned countOf(const std::vector<unsigned> & counts, const operand & temp) {
+    return temp.id() < counts.size() ? counts[temp.id()] : 0;
+  }
+
+  typedef std::map<operand, operand> ConstantMap;
+
+  // constant value of an operand (an immediate or a known name)
+  bool constantOf(const operand & op, const ConstantMap & known, operand & k) {
+    if (op.isConst()) { k = op; return true; }
+    ConstantMap::const_iterator it = known.find(op);
+    if (it == known.end()) return false;
+    k = it->second;
+    return true;
+  }
+
+  // integer arithmetic wraps around, as in the VM
+  std::int32_t wrap(std::uint32_t n) { return std::int32_t(n); }
+
+  // value computed by the instruction, if its operands are known constants
+  bool evaluate(const instruction & instr, const ConstantMap & known, operand & value) {
+    operand a, b;
+    switch (instr.oper) {
+    case instruction::_ILOAD:
+    case instruction::_FLOAD:
+    case instruction::_CHLOAD:
+      value = instr.arg2;
+      return true;
+    case instruction::_LOAD:
+      return constantOf(instr.arg2, known, value);
+    case instruction::_ADD:  case instruction::_SUB:  case instruction::_MUL:
+    case instruction::_DIV:  case instruction::_EQ:   case instruction::_LT:
+    case instruction::_LE:   case instruction::_AND:  case instruction::_OR: {
+      if (not constantOf(instr.arg2, known, a) or not constantOf(instr.arg3, known, b)) return false;
+      if (a.kind() == operand::FLOAT or b.kind() == operand::FLOAT) return false;
+      std::int32_t x = a.intValue(), y = b.intValue(), r = 0;
+      switch (instr.oper) {
+      case instruction::_ADD: r = wrap(std::uint32_t(x) + std::uint32_t(y)); break;
+      case instruction::_SUB: r = wrap(std::uint32_t(x) - std::uint32_t(y)); break;
+      case instruction::_MUL: r = wrap(std::uint32_t(x) * std::uint32_t(y)); break;
+      case instruction::_DIV:
+        if (y == 0 or (x == INT32_MIN and y == -1)) return false;
+        r = x / y;
+        break;
+      case instruction::_EQ:  r = (x == y); break;
+      case instruction::_LT:  r = (x < y);  break;
+      case instruction::_LE:  r = (x <= y); break;
+      case instruction::_AND: r = (x and y); break;
+      default:                r = (x or y); break;
+      }
+      value = operand::intConst(r);
+      return true;
+    }
+    case instruction::_NOT:
+    case instruction::_NEG:
+      if (not constantOf(instr.arg2, known, a) or a.kind() == operand::FLOAT) return false;
+      value = operand::intConst(instr.oper == instruction::_NOT ?
+                                std::int32_t(not a.intValue()) :
+                                wrap(0u - std::uint32_t(a.intValue())));
+      return true;
+    case instruction::_FADD: case instruction::_FSUB: case instruction::_FMUL:
+    case instruction::_FDIV: case instruction::_FEQ:  case instruction::_FLT:
+    case instruction::_FLE: {
+      if (not constantOf(instr.arg2, known, a) or not constantOf(instr.arg3, known, b)) return false;
+      if (a.kind() != operand::FLOAT or b.kind() != operand::FLOAT) return false;
+      float x = a.floatValue(), y = b.floatValue();
+      switch (instr.oper) {
+      case instruction::_FEQ:  value = operand::intConst(x == y); break;
+      case instruction::_FLT:  value = operand::intConst(x < y);  break;
+      case instruction::_FLE:  value = operand::intConst(x <= y); break;
+      case instruction::_FADD: value = operand::floatConst(x + y); break;
+      case instruction::_FSUB: value = operand::floatConst(x - y); break;
+      case instruction::_FMUL: value = operand::floatConst(x * y); break;
+      default:                 value = operand::floatConst(x / y); break;
+      }
+      return true;
+    }
+    case instruction::_FNEG:
+      if (not constantOf(instr.arg2, known, a) or a.kind() != operand::FLOAT) return false;
+      value = operand::floatConst(-a.floatValue());
+      return true;
+    case instruction::_FLOAT:
+      if (not constantOf(instr.arg2, known, a) or a.kind() == operand::FLOAT) return false;
+      value = operand::floatConst(float(a.intValue()));
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  // true if the constant can be written in the t-code: the VM has no
+  // negative constants (nor infinities and NaNs)
+  bool isWritable(const operand & k) {
+    if (k.kind() == operand::INT) return k.intValue() >= 0;
+    if (k.kind() == operand::FLOAT)
+      return std::isfinite(k.floatValue()) and not std::signbit(k.floatValue());
+    return true;
+  }
+
+  // true if the instruction already is "a1 = constant"
+  bool isImmediateLoad(const instruction & instr) {
+    return (instr.oper == instruction::_ILOAD or instr.oper == instruction::_FLOAD or
+            instr.oper == instruction::_CHLOAD or instr.oper == instruction::_LOAD) and
+           instr.arg2.isConst();
+  }
+
+  // "a1 = k" with the load of the kind of the constant
+  instruction immediateLoad(const operand & dest, const operand & k) {
+    return instruction(k.kind() == operand::FLOAT ? instruction::_FLOAD :
+                       k.kind() == operand::CHAR  ? instruction::_CHLOAD :
+                                                    instruction::_ILOAD,
+                       dest, k);
+  }
+
+  // subroutine of the program with the given name (nullptr if there is
+  // none, e.g. when the functions are compiled one by one)
+  const subroutine * findSubroutine(const code & program, const std::string & name) {
+    for (auto & s : program.get_subroutine_list())
+      if (s.get_name() == name) return &s;
+    return nullptr;
+  }
+
+  // arrays are passed by reference: their parameters are "type array"
+  bool isArrayParam(const var & param) {
+    const std::string suffix = " array";
+    return param.type.size() > suffix.size() and
+           param.type.compare(param.type.size() - suffix.size(), suffix.size(), suffix) == 0;
+  }
+
+  // the array operands of the instruction (the names of XLOAD, LOADX,
+  // ALOAD, ACOPY and AFILL that stand for a whole array)
+  std::vector<operand *> arrayOperands(instruction & instr) {
+    std::vector<operand *> all = usedOperands(instr, true), arrays;
+    std::vector<operand *> scalars = usedOperands(instr, false);
+    for (operand * op : all)
+      if (std::find(scalars.begin(), scalars.end(), op) == scalars.end())
+        arrays.push_back(op);
+    return arrays;
+  }
+
+  // true if the subroutine has no local arrays and its locals are
+  // written in the entry block before being read, so they do not need
+  // the zeros of a new frame. A label at the beginning does not end
+  // the entry block: the jumps to it go through the whole block again
+  bool localsWrittenFirst(const subroutine & subr) {
+    std::set<operand> locals, written;
+    for (auto & v : subr.vars) {
+      if (v.nelem > 1) return false;
+      locals.insert(operand::variable(v.name));
+    }
+    const instructionList & lins = subr.get_instructions();
+    bool inEntry = true;
+    for (std::size_t pc = 0; pc < lins.size(); ++pc) {
+      // the operands are only read
+      instruction & instr = const_cast<instruction &>(lins[pc]);
+      if (instr.oper == instruction::_LABEL and pc > 0) inEntry = false;
+      for (operand * op : usedOperands(instr, true))
+        if (locals.count(*op) and written.count(*op) == 0) return false;
+      for (operand * op : arrayOperands(instr))
+        if (locals.count(*op)) return false;
+      operand * d = definedOperand(instr);
+      if (inEntry and d and locals.count(*d)) written.insert(*d);
+      if (endsBlock(instr.oper)) inEntry = false;
+    }
+    return true;
+  }
+
+  // true if the subroutine can be inlined: it calls nobody (so it is
+  // not recursive), has at most 'maxSize' instructions besides the
+  // labels, and its locals, that become temporals of the caller, are
+  // written before being read
+  bool isInlinable(const subroutine & callee, std::size_t maxSize) {
+    std::size_t size = 0;
+    for (auto & instr : callee.get_instructions()) {
+      if (instr.oper == instruction::_CALL or instr.oper == instruction::_LOADC or
+          instr.oper == instruction::_CLOAD)
+        return false;
+      if (instr.oper != instruction::_LABEL and ++size > maxSize) return false;
+    }
+    return localsWrittenFirst(callee);
+  }
+
+  typedef std::map<operand, operand> CopyMap;
+
+  // forget the copies involving a name that is being redefined
+  void killCopies(CopyMap & copyOf, const operand & name) {
+    copyOf.erase(name);
+    for (CopyMap::iterator it = copyOf.begin(); it != copyOf.end(); ) {
+      if (it->second == name) it = copyOf.erase(it);
+      else ++it;
+    }
+  }
+
+}  // namespace
+
+
+////////////////////////////////////////////////////////////////////
+// Pipeline
+
+Optimizer::Optimizer(int level) : UntilFixpoint{level >= 2} {
+  if (level >= 1) {
+    addPass("fold-constants", foldConstants);
+    addPass("propagate-copies", propagateCopies);
+    addPass("remove-dead-temps", removeDeadTemps);
+  }
+  if (level >= 2) {
+    addPass("inline-calls", inlineCalls);
+    addPass("eliminate-tail-calls", eliminateTailCalls);
+    addPass("coalesce-copies", coalesceCopies);
+    addPass("remove-unreachable-code", removeUnreachableCode);
+    addPass("hoist-loop-invariants", hoistLoopInvariants);
+  }
+}
+
+void Optimizer::addPass(const std::string & name, Pass pass) {
+  Passes.push_back(std::make_pair(name, pass));
+}
+
+void Optimizer::run(code & program) const {
+  if (Passes.empty()) return;
+  for (auto & subr : program.get_subroutine_list()) {
+    int rounds = UntilFixpoint ? MaxRounds : 1;
+    for (int i = 0; i < rounds; ++i) {
+      bool changed = false;
+      for (auto & pass : Passes)
+        if (pass.second(subr, program)) changed = true;
+      if (not changed) break;
+    }
+  }
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Passes
+
+// Constant folding inside each basic block: the constants loaded in
+// temporals and variables are followed until they are redefined, and
+// the operations on them are replaced by an immediate load. The
+// immediate operands stay in ILOAD/FLOAD/CHLOAD/LOAD, the only
+// instructions that accept them; the loads that become useless are
+// left to removeDeadTemps.
+bool Optimizer::foldConstants(subroutine & subr, const code & program) {
+  const instructionList & lins = subr.get_instructions();
+  instructionList newLins;
+  newLins.reserve(lins.size());
+  ConstantMap known;
+  bool changed = false;
+  for (instruction instr : lins) {
+    if (instr.oper == instruction::_LABEL) known.clear();
+    operand value;
+    std::uint32_t line = instr.line;
+    if (instr.oper == instruction::_FJUMP and constantOf(instr.arg1, known, value)) {
+      // the condition is known: jump always or never
+      changed = true;
+      if (value.intValue() != 0) continue;
+      instr = instruction(instruction::_UJUMP, instr.arg2);
+    }
+    bool hasValue = evaluate(instr, known, value);
+    if (hasValue and not isImmediateLoad(instr) and isWritable(value)) {
+      instr = immediateLoad(instr.arg1, value);
+      changed = true;
+    }
+    operand * d = definedOperand(instr);
+    if (d) known.erase(*d);
+    // the value is known even if it cannot be written as a constant
+    if (hasValue) known[instr.arg1] = value;
+    if (endsBlock(instr.oper)) known.clear();
+    instr.line = line;
+    newLins.push_back(instr);
+  }
+  if (changed) subr.set_instructions(std::move(newLins));
+  return changed;
+}
+
+// Copy propagation inside each basic block: after "a1 = a2" the uses
+// of a1 read a2 instead, until any of them is redefined. Callees can
+// only modify the arrays of their caller, never its scalars.
+bool Optimizer::propagateCopies(subroutine & subr, const code & program) {
+  instructionList lins = subr.get_instructions();
+  CopyMap copyOf;
+  bool changed = false;
+  for (auto & instr : lins) {
+    if (instr.oper == instruction::_LABEL) copyOf.clear();
+    for (operand * op : usedOperands(instr, false)) {
+      CopyMap::const_iterator it = copyOf.find(*op);
+      if (it != copyOf.end()) {
+        *op = it->second;
+        changed = true;
+      }
+    }
+    operand * d = definedOperand(instr);
+    if (d) killCopies(copyOf, *d);
+    if (instr.oper == instruction::_LOAD and not instr.arg2.isConst() and
+        instr.arg1 != instr.arg2)
+      copyOf[instr.arg1] = instr.arg2;
+    if (endsBlock(instr.oper)) copyOf.clear();
+  }
+  if (changed) subr.set_instructions(std::move(lins));
+  return changed;
+}
+
+// Removal of the side-effect free instructions whose destination is a
+// temporal that no instruction reads. A "popparam %t" of an unused
+// result becomes "popparam". Walking backwards, the operands of the
+// removed instructions may become unused too.
+bool Optimizer::removeDeadTemps(subroutine & subr, const code & program) {
+  instructionList lins = subr.get_instructions();
+  bool changed = false;
+  bool removed = true;
+  while (removed) {
+    removed = false;
+    std::vector<unsigned> uses;
+    countTempUses(lins, uses);
+    std::vector<bool> dead(lins.size(), false);
+    for (std::size_t i = lins.size(); i-- > 0; ) {
+      instruction & instr = lins[i];
+      operand * d = definedOperand(instr);
+      if (not d or not d->isTemp() or countOf(uses, *d) > 0) continue;
+      if (instr.oper == instruction::_POP) {
+        instr.arg1 = operand();
+        removed = true;
+      }
+      else if (isPure(instr.oper)) {
+        for (operand * op : usedOperands(instr, true))
+          if (op->isTemp()) --uses[op->id()];
+        dead[i] = true;
+        removed = true;
+      }
+    }
+    if (not removed) break;
+    changed = true;
+    instructionList newLins;
+    newLins.reserve(lins.size());
+    for (std::size_t i = 0; i < lins.size(); ++i)
+      if (not dead[i]) newLins.push_back(lins[i]);
+    lins = std::move(newLins);
+  }
+  if (changed) subr.set_instructions(std::move(lins));
+  return changed;
+}
+
+// "%t = a2 op a3" followed by "a1 = %t", where %t is defined and used
+// only there, becomes "a1 = a2 op a3"
+bool Optimizer::coalesceCopies(subroutine & subr, const code & program) {
+  const instructionList & lins = subr.get_instructions();
+  std::vector<unsigned> uses, defs;
+  countTempUses(lins, uses, &defs);
+  instructionList newLins;
+  newLins.reserve(lins.size());
+  bool changed = false;
+  for (std::size_t i = 0; i < lins.size(); ++i) {
+    const instruction & instr = lins[i];
+    if (i + 1 < lins.size() and lins[i+1].oper == instruction::_LOAD) {
+      const instruction & copy = lins[i+1];
+      const operand & temp = copy.arg2;
+      bool canCoalesce = false;
+      switch (instr.oper) {
+      case instruction::_ADD:  case instruction::_SUB:  case instruction::_MUL:
+      case instruction::_DIV:  case instruction::_EQ:   case instruction::_LT:
+      case instruction::_LE:   case instruction::_AND:  case instruction::_OR:
+      case instruction::_FADD: case instruction::_FSUB: case instruction::_FMUL:
+      case instruction::_FDIV: case instruction::_FEQ:  case instruction::_FLT:
+      case instruction::_FLE:  case instruction::_NOT:  case instruction::_NEG:
+      case instruction::_FNEG: case instruction::_FLOAT: case instruction::_LOAD:
+      case instruction::_ILOAD: case instruction::_CHLOAD: case instruction::_FLOAD:
+      case instruction::_LOADX: case instruction::_POP:
+        canCoalesce = true;
+        break;
+      default:
+        break;
+      }
+      if (canCoalesce and temp.isTemp() and instr.arg1 == temp and
+          countOf(uses, temp) == 1 and countOf(defs, temp) == 1) {
+        instruction merged = instr;
+        merged.arg1 = copy.arg1;
+        newLins.push_back(merged);
+        ++i;
+        changed = true;
+        continue;
+      }
+    }
+    newLins.push_back(instr);
+  }
+  if (changed) subr.set_instructions(std::move(newLins));
+  return changed;
+}
+
+// Removal of the instructions after a goto, return or halt up to the
+// next label, of the jumps to the label that follows them, and of the
+// labels that no jump refers to
+bool Optimizer::removeUnreachableCode(subroutine & subr, const code & program) {
+  const instructionList & lins = subr.get_instructions();
+  ControlFlowGraph cfg(subr);
+  std::set<operand> targets;
+  for (std::size_t i = 0; i < lins.size(); ++i) {
+    const instruction & instr = lins[i];
+    if (not cfg.isReachable(cfg.getBlockOf(i))) continue;
+    if (instr.oper == instruction::_UJUMP) targets.insert(instr.arg1);
+    else if (instr.oper == instruction::_FJUMP) targets.insert(instr.arg2);
+  }
+  instructionList newLins;
+  newLins.reserve(lins.size());
+  bool changed = false;
+  for (std::size_t i = 0; i < lins.size(); ++i) {
+    const instruction & instr = lins[i];
+    if (not cfg.isReachable(cfg.getBlockOf(i))) { changed = true; continue; }
+    if (instr.oper == instruction::_LABEL and targets.count(instr.arg1) == 0) {
+      changed = true;
+      continue;
+    }
+    if (instr.oper == instruction::_UJUMP or instr.oper == instruction::_FJUMP) {
+      const operand & label = (instr.oper == instruction::_UJUMP ? instr.arg1 : instr.arg2);
+      if (i + 1 < lins.size() and lins[i+1].oper == instruction::_LABEL and
+          lins[i+1].arg1 == label) {
+        changed = true;
+        continue;
+      }
+    }
+    newLins.push_back(instr);
+  }
+  if (changed) subr.set_instructions(std::move(newLins));
+  return changed;
+}
+
+// Inlining of the calls to small leaf subroutines (see isInlinable).
+// The caller pushes the result slot and the arguments, calls and pops
+// them (visitCall and visitProcCall); with the budgets of the class
+// that becomes:
+//   - the PUSH of a scalar argument: a copy "%p = arg" to a new
+//     temporal that stands for the parameter in the body
+//   - the PUSH of an array: removed, the body uses the array itself
+//     (the caller's parameter or the local array of the ALOAD, whose
+//     address is then taken with ALOAD instead of LOAD)
+//   - the PUSH of the result slot: removed, the body writes _result
+//     directly in the operand of the last POP
+//   - CALL: the body of the callee, where the temporals are numbered
+//     after those of the caller, the locals are new temporals, the
+//     labels are prefixed with InlN and RETURN jumps to EndInlineN
+//   - the POPs: removed
+// The inlined instructions get the line of the call. The arguments
+// are matched with their PUSHes by callArguments, since the code of
+// an argument can have calls too (inlined or not).
+bool Optimizer::inlineCalls(subroutine & subr, const code & program) {
+  const instructionList & lins = subr.get_instructions();
+  if (lins.size() >= MaxInlinedCallerSize) return false;
+  std::uint32_t nextTemp = 1;
+  for (auto & instr : lins) {
+    const operand * args[3] = { &instr.arg1, &instr.arg2, &instr.arg3 };
+    for (const operand * op : args)
+      if (op->isTemp() and op->id() >= nextTemp) nextTemp = op->id() + 1;
+  }
+  std::map<std::string, const subroutine *> inlinable;
+  instructionList newLins;
+  newLins.reserve(lins.size());
+  std::vector<std::size_t> newPos(lins.size());   // position in newLins of each instruction
+  std::size_t size = lins.size();
+  int nInlined = 0;
+  bool changed = false;
+  for (std::size_t i = 0; i < lins.size(); ++i) {
+    const instruction & instr = lins[i];
+    newPos[i] = newLins.size();
+    if (instr.oper != instruction::_CALL) {
+      newLins.push_back(instr);
+      continue;
+    }
+    // the callee, if it can be inlined
+    const std::string & name = instr.arg1.name();
+    if (inlinable.count(name) == 0) {
+      const subroutine * s = findSubroutine(program, name);
+      inlinable[name] = (s and s != &subr and isInlinable(*s, MaxInlineSize) ? s : nullptr);
+    }
+    const subroutine * callee = inlinable[name];
+    std::size_t nParams = callee ? callee->params.size() : 0;
+    bool isFunction = nParams > 0 and callee->params.front().name == "_result";
+    std::vector<std::size_t> argPushes;
+    bool ok = callee and i + nParams < lins.size() and
+              size + callee->get_instructions().size() <= MaxInlinedCallerSize and
+              callArguments(lins, i, nParams, argPushes);
+    for (std::size_t k = 1; ok and k <= nParams; ++k)
+      ok = lins[i+k].oper == instruction::_POP and
+           (lins[i+k].arg1.isNone() or (k == nParams and isFunction));
+    // the parameters of the callee and what they become in the caller
+    std::map<operand, operand> names;
+    std::set<operand> localArrays;     // the parameters bound to a local array
+    if (ok) {
+      for (auto & pc : argPushes)
+        pc = newPos[pc];
+      std::size_t k = 0;
+      for (auto & param : callee->params) {
+        std::size_t pc = argPushes[k++];
+        const operand & arg = newLins[pc].arg1;
+        if (param.name == "_result")
+          names[operand::variable(param.name)] =
+            lins[i + nParams].arg1.isNone() ? operand::temporal(nextTemp++) : lins[i + nParams].arg1;
+        else if (not isArrayParam(param))
+          names[operand::variable(param.name)] = operand::temporal(nextTemp++);
+        else if (arg.isVar())
+          names[operand::variable(param.name)] = arg;
+        else {
+          // the address of a local array: look for its ALOAD
+          std::size_t def = pc;
+          while (def > 0 and (definedOperand(newLins[def-1]) == nullptr or
+                              *definedOperand(newLins[def-1]) != arg))
+            --def;
+          if (def == 0 or newLins[def-1].oper != instruction::_ALOAD) { ok = false; break; }
+          names[operand::variable(param.name)] = newLins[def-1].arg2;
+          localArrays.insert(operand::variable(param.name));
+        }
+      }
+    }
+    if (not ok) {
+      newLins.push_back(instr);
+      continue;
+    }
+    // the scalar arguments are copied and the other PUSHes removed (the
+    // last ones first, so that the positions of the others do not change)
+    std::size_t k = nParams;
+    for (auto param = callee->params.rbegin(); param != callee->params.rend(); ++param) {
+      std::size_t pc = argPushes[--k];
+      if (param->name == "_result" or isArrayParam(*param))
+        newLins.erase(newLins.begin() + pc);
+      else {
+        std::uint32_t line = newLins[pc].line;
+        newLins[pc] = instruction::LOAD(names[operand::variable(param->name)], newLins[pc].arg1);
+        newLins[pc].line = line;
+      }
+    }
+    for (auto & v : callee->vars)
+      names[operand::variable(v.name)] = operand::temporal(nextTemp++);
+    // new labels for the body
+    std::string prefix, labelEnd;
+    bool clash;
+    do {
+      ++nInlined;
+      prefix   = "Inl" + std::to_string(nInlined);
+      labelEnd = "EndInline" + std::to_string(nInlined);
+      clash = subr.has_label(operand::label(labelEnd));
+      for (auto & calleeInstr : callee->get_instructions())
+        if (calleeInstr.oper == instruction::_LABEL and
+            subr.has_label(operand::label(prefix + calleeInstr.arg1.name())))
+          clash = true;
+    } while (clash);
+    // the body
+    const instructionList & body = callee->get_instructions();
+    std::uint32_t base = nextTemp;
+    for (std::size_t pc = 0; pc < body.size(); ++pc) {
+      instruction inl = body[pc];
+      inl.line = instr.line;
+      if (inl.oper == instruction::_RETURN) {
+        if (pc + 1 == body.size()) continue;
+        newLins.push_back(instruction::UJUMP(labelEnd));
+        newLins.back().line = instr.line;
+        continue;
+      }
+      // the address of an array parameter is "%t = a", that of a local
+      // array "%t = &a"
+      if (inl.oper == instruction::_LOAD and localArrays.count(inl.arg2))
+        inl.oper = instruction::_ALOAD;
+      operand * args[3] = { &inl.arg1, &inl.arg2, &inl.arg3 };
+      for (operand * op : args) {
+        if (op->isTemp()) {
+          *op = operand::temporal(base + op->id());
+          if (op->id() >= nextTemp) nextTemp = op->id() + 1;
+        }
+        else if (op->isVar())
+          *op = names[*op];
+        else if (op->isLabel())
+          *op = operand::label(prefix + op->name());
+      }
+      newLins.push_back(inl);
+    }
+    newLins.push_back(instruction::LABEL(labelEnd));
+    newLins.back().line = instr.line;
+    i += nParams;
+    size = size + body.size() - 2 * nParams;
+    changed = true;
+  }
+  if (changed) subr.set_instructions(std::move(newLins));
+  return changed;
+}
+
+// Elimination of the self-recursive tail calls ("return f(...)" in f,
+// see isTailCall): the arguments are evaluated to new temporals where
+// they were pushed, copied to the parameters at the call, and the call
+// becomes a jump to the beginning of the subroutine:
+//   label TailCall :          (at the beginning)
+//      ...
+//      %p1 = arg1             (each "PUSH arg1")
+//      ...
+//      a1 = %p1               (CALL, the POPs and "_result = %r")
+//      goto TailCall
+//      return                 (left to removeUnreachableCode)
+// The frame is reused, so the recursion runs in constant memory. The
+// arrays must be passed on as the same parameter, and the locals must
+// not need the zeros of a new frame (see localsWrittenFirst).
+bool Optimizer::eliminateTailCalls(subroutine & subr, const code & program) {
+  const instructionList & lins = subr.get_instructions();
+  const std::string name = subr.get_name();
+  const std::size_t nParams = subr.params.size();
+  bool isFunction = nParams > 0 and subr.params.front().name == "_result";
+  // the tail calls and the PUSHes of their arguments
+  std::vector<std::pair<std::size_t, std::vector<std::size_t>>> calls;
+  for (std::size_t pc = 0; pc < lins.size(); ++pc) {
+    if (lins[pc].oper != instruction::_CALL or lins[pc].arg1.name() != name or
+        not isTailCall(lins, pc))
+      continue;
+    std::vector<std::size_t> pushes;
+    bool ok = callArguments(lins, pc, nParams, pushes) and
+              (not isFunction or not lins[pc + nParams].arg1.isNone());
+    std::size_t k = 0;
+    for (auto & param : subr.params) {
+      const operand & arg = lins[pushes[k++]].arg1;
+      if (ok and isArrayParam(param) and arg != operand::variable(param.name)) ok = false;
+    }
+    if (ok) calls.push_back(std::make_pair(pc, pushes));
+  }
+  if (calls.empty() or not localsWrittenFirst(subr)) return false;
+  std::uint32_t nextTemp = 1;
+  for (auto & instr : lins) {
+    const operand * args[3] = { &instr.arg1, &instr.arg2, &instr.arg3 };
+    for (const operand * op : args)
+      if (op->isTemp() and op->id() >= nextTemp) nextTemp = op->id() + 1;
+  }
+  // the label of the beginning (a label there can be reused)
+  std::string entry = "TailCall";
+  bool newEntry = lins.empty() or lins[0].oper != instruction::_LABEL;
+  if (not newEntry) entry = lins[0].arg1.name();
+  for (int n = 1; newEntry and subr.has_label(operand::label(entry)); ++n)
+    entry = "TailCall" + std::to_string(n);
+  instructionList newLins = lins;
+  // the last calls first, so that the positions of the others do not change
+  for (auto call = calls.rbegin(); call != calls.rend(); ++call) {
+    std::size_t pc = call->first;
+    std::uint32_t line = newLins[pc].line;
+    instructionList copies;
+    std::size_t k = nParams;
+    for (auto param = subr.params.rbegin(); param != subr.params.rend(); ++param) {
+      std::size_t push = call->second[--k];
+      operand p = operand::variable(param->name);
+      if (param->name == "_result" or isArrayParam(*param) or newLins[push].arg1 == p)
+        newLins.erase(newLins.begin() + push);
+      else {
+        operand temp = operand::temporal(nextTemp++);
+        copies.push_back(instruction::LOAD(p, temp));
+        std::uint32_t pushLine = newLins[push].line;
+        newLins[push] = instruction::LOAD(temp, newLins[push].arg1);
+        newLins[push].line = pushLine;
+      }
+    }
+    // the call moved back with the erased PUSHes
+    pc -= nParams - copies.size();
+    std::size_t end = pc + 1 + nParams;
+    if (newLins[end].oper == instruction::_LOAD) ++end;
+    std::reverse(copies.begin(), copies.end());
+    copies.push_back(instruction::UJUMP(entry));
+    for (auto & instr : copies) instr.line = line;
+    newLins.erase(newLins.begin() + pc, newLins.begin() + end);
+    newLins.insert(newLins.begin() + pc, copies.begin(), copies.end());
+  }
+  if (newEntry) newLins.insert(newLins.begin(), instruction::LABEL(entry));
+  subr.set_instructions(std::move(newLins));
+  return true;
+}
+
+// Loop-invariant code motion: in every loop (see LoopInfo), the pure
+// instructions that define a temporal (its only definition) from
+// constants, arrays and names not written in the loop, or from other
+// invariants, are moved before the label of its header. That is only
+// done when the loop is entered by falling through to that label, as
+// the loops of visitWhileStmt are, so the moved instructions run once
+// before the loop. LOADX is not moved: the loop can write the array.
+// The inner loops come first and later rounds move the instructions
+// on to the enclosing loops.
+bool Optimizer::hoistLoopInvariants(subroutine & subr, const code & program) {
+  const instructionList & lins = subr.get_instructions();
+  ControlFlowGraph cfg(subr);
+  LoopInfo loops(cfg);
+  if (loops.getNumberOfLoops() == 0) return false;
+  std::vector<unsigned> uses, defs;
+  countTempUses(lins, uses, &defs);
+  const std::size_t NotMoved = static_cast<std::size_t>(-1);
+  std::vector<std::size_t> movedTo(lins.size(), NotMoved);
+  std::map<std::size_t, std::vector<std::size_t>> movedBefore;
+  for (std::size_t l = 0; l < loops.getNumberOfLoops(); ++l) {
+    const LoopInfo::Loop & loop = loops.getLoop(l);
+    // the label of the header, only reached from outside by falling through to it
+    std::size_t label = cfg.getBlock(loop.header).first;
+    if (label == 0 or lins[label].oper != instruction::_LABEL) continue;
+    const instruction & prev = lins[label - 1];
+    std::size_t entry = cfg.getBlockOf(label - 1);
+    if (prev.oper == instruction::_UJUMP or prev.oper == instruction::_RETURN or
+        prev.oper == instruction::_HALT or loops.contains(l, entry) or
+        (prev.oper == instruction::_FJUMP and prev.arg2 == lins[label].arg1))
+      continue;
+    bool fallsThrough = true;
+    for (std::size_t p : cfg.getBlock(loop.header).preds)
+      if (p != entry and not loops.contains(l, p)) fallsThrough = false;
+    if (not fallsThrough) continue;
+    // the names written in the loop
+    std::set<operand> written;
+    for (std::size_t b : loop.blocks)
+      for (std::size_t pc = cfg.getBlock(b).first; pc < cfg.getBlock(b).last; ++pc) {
+        operand * d = definedOperand(const_cast<instruction &>(lins[pc]));
+        if (d) written.insert(*d);
+      }
+    // the invariants, in the order of the code, until no more are found
+    std::set<operand> invariant;
+    for (bool found = true; found; ) {
+      found = false;
+      for (std::size_t b : loop.blocks)
+        for (std::size_t pc = cfg.getBlock(b).first; pc < cfg.getBlock(b).last; ++pc) {
+          // the operands are only read
+          instruction & instr = const_cast<instruction &>(lins[pc]);
+          if (movedTo[pc] != NotMoved or not isPure(instr.oper) or
+              instr.oper == instruction::_LOADX or instr.oper == instruction::_LOADC)
+            continue;
+          operand * d = definedOperand(instr);
+          if (not d->isTemp() or countOf(defs, *d) != 1) continue;
+          bool isInvariant = true;
+          for (operand * op : usedOperands(instr, true))
+            if (written.count(*op) and invariant.count(*op) == 0) isInvariant = false;
+          if (not isInvariant) continue;
+          invariant.insert(*d);
+          movedTo[pc] = label;
+          movedBefore[label].push_back(pc);
+          found = true;
+        }
+    }
+  }
+  if (movedBefore.empty()) return false;
+  instructionList newLins;
+  newLins.reserve(lins.size());
+  for (std::size_t pc = 0; pc < lins.size(); ++pc) {
+    auto it = movedBefore.find(pc);
+    // in the order they were found, after the invariants they use
+    if (it != movedBefore.end())
+      for (std::size_t moved : it->second) newLins.push_back(lins[moved]);
+    if (movedTo[pc] == NotMoved) newLins.push_back(lins[pc]);
+  }
+  subr.set_instructions(std::move(newLins));
+  return true;
+}
+
+// Expansion of ACOPY and AFILL into a loop over the elements, from the
+// last one to the first:
+//      %i = n
+//   label ACopyK :
+//      %c = %zero < %i
+//      ifFalse %c goto EndACopyK
+//      %i = %i - %one
+//      %e = b[%i]          (AFILL: %e is the value)
+//      a[%i] = %e
+//      goto ACopyK
+//   label EndACopyK :
+// The textual t-code is run by the tvm, which has no bulk operations.
+bool Optimizer::expandArrayOperations(subroutine & subr, const code & program) {
+  const instructionList & lins = subr.get_instructions();
+  std::uint32_t nextTemp = 1;
+  bool found = false;
+  for (auto & instr : lins) {
+    const operand * args[3] = { &instr.arg1, &instr.arg2, &instr.arg3 };
+    for (const operand * op : args)
+      if (op->isTemp() and op->id() >= nextTemp) nextTemp = op->id() + 1;
+    if (instr.oper == instruction::_ACOPY or instr.oper == instruction::_AFILL)
+      found = true;
+  }
+  if (not found) return false;
+  instructionList newLins;
+  newLins.reserve(lins.size());
+  int nLoops = 0;
+  for (auto & instr : lins) {
+    if (instr.oper != instruction::_ACOPY and instr.oper != instruction::_AFILL) {
+      newLins.push_back(instr);
+      continue;
+    }
+    std::string labelStart, labelEnd;
+    do {
+      ++nLoops;
+      labelStart = "ACopy" + std::to_string(nLoops);
+      labelEnd   = "End" + labelStart;
+    } while (subr.has_label(operand::label(labelStart)) or
+             subr.has_label(operand::label(labelEnd)));
+    operand one  = operand::temporal(nextTemp++);
+    operand zero = operand::temporal(nextTemp++);
+    operand i    = operand::temporal(nextTemp++);
+    operand cond = operand::temporal(nextTemp++);
+    operand elem = instr.arg2;
+    if (instr.oper == instruction::_ACOPY or elem.isConst())
+      elem = operand::temporal(nextTemp++);
+    std::size_t first = newLins.size();
+    newLins.push_back(instruction::ILOAD(one, "1"));
+    newLins.push_back(instruction::ILOAD(zero, "0"));
+    newLins.push_back(instruction::LOAD(i, instr.arg3));
+    if (instr.oper == instruction::_AFILL and instr.arg2.isConst())
+      newLins.push_back(immediateLoad(elem, instr.arg2));
+    newLins.push_back(instruction::LABEL(labelStart));
+    newLins.push_back(instruction::LT(cond, zero, i));
+    newLins.push_back(instruction::FJUMP(cond, labelEnd));
+    newLins.push_back(instruction::SUB(i, i, one));
+    if (instr.oper == instruction::_ACOPY)
+      newLins.push_back(instruction::LOADX(elem, instr.arg2, i));
+    newLins.push_back(instruction::XLOAD(instr.arg1, i, elem));
+    newLins.push_back(instruction::UJUMP(labelStart));
+    newLins.push_back(instruction::LABEL(labelEnd));
+    for (std::size_t k = first; k < newLins.size(); ++k)
+      newLins[k].line = instr.line;
+  }
+  subr.set_instructions(std::move(newLins));
+  return true;
+}
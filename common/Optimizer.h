@@ -0,0 +1,105 @@
+/////////////////////////////////////////////////////////////////
+//
+//    Optimizer - t-code optimization passes for the Asl programming language
+//
+//    Copyright (C) 2017-2023  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+
+#include <string>
+#include <vector>
+#include <utility>    // std::pair
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+////////////////////////////////////////////////////////////////////
+/// Class Optimizer runs a pipeline of passes over the t-code of every
+/// subroutine of a program. A pass rewrites the instructions of one
+/// subroutine (the whole program is available, e.g. to look at the
+/// callees) and returns true if it has changed anything.
+///
+/// Optimization levels:
+///   -O0: no pass at all (the code of CodeGenVisitor as is)
+///   -O1: local constant folding, copy propagation and dead temporals
+///   -O2: the -O1 passes plus inlining of small leaf subroutines,
+///        elimination of self-recursive tail calls, copy coalescing,
+///        unreachable code removal and loop-invariant code motion,
+///        repeated until the code does not change
+
+class Optimizer {
+
+ public:
+  /// a pass over one subroutine of the program
+  typedef bool (*Pass)(subroutine & subr, const code & program);
+
+  /// constructor: the pipeline of the given optimization level
+  Optimizer(int level = 0);
+
+  /// add a pass at the end of the pipeline
+  void addPass(const std::string & name, Pass pass);
+
+  /// optimize every subroutine of the program
+  void run(code & program) const;
+
+  /// ------ passes -------
+
+  /// local constant folding of operations on ILOADed immediates
+  static bool foldConstants(subroutine & subr, const code & program);
+  /// local copy propagation of "a1 = a2" to the uses of a1
+  static bool propagateCopies(subroutine & subr, const code & program);
+  /// removal of the instructions defining temporals that are never used
+  static bool removeDeadTemps(subroutine & subr, const code & program);
+  /// the calls to small subroutines that call nobody are replaced by their body
+  static bool inlineCalls(subroutine & subr, const code & program);
+  /// the self-recursive calls in tail position become a jump to the beginning
+  static bool eliminateTailCalls(subroutine & subr, const code & program);
+  /// "%t = a2 op a3; a1 = %t" becomes "a1 = a2 op a3"
+  static bool coalesceCopies(subroutine & subr, const code & program);
+  /// removal of the blocks unreachable from the entry, useless jumps and unused labels
+  static bool removeUnreachableCode(subroutine & subr, const code & program);
+  /// the invariant computations of the loops are moved before them
+  static bool hoistLoopInvariants(subroutine & subr, const code & program);
+
+  /// ------ lowering -------
+
+  /// ACOPY and AFILL become a loop of LOADX/XLOAD
+  static bool expandArrayOperations(subroutine & subr, const code & program);
+
+ private:
+  /// the pipeline
+  std::vector<std::pair<std::string, Pass>> Passes;
+  /// run the pipeline again while it changes the code (at most MaxRounds)
+  bool UntilFixpoint;
+
+  static const int MaxRounds = 10;
+  /// budgets of inlineCalls: instructions of the inlined subroutine
+  /// (without labels) and of the caller, that stops growing at that size
+  static const std::size_t MaxInlineSize = 16;
+  static const std::size_t MaxInlinedCallerSize = 2000;
+};
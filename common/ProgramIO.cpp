@@ -0,0 +1,206 @@
+/////////////////////////////////////////////////////////////////
+//
+//    ProgramIO - buffered input/output of the programs for the Asl programming language
+//
+//    Copyright (C) 2017-2023  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#include "ProgramIO.h"
+
+#include <cstdio>     // std::snprintf
+#include <cstdlib>    // std::strtof
+#include <cstring>    // std::memcpy
+#include <cstdint>    // INT32_MAX
+
+// using namespace std;
+
+
+////////////////////////////////////////////////////////////////////
+// Class OutputBuffer
+
+const std::size_t OutputBuffer::Capacity = 1 << 16;
+
+OutputBuffer::OutputBuffer(std::ostream & os)
+  : Out(os), Buffer(Capacity), Size(0) {
+}
+
+OutputBuffer::~OutputBuffer() {
+  flush();
+}
+
+void OutputBuffer::reserve(std::size_t n) {
+  if (Size + n > Capacity) flush();
+}
+
+void OutputBuffer::writeInt(std::int32_t x) {
+  reserve(11);
+  // the digits backwards, from the magnitude as unsigned (so that
+  // the smallest int has one)
+  char digits[10];
+  std::size_t n = 0;
+  std::uint32_t u = (x < 0 ? 0u - std::uint32_t(x) : std::uint32_t(x));
+  do {
+    digits[n++] = char('0' + u % 10);
+    u /= 10;
+  } while (u != 0);
+  if (x < 0) Buffer[Size++] = '-';
+  while (n > 0) Buffer[Size++] = digits[--n];
+}
+
+void OutputBuffer::writeFloat(float x) {
+  reserve(32);
+  Size += std::snprintf(&Buffer[Size], 32, "%g", double(x));
+}
+
+void OutputBuffer::writeChar(char c) {
+  reserve(1);
+  Buffer[Size++] = c;
+}
+
+void OutputBuffer::write(const char * s, std::size_t n) {
+  if (n > Capacity) {
+    flush();
+    Out.write(s, n);
+    Out.flush();
+    return;
+  }
+  reserve(n);
+  std::memcpy(&Buffer[Size], s, n);
+  Size += n;
+}
+
+void OutputBuffer::flush() {
+  if (Size == 0) return;
+  Out.write(Buffer.data(), Size);
+  Out.flush();
+  Size = 0;
+}
+
+
+////////////////////////////////////////////////////////////////////
+// Class InputReader
+
+namespace {
+
+  bool isSpace(int c) {
+    return c == ' ' or c == '\n' or c == '\t' or c == '\r' or c == '\v' or c == '\f';
+  }
+
+  bool isDigit(int c) {
+    return c >= '0' and c <= '9';
+  }
+
+}  // namespace
+
+InputReader::InputReader(std::istream & is, OutputBuffer & output)
+  : In(is.rdbuf()), Output(output), Failed(false) {
+}
+
+int InputReader::peek() {
+  // the buffer of the stream is empty: it may wait for the user
+  if (In->in_avail() <= 0) Output.flush();
+  return In->sgetc();
+}
+
+bool InputReader::skipSpaces() {
+  int c;
+  while ((c = peek()) != EOF and isSpace(c)) In->sbumpc();
+  if (c == EOF) Failed = true;
+  return not Failed;
+}
+
+bool InputReader::readInt(std::int32_t & x) {
+  x = 0;
+  if (Failed or not skipSpaces()) return false;
+  bool negative = false;
+  int c = peek();
+  if (c == '-' or c == '+') {
+    negative = (c == '-');
+    In->sbumpc();
+    c = peek();
+  }
+  if (not isDigit(c)) {
+    Failed = true;
+    return false;
+  }
+  // the magnitude, up to the one of the smallest int
+  const std::int64_t limit = std::int64_t(INT32_MAX) + (negative ? 1 : 0);
+  std::int64_t value = 0;
+  bool overflow = false;
+  while (isDigit(c)) {
+    value = value * 10 + (c - '0');
+    if (value > limit) {
+      overflow = true;
+      value = limit;
+    }
+    In->sbumpc();
+    c = peek();
+  }
+  x = std::int32_t(negative ? -value : value);
+  if (overflow) Failed = true;
+  return not Failed;
+}
+
+bool InputReader::readFloat(float & x) {
+  x = 0;
+  if (Failed or not skipSpaces()) return false;
+  // the characters of the number: [sign] digits [. digits] [e [sign] digits]
+  const std::size_t MaxChars = 64;
+  char chars[MaxChars + 1];
+  std::size_t n = 0;
+  auto take = [&]() {
+    int c = In->sbumpc();
+    if (n < MaxChars) chars[n++] = char(c);
+  };
+  int c = peek();
+  if (c == '-' or c == '+') { take(); c = peek(); }
+  bool digits = false;
+  while (isDigit(c)) { take(); digits = true; c = peek(); }
+  if (c == '.') {
+    take();
+    while (isDigit(c = peek())) { take(); digits = true; }
+  }
+  if (digits and (c == 'e' or c == 'E')) {
+    take();
+    c = peek();
+    if (c == '-' or c == '+') { take(); c = peek(); }
+    while (isDigit(c)) { take(); c = peek(); }
+  }
+  chars[n] = '\0';
+  char * end = nullptr;
+  float value = std::strtof(chars, &end);
+  if (not digits or end != chars + n) {
+    Failed = true;
+    return false;
+  }
+  x = value;
+  return true;
+}
+
+bool InputReader::readChar(char & ch) {
+  ch = 0;
+  if (Failed or not skipSpaces()) return false;
+  ch = char(In->sbumpc());
+  return true;
+}
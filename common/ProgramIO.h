@@ -0,0 +1,102 @@
+/////////////////////////////////////////////////////////////////
+//
+//    ProgramIO - buffered input/output of the programs for the Asl programming language
+//
+//    Copyright (C) 2017-2023  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+#include <cstddef>    // std::size_t
+#include <cstdint>    // std::int32_t
+
+// using namespace std;
+
+
+////////////////////////////////////////////////////////////////////
+/// Class OutputBuffer keeps the output of a program until it has a
+/// big block to give to the stream. Integers are formatted by hand;
+/// floats with "%g", as operator<< and printf do (6 significant
+/// digits). flush() also flushes the stream: it must be called before
+/// the program ends or waits for input.
+
+class OutputBuffer {
+
+ public:
+  /// constructor: the output goes to 'os'
+  OutputBuffer(std::ostream & os);
+  ~OutputBuffer();
+
+  void writeInt(std::int32_t x);
+  void writeFloat(float x);
+  void writeChar(char c);
+  void write(const char * s, std::size_t n);
+
+  /// give the kept output to the stream, and flush it
+  void flush();
+
+ private:
+  static const std::size_t Capacity;
+
+  std::ostream &    Out;
+  std::vector<char> Buffer;
+  std::size_t       Size;
+
+  /// make room for 'n' more characters
+  void reserve(std::size_t n);
+};
+
+
+////////////////////////////////////////////////////////////////////
+/// Class InputReader reads the values of a program from the buffer of
+/// a stream (with no formatting or locking by the stream), with the
+/// rules of operator>>: spaces are skipped and, once a read fails,
+/// every read fails and gets 0. Before the stream has to wait for
+/// more input, the output is flushed (a prompt must be seen first).
+
+class InputReader {
+
+ public:
+  /// constructor: the input comes from 'is'; 'output' is flushed
+  /// before waiting for it
+  InputReader(std::istream & is, OutputBuffer & output);
+
+  /// false (and 0) if there is no value of the type
+  bool readInt(std::int32_t & x);
+  bool readFloat(float & x);
+  bool readChar(char & c);
+
+ private:
+  std::streambuf * In;
+  OutputBuffer &   Output;
+  bool             Failed;
+
+  /// next character (EOF at the end), without taking it
+  int peek();
+  /// skip the spaces; false at the end of the input
+  bool skipSpaces();
+};
@@ -37,9 +37,12 @@
 // using namespace std;
 
 
+SemErrors::SemErrors(std::ostream & os) : OS(&os) {
+}
+
 void SemErrors::print() {
   std::sort(ErrorList.begin(), ErrorList.end(), less);  
-  for (auto & error : ErrorList) error.print();
+  for (auto & error : ErrorList) error.print(*OS);
 }
 
 bool SemErrors::less(const ErrorInfo & e1, const ErrorInfo & e2) {
@@ -142,7 +145,11 @@ void SemErrors::nonReferenceableExpression(antlr4::ParserRuleContext *ctx) {
 }
 
 void SemErrors::noMainProperlyDeclared(antlr4::ParserRuleContext *ctx) {
-  ErrorInfo error(ctx->getStop()->getLine(), ctx->getStop()->getCharPositionInLine(), "There is no 'main' function properly declared.");
+  noMainProperlyDeclared(ctx->getStop()->getLine(), ctx->getStop()->getCharPositionInLine());
+}
+
+void SemErrors::noMainProperlyDeclared(std::size_t line, std::size_t coln) {
+  ErrorInfo error(line, coln, "There is no 'main' function properly declared.");
   ErrorList.push_back(error);
 }
 
@@ -150,8 +157,8 @@ SemErrors::ErrorInfo::ErrorInfo(std::size_t line, std::size_t coln, std::string
   : line{line}, coln{coln}, message{message} {
 }
 
-void SemErrors::ErrorInfo::print() const {
-  std::cout << "Line " << line << ":" << coln << " error: " << message << std::endl;
+void SemErrors::ErrorInfo::print(std::ostream & os) const {
+  os << "Line " << line << ":" << coln << " error: " << message << std::endl;
 }
 
 std::size_t SemErrors::ErrorInfo::getLine() const {
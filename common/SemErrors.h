@@ -32,6 +32,7 @@
 
 #include <string>
 #include <vector>
+#include <iostream>
 
 // using namespace std;
 
@@ -51,6 +52,8 @@ public:
 
   // Constructor
   SemErrors() = default;
+  // Constructor: the errors are written to 'os' (std::cout by default)
+  SemErrors(std::ostream & os);
 
   // Write the semantic errors ordered by line number
   void print ();
@@ -104,6 +107,8 @@ public:
   void nonReferenceableExpression   (antlr4::ParserRuleContext *ctx);
   //   ctx is the program node (grammar start symbol) 
   void noMainProperlyDeclared       (antlr4::ParserRuleContext *ctx);
+  //   (at the given position: the end of the program)
+  void noMainProperlyDeclared       (std::size_t line, std::size_t coln);
 
 
 private:
@@ -115,7 +120,7 @@ private:
     std::size_t getLine() const;
     std::size_t getColumnInLine() const;
     std::string getMessage() const;
-    void print() const;
+    void print(std::ostream & os) const;
   private:
     std::size_t line, coln;
     std::string message;
@@ -123,6 +128,8 @@ private:
 
   // List of semantic errors
   std::vector<ErrorInfo> ErrorList;
+  // Where print writes them
+  std::ostream * OS = &std::cout;
 
   // Compare two errors to determine the order (needed in print)
   static bool less(const ErrorInfo & e1, const ErrorInfo & e2);
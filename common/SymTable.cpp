@@ -46,7 +46,7 @@ const std::string SymTable::GLOBAL_SCOPE_NAME = "$global$";
 
 // Constructor
 SymTable::SymTable(TypesMgr & Types) :
-  Types{Types} {
+  Types{Types}, SymbolNames(1) {
 }
 
 // Creates a new scope, push its ScopeId in the stack
@@ -54,6 +54,7 @@ SymTable::SymTable(TypesMgr & Types) :
 SymTable::ScopeId SymTable::pushNewScope(const std::string & name) {
   ScopeId currScope = ScopesVec.size();
   ScopesVec.push_back(ScopeInfo(name));
+  ScopeOfName.insert({intern(name), currScope});
   ScopeIdsStack.push_back(currScope);
   return currScope;
 }
@@ -76,12 +77,61 @@ SymTable::ScopeId SymTable::topScope() const {
   return ScopeIdsStack.back();
 }
 
+// Remove the symbols of a scope that is not in the stack
+void SymTable::clearScope(ScopeId scope) {
+  assert(scope < ScopesVec.size());
+  ScopesVec[scope] = ScopeInfo(ScopesVec[scope].getName());
+}
+
+// Returns the SymbolId of ident, interning it if needed
+SymTable::SymbolId SymTable::intern(const std::string & ident) {
+  auto it = SymbolIds.find(ident);
+  if (it != SymbolIds.end())
+    return it->second;
+  SymbolId id = SymbolNames.size();
+  SymbolNames.push_back(ident);
+  SymbolIds.insert({ident, id});
+  return id;
+}
+
+// Returns the SymbolId of ident, or NO_SYMBOL_ID if it is not interned
+SymTable::SymbolId SymTable::getSymbolId(const std::string & ident) const {
+  auto it = SymbolIds.find(ident);
+  if (it == SymbolIds.end())
+    return NO_SYMBOL_ID;
+  return it->second;
+}
+
+// Returns the name of an interned identifier
+const std::string & SymTable::getName(SymbolId id) const {
+  assert(id < SymbolNames.size());
+  return SymbolNames[id];
+}
+
+// Returns the innermost scope of the stack where the symbol is
+// declared, or ScopesVec.size() if it is not found
+SymTable::ScopeId SymTable::findScopeOf(SymbolId id) const {
+  assert(not ScopeIdsStack.empty());
+  if (id != NO_SYMBOL_ID) {
+    for (int i = ScopeIdsStack.size() - 1; i >= 0; --i) {
+      ScopeId sc = ScopeIdsStack[i];
+      assert(sc < ScopesVec.size());
+      if (ScopesVec[sc].findSymbol(id))
+        return sc;
+    }
+  }
+  return ScopesVec.size();
+}
+
 // Returns true if ident occurs in the current scope (top of the stack)
 bool SymTable::findInCurrentScope(const std::string & ident) const {
+  return findInCurrentScope(getSymbolId(ident));
+}
+bool SymTable::findInCurrentScope(SymbolId id) const {
   assert(not ScopeIdsStack.empty());
   ScopeId currScope = ScopeIdsStack.back();
   assert(currScope < ScopesVec.size());
-  return (ScopesVec[currScope].findSymbol(ident));
+  return id != NO_SYMBOL_ID and ScopesVec[currScope].findSymbol(id);
 }
 
 // Returns an iteger >= 0 if ident occurs in some of the scopes
@@ -89,12 +139,17 @@ bool SymTable::findInCurrentScope(const std::string & ident) const {
 // If it occurs in the scope below the top returns 1, and so on.
 // Returns -1 if te symbol is not found.
 int SymTable::findInStack(const std::string & ident) const {
+  return findInStack(getSymbolId(ident));
+}
+int SymTable::findInStack(SymbolId id) const {
   assert(not ScopeIdsStack.empty());
+  if (id == NO_SYMBOL_ID)
+    return -1;
   int d = 0;
   for (int i = ScopeIdsStack.size() - 1; i >= 0; --i) {
     ScopeId sc = ScopeIdsStack[i];
     assert(sc < ScopesVec.size());
-    if (ScopesVec[sc].findSymbol(ident))
+    if (ScopesVec[sc].findSymbol(id))
       return d;
     ++d;
   }
@@ -106,65 +161,55 @@ void SymTable::addLocalVar(const std::string & ident, TypesMgr::TypeId type) {
   assert(not ScopeIdsStack.empty());
   ScopeId currScope = ScopeIdsStack.back();
   assert(currScope < ScopesVec.size());
-  ScopesVec[currScope].addLocalVar(ident, type);
+  ScopesVec[currScope].addLocalVar(intern(ident), type);
 }
 void SymTable::addParameter(const std::string & ident, TypesMgr::TypeId type) {
   assert(not ScopeIdsStack.empty());
   ScopeId currScope = ScopeIdsStack.back();
   assert(currScope < ScopesVec.size());
-  ScopesVec[currScope].addParameter(ident, type);
+  ScopesVec[currScope].addParameter(intern(ident), type);
 }
 
 void SymTable::addFunction(const std::string & ident, TypesMgr::TypeId type) {
   assert(not ScopeIdsStack.empty());
   ScopeId currScope = ScopeIdsStack.back();
   assert(currScope < ScopesVec.size());
-  ScopesVec[currScope].addFunction(ident, type);
+  ScopesVec[currScope].addFunction(intern(ident), type);
 }
 
 // Check the class of a symbol. If not found return false
 bool SymTable::isLocalVarClass(const std::string & ident) const {
-  assert(not ScopeIdsStack.empty());
-  for (int i = ScopeIdsStack.size() - 1; i >= 0; --i) {
-    ScopeId sc = ScopeIdsStack[i];
-    assert(sc < ScopesVec.size());
-    if (ScopesVec[sc].findSymbol(ident))
-      return ScopesVec[sc].isLocalVarClass(ident);
-  }
-  return false;
+  return isLocalVarClass(getSymbolId(ident));
+}
+bool SymTable::isLocalVarClass(SymbolId id) const {
+  ScopeId sc = findScopeOf(id);
+  return sc < ScopesVec.size() and ScopesVec[sc].isLocalVarClass(id);
 }
 
 bool SymTable::isParameterClass(const std::string & ident) const {
-  assert(not ScopeIdsStack.empty());
-  for (int i = ScopeIdsStack.size() - 1; i >= 0; --i) {
-    ScopeId sc = ScopeIdsStack[i];
-    assert(sc < ScopesVec.size());
-    if (ScopesVec[sc].findSymbol(ident))
-      return ScopesVec[sc].isParameterClass(ident);
-  }
-  return false;
+  return isParameterClass(getSymbolId(ident));
+}
+bool SymTable::isParameterClass(SymbolId id) const {
+  ScopeId sc = findScopeOf(id);
+  return sc < ScopesVec.size() and ScopesVec[sc].isParameterClass(id);
 }
 
 bool SymTable::isFunctionClass(const std::string & ident) const {
-  assert(not ScopeIdsStack.empty());
-  for (int i = ScopeIdsStack.size() - 1; i >= 0; --i) {
-    ScopeId sc = ScopeIdsStack[i];
-    assert(sc < ScopesVec.size());
-    if (ScopesVec[sc].findSymbol(ident))
-      return ScopesVec[sc].isFunctionClass(ident);
-  }
-  return false;
+  return isFunctionClass(getSymbolId(ident));
+}
+bool SymTable::isFunctionClass(SymbolId id) const {
+  ScopeId sc = findScopeOf(id);
+  return sc < ScopesVec.size() and ScopesVec[sc].isFunctionClass(id);
 }
 
 // Get the TypeId of a symbol. If not found return type 'error'
 TypesMgr::TypeId SymTable::getType(const std::string & ident) const {
-  assert(not ScopeIdsStack.empty());
-  for (int i = ScopeIdsStack.size() - 1; i >= 0; --i) {
-    ScopeId sc = ScopeIdsStack[i];
-    assert(sc < ScopesVec.size());
-    if (ScopesVec[sc].findSymbol(ident))
-      return ScopesVec[sc].getType(ident);
-  }
+  return getType(getSymbolId(ident));
+}
+TypesMgr::TypeId SymTable::getType(SymbolId id) const {
+  ScopeId sc = findScopeOf(id);
+  if (sc < ScopesVec.size())
+    return ScopesVec[sc].getType(id);
   return Types.createErrorTy();
 }
 
@@ -172,10 +217,12 @@ bool SymTable::noMainProperlyDeclared() const {
   assert(not ScopeIdsStack.empty());
   ScopeId currScope = ScopeIdsStack.back();
   assert(currScope < ScopesVec.size());
-  if ((not ScopesVec[currScope].findSymbol("main")) or
-      (not ScopesVec[currScope].isFunctionClass("main")))
+  SymbolId main = getSymbolId("main");
+  if ((main == NO_SYMBOL_ID) or
+      (not ScopesVec[currScope].findSymbol(main)) or
+      (not ScopesVec[currScope].isFunctionClass(main)))
     return true;
-  TypesMgr::TypeId tid = ScopesVec[currScope].getType("main");
+  TypesMgr::TypeId tid = ScopesVec[currScope].getType(main);
   if (Types.isFunctionTy(tid) and
       (Types.getNumOfParameters(tid) == 0) and
       Types.isVoidFunction(tid))
@@ -183,21 +230,28 @@ bool SymTable::noMainProperlyDeclared() const {
   return true;
 }
 
+// Number of symbols declared in all the scopes
+std::size_t SymTable::getNumberOfSymbols() const {
+  std::size_t n = 0;
+  for (auto & scope : ScopesVec)
+    n += scope.getNumberOfSymbols();
+  return n;
+}
+
 // Given the name of a function, returns its TypeId
 TypesMgr::TypeId SymTable::getGlobalFunctionType(const std::string & ident) const {
   assert(not ScopesVec.empty());
-  TypesMgr::TypeId tid = ScopesVec[0].getType(ident);
+  TypesMgr::TypeId tid = ScopesVec[0].getType(getSymbolId(ident));
   return tid;
 }
 
 // Given the names of a function and a local symbol, returns its TypeId
 TypesMgr::TypeId SymTable::getLocalSymbolType(const std::string & funcName,
                                               const std::string & ident) const {
-  for (std::size_t i = 1; i < ScopesVec.size(); ++i) {
-    if (ScopesVec[i].getName() == funcName) {
-      TypesMgr::TypeId tid = ScopesVec[i].getType(ident);
-      return tid;
-    }
+  auto it = ScopeOfName.find(getSymbolId(funcName));
+  if (it != ScopeOfName.end() and it->second != 0) {
+    TypesMgr::TypeId tid = ScopesVec[it->second].getType(getSymbolId(ident));
+    return tid;
   }
   return Types.createErrorTy();
 }
@@ -208,7 +262,7 @@ void SymTable::printCurrentScope() const {
   assert(not ScopeIdsStack.empty());
   ScopeId currScope = ScopeIdsStack.back();
   assert(currScope < ScopesVec.size());
-  ScopesVec[currScope].print(Types);
+  ScopesVec[currScope].print(*this);
 }
 
 // Write the contents of the symbol table on the standard output
@@ -217,7 +271,7 @@ void SymTable::print() const {
   for (int i = ScopeIdsStack.size() - 1; i >= 0; --i) {
     ScopeId sc = ScopeIdsStack[i];
     assert(sc < ScopesVec.size());
-    ScopesVec[sc].print(Types);
+    ScopesVec[sc].print(*this);
   }
   std::cout << "----------------" << std::endl;
 }
@@ -233,64 +287,102 @@ SymTable::ScopeInfo::ScopeInfo(const std::string & name)
 std::string SymTable::ScopeInfo::getName() const {
   return name;
 }
+std::size_t SymTable::ScopeInfo::getNumberOfSymbols() const {
+  return IdentsList.size();
+}
+
+// Returns the position of the symbol in SymbolsList, or
+// SymbolsList.size() if it is not declared in this scope
+std::size_t SymTable::ScopeInfo::position(SymbolId id) const {
+  if (Slots.empty())
+    return SymbolsList.size();
+  std::size_t mask = Slots.size() - 1;
+  for (std::size_t h = hashOf(id) & mask; Slots[h] != 0; h = (h + 1) & mask) {
+    if (IdentsList[Slots[h] - 1] == id)
+      return Slots[h] - 1;
+  }
+  return SymbolsList.size();
+}
+
+// Adds a symbol that is not declared in this scope yet. The table
+// doubles (and is rebuilt) when it would become more than half full
+void SymTable::ScopeInfo::add(SymbolId id, const SymbolInfo & info) {
+  assert(position(id) == SymbolsList.size());
+  SymbolsList.push_back(info);
+  IdentsList.push_back(id);
+  if (2 * IdentsList.size() > Slots.size()) {
+    Slots.assign(Slots.empty() ? 8 : 2 * Slots.size(), 0);
+    for (std::size_t i = 0; i + 1 < IdentsList.size(); ++i)
+      insertSlot(IdentsList[i], i);
+  }
+  insertSlot(id, IdentsList.size() - 1);
+}
+
+// Stores the position of the symbol in the first free slot
+void SymTable::ScopeInfo::insertSlot(SymbolId id, std::size_t pos) {
+  std::size_t mask = Slots.size() - 1;
+  std::size_t h = hashOf(id) & mask;
+  while (Slots[h] != 0)
+    h = (h + 1) & mask;
+  Slots[h] = pos + 1;
+}
+
+// Multiplicative hashing: the SymbolIds are consecutive integers
+std::size_t SymTable::ScopeInfo::hashOf(SymbolId id) {
+  return (id * 2654435769u) >> 8;
+}
 
 // Mutators to add symbols to the scope
-void SymTable::ScopeInfo::addLocalVar(const std::string & ident, TypesMgr::TypeId type) {
-  assert(SymbolsMap.find(ident) == SymbolsMap.end());
-  SymbolsMap[ident] = SymbolInfo::createLocalVar(type);
-  IdentsList.push_back(ident);
+void SymTable::ScopeInfo::addLocalVar(SymbolId id, TypesMgr::TypeId type) {
+  add(id, SymbolInfo::createLocalVar(type));
 }
-void SymTable::ScopeInfo::addParameter(const std::string & ident, TypesMgr::TypeId type) {
-  assert(SymbolsMap.find(ident) == SymbolsMap.end());
-  SymbolsMap[ident] = SymbolInfo::createParameter(type);
-  IdentsList.push_back(ident);
+void SymTable::ScopeInfo::addParameter(SymbolId id, TypesMgr::TypeId type) {
+  add(id, SymbolInfo::createParameter(type));
 }
-void SymTable::ScopeInfo::addFunction(const std::string & ident, TypesMgr::TypeId type) {
-  assert(SymbolsMap.find(ident) == SymbolsMap.end());
-  SymbolsMap[ident] = SymbolInfo::createFunction(type);
-  IdentsList.push_back(ident);
+void SymTable::ScopeInfo::addFunction(SymbolId id, TypesMgr::TypeId type) {
+  add(id, SymbolInfo::createFunction(type));
 }
 
 // Accessor to check the existence of a symbol
-bool SymTable::ScopeInfo::findSymbol(const std::string & ident) const {
-  return (SymbolsMap.find(ident) != SymbolsMap.end());
+bool SymTable::ScopeInfo::findSymbol(SymbolId id) const {
+  return position(id) != SymbolsList.size();
 }
 
 // Accessors to check the class of the symbol. If not found return false
-bool SymTable::ScopeInfo::isLocalVarClass(const std::string & ident) const {
-  auto const & it = SymbolsMap.find(ident);
-  if (it == SymbolsMap.end())
+bool SymTable::ScopeInfo::isLocalVarClass(SymbolId id) const {
+  std::size_t pos = position(id);
+  if (pos == SymbolsList.size())
     return false;
-  return it->second.isLocalVarClass();
+  return SymbolsList[pos].isLocalVarClass();
 }
-bool SymTable::ScopeInfo::isParameterClass(const std::string & ident) const {
-  auto const & it = SymbolsMap.find(ident);
-  if (it == SymbolsMap.end())
+bool SymTable::ScopeInfo::isParameterClass(SymbolId id) const {
+  std::size_t pos = position(id);
+  if (pos == SymbolsList.size())
     return false;
-  return it->second.isParameterClass();
+  return SymbolsList[pos].isParameterClass();
 }
-bool SymTable::ScopeInfo::isFunctionClass(const std::string & ident) const {
-  auto const & it = SymbolsMap.find(ident);
-  if (it == SymbolsMap.end())
+bool SymTable::ScopeInfo::isFunctionClass(SymbolId id) const {
+  std::size_t pos = position(id);
+  if (pos == SymbolsList.size())
     return false;
-  return it->second.isFunctionClass();
+  return SymbolsList[pos].isFunctionClass();
 }
 
 // Accessor to get the TypeId of a symbol. The symbol MUST exist.
-TypesMgr::TypeId SymTable::ScopeInfo::getType(const std::string & ident) const {
-  assert(SymbolsMap.find(ident) != SymbolsMap.end());
-  auto const & it = SymbolsMap.find(ident);
-  return it->second.getType();
+TypesMgr::TypeId SymTable::ScopeInfo::getType(SymbolId id) const {
+  std::size_t pos = position(id);
+  assert(pos != SymbolsList.size());
+  return SymbolsList[pos].getType();
 }
 
 // Writes the contents of the scope to the standard output.
-void SymTable::ScopeInfo::print(TypesMgr & Types) const {
+void SymTable::ScopeInfo::print(const SymTable & Symbols) const {
   std::cout << "---------------- scope name: " << name << std::endl;
-  for (auto & id : IdentsList) {
-    auto const & it = SymbolsMap.find(id);
-    std::cout << id << ":" << it->second.class2string();
-    if (not it->second.isErrorClass()) {
-      std::cout << "," << Types.to_string(it->second.getType());
+  for (std::size_t i = 0; i < IdentsList.size(); ++i) {
+    const SymbolInfo & info = SymbolsList[i];
+    std::cout << Symbols.getName(IdentsList[i]) << ":" << info.class2string();
+    if (not info.isErrorClass()) {
+      std::cout << "," << Symbols.Types.to_string(info.getType());
     }
     std::cout << std::endl;
   }
@@ -31,10 +31,11 @@
 #include "TypesMgr.h"
 
 #include <string>
-#include <map>
 #include <vector>
+#include <unordered_map>
 
 #include <cstddef>    // std::size_t
+#include <cstdint>    // std::uint32_t
 // uncomment to disable assert()
 // #define NDEBUG
 #include <cassert>
@@ -57,6 +58,10 @@
 // scopes that determines which symbols are visible and
 // which are not. Entering in a function will push a new
 // scope to the stack and exiting will pop the stack.
+// Identifiers are interned: each different name gets a SymbolId,
+// and the scopes are hash tables keyed by SymbolId, so a lookup
+// costs one string hash (none if the caller keeps the SymbolId,
+// see IdentContext::symbolId) and an integer probe per scope.
 
 class SymTable {
 
@@ -65,8 +70,13 @@ public:
   // The ScopeId is an index in a vector
   typedef std::size_t ScopeId;
 
+  // The SymbolId is an index in the vector of interned names
+  typedef std::uint32_t SymbolId;
+
   // Name of the Global Scope
   static const std::string GLOBAL_SCOPE_NAME;
+  // SymbolId of the names that have never been interned
+  static const SymbolId    NO_SYMBOL_ID = 0;
 
   // Constructor
   SymTable(TypesMgr & Types);
@@ -82,13 +92,27 @@ public:
   void    pushThisScope (ScopeId sc);
   //   - returns the current scope
   ScopeId topScope      ()                          const;
+  //   - remove the symbols of a scope that is not needed anymore
+  //     (it must not be in the stack)
+  void    clearScope    (ScopeId sc);
+
+  // Interned identifiers
+  //   - returns the SymbolId of ident, interning it if needed
+  SymbolId            intern      (const std::string & ident);
+  //   - returns the SymbolId of ident, or NO_SYMBOL_ID if it has
+  //     never been interned (it is not declared anywhere)
+  SymbolId            getSymbolId (const std::string & ident)       const;
+  //   - returns the name of an interned identifier
+  const std::string & getName     (SymbolId id)                     const;
 
   // Methods to find an ident
   //   - in the current scope (top of the stack)
   bool    findInCurrentScope (const std::string & ident)             const;
+  bool    findInCurrentScope (SymbolId id)                           const;
   //   - in the whole stack. Returns the number of scopes skipped to
                           // find the symbol, or -1 if it is not found
   int     findInStack        (const std::string & ident)             const;
+  int     findInStack        (SymbolId id)                           const;
 
   // Adds a new symbol in the current scope
   void addLocalVar  (const std::string & ident, TypesMgr::TypeId type);
@@ -99,13 +123,20 @@ public:
   bool isLocalVarClass  (const std::string & ident) const;
   bool isParameterClass (const std::string & ident) const;
   bool isFunctionClass  (const std::string & ident) const;
+  bool isLocalVarClass  (SymbolId id)                const;
+  bool isParameterClass (SymbolId id)                const;
+  bool isFunctionClass  (SymbolId id)                const;
 
   // Accessor to get the TypeId of a symbol. If not found return type 'error'
   TypesMgr::TypeId getType (const std::string & ident) const;
+  TypesMgr::TypeId getType (SymbolId id)                const;
 
   // Check the existence of the "main" function
   bool noMainProperlyDeclared() const;
 
+  // Number of symbols declared in all the scopes
+  std::size_t getNumberOfSymbols() const;
+
   // Given the name of a function, returns its TypeId
   TypesMgr::TypeId getGlobalFunctionType (const std::string & ident) const;
   // Given the names of a function and a local symbol, returns its TypeId
@@ -124,9 +155,19 @@ private:
   class ScopeInfo;
 
   // Attributes:
-  TypesMgr               & Types;
-  std::vector<ScopeInfo>   ScopesVec;
-  std::vector<ScopeId>     ScopeIdsStack;
+  TypesMgr                 & Types;
+  std::vector<ScopeInfo>     ScopesVec;
+  std::vector<ScopeId>       ScopeIdsStack;
+  // The interned names: SymbolNames[id] is the name of SymbolId id
+  // (SymbolNames[NO_SYMBOL_ID] is empty)
+  std::vector<std::string>   SymbolNames;
+  std::unordered_map<std::string, SymbolId> SymbolIds;
+  // The first scope created for each function name
+  std::unordered_map<SymbolId, ScopeId>     ScopeOfName;
+
+  // Returns the innermost scope of the stack where the symbol is
+  // declared, or ScopesVec.size() if it is not found
+  ScopeId findScopeOf (SymbolId id) const;
 
   //////////////////////////////////////////////////////////////////
   // Class ScopeInfo: is declared inside SymTable and is private,
@@ -141,25 +182,27 @@ private:
 
     // Accessor to get the name of the scope
     std::string getName () const;
+    // Accessor to get the number of symbols of the scope
+    std::size_t getNumberOfSymbols () const;
 
     // Mutators to add symbols to the scope
-    void addLocalVar  (const std::string & ident, TypesMgr::TypeId type);
-    void addParameter (const std::string & ident, TypesMgr::TypeId type);
-    void addFunction  (const std::string & ident, TypesMgr::TypeId type);
+    void addLocalVar  (SymbolId id, TypesMgr::TypeId type);
+    void addParameter (SymbolId id, TypesMgr::TypeId type);
+    void addFunction  (SymbolId id, TypesMgr::TypeId type);
 
     // Accessor to check the existence of a symbol
-    bool findSymbol (const std::string & ident) const;
+    bool findSymbol (SymbolId id) const;
 
     // Accessors to check the class of the symbol. If not found return false
-    bool isLocalVarClass  (const std::string & ident) const;
-    bool isParameterClass (const std::string & ident) const;
-    bool isFunctionClass  (const std::string & ident) const;
+    bool isLocalVarClass  (SymbolId id) const;
+    bool isParameterClass (SymbolId id) const;
+    bool isFunctionClass  (SymbolId id) const;
 
     // Accessor to get the TypeId of a symbol. The symbol MUST exist
-    TypesMgr::TypeId getType (const std::string & ident) const;
+    TypesMgr::TypeId getType (SymbolId id) const;
 
     // Writes the contents of the scope to the standard output
-    void print (TypesMgr & Types) const;
+    void print (const SymTable & Symbols) const;
 
   private:
 
@@ -168,10 +211,22 @@ private:
 
     // For the name of the scope
     std::string name;
-    // The information associated to each identifier declared in this scope.
-    std::map<std::string, SymbolInfo> SymbolsMap;
-    // For remember the order in which the Ids where introduced.
-    std::vector<std::string> IdentsList;
+    // The information associated to each identifier declared in this
+    // scope, in the order in which the Ids where introduced.
+    std::vector<SymbolInfo> SymbolsList;
+    std::vector<SymbolId>   IdentsList;
+    // Open addressing hash table (linear probing, at most half full)
+    // from the SymbolId to its position in SymbolsList plus one
+    // (0 for an empty slot)
+    std::vector<std::uint32_t> Slots;
+
+    // Returns the position of the symbol in SymbolsList, or
+    // SymbolsList.size() if it is not declared in this scope
+    std::size_t        position   (SymbolId id) const;
+    // Adds a symbol that is not declared in this scope yet
+    void               add        (SymbolId id, const SymbolInfo & info);
+    void               insertSlot (SymbolId id, std::size_t pos);
+    static std::size_t hashOf     (SymbolId id);
 
 
     //////////////////////////////////////////////////////////////////
@@ -37,28 +37,47 @@
 #include <string>
 
 
+// Index of the node in the attribute arrays
+std::size_t TreeDecoration::index(antlr4::ParserRuleContext *ctx) const {
+  return static_cast<DecoratedContext *>(ctx)->decorationIndex;
+}
+
+std::size_t TreeDecoration::newIndex(antlr4::ParserRuleContext *ctx) {
+  std::size_t & i = static_cast<DecoratedContext *>(ctx)->decorationIndex;
+  if (i == DecoratedContext::NoIndex) {
+    i = ScopeDecor.size();
+    ScopeDecor.push_back(0);
+    TypeDecor.push_back(0);
+    IsLValueDecor.push_back(false);
+  }
+  return i;
+}
+
 // Getters:
 SymTable::ScopeId TreeDecoration::getScope(antlr4::ParserRuleContext *ctx) {
-  return ScopeDecor.get(ctx);
+  std::size_t i = index(ctx);
+  return i < ScopeDecor.size() ? ScopeDecor[i] : 0;
 }
 
 TypesMgr::TypeId TreeDecoration::getType(antlr4::ParserRuleContext *ctx) {
-  return TypeDecor.get(ctx);
+  std::size_t i = index(ctx);
+  return i < TypeDecor.size() ? TypeDecor[i] : 0;
 }
 
 bool TreeDecoration::getIsLValue(antlr4::ParserRuleContext *ctx) {
-  return IsLValueDecor.get(ctx);
+  std::size_t i = index(ctx);
+  return i < IsLValueDecor.size() and IsLValueDecor[i];
 }
 
 // Setters:
 void TreeDecoration::putScope(antlr4::ParserRuleContext *ctx, SymTable::ScopeId s) {
-  ScopeDecor.put(ctx, s);
+  ScopeDecor[newIndex(ctx)] = s;
 }
 
 void TreeDecoration::putType(antlr4::ParserRuleContext *ctx, TypesMgr::TypeId t) {
-  TypeDecor.put(ctx, t);
+  TypeDecor[newIndex(ctx)] = t;
 }
 
 void TreeDecoration::putIsLValue(antlr4::ParserRuleContext *ctx, bool b) {
-  IsLValueDecor.put(ctx, b);
+  IsLValueDecor[newIndex(ctx)] = b;
 }
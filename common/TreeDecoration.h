@@ -32,8 +32,11 @@
 #include "TypesMgr.h"
 #include "SymTable.h"
 
+#include "DecoratedContext.h"
+
 #include "antlr4-runtime.h"
-#include "tree/ParseTreeProperty.h"
+
+#include <vector>
 
 // using namespace std;
 
@@ -42,8 +45,9 @@
 // Class TreeDecoration: the nodes of the parser tree generated
 // by the antlr4 parser, whose base type is
 // antlr4::ParserRuleContext *, can have different attributes.
-// TreeDecoration groups all of them, and uses different
-// ParseTreeProperty to save this information.
+// TreeDecoration groups all of them, in one array per attribute
+// indexed by the decorationIndex of the node (see DecoratedContext):
+// a node gets the next index the first time an attribute is set.
 // Currently three kinds of attributes may be present:
 //   - scope, for nodes like the program, or functions
 //   - type, for expressions or type especification
@@ -76,8 +80,14 @@ public:
   void putIsLValue (antlr4::ParserRuleContext *ctx, bool b);
 
 private:
-  antlr4::tree::ParseTreeProperty<SymTable::ScopeId> ScopeDecor;
-  antlr4::tree::ParseTreeProperty<TypesMgr::TypeId>  TypeDecor;
-  antlr4::tree::ParseTreeProperty<bool>              IsLValueDecor;
+  // Index of the node, and the one it gets if it is new (all the
+  // arrays grow with it)
+  std::size_t index    (antlr4::ParserRuleContext *ctx) const;
+  std::size_t newIndex (antlr4::ParserRuleContext *ctx);
+
+  // The attributes of the nodes (0 or false if not set)
+  std::vector<SymTable::ScopeId> ScopeDecor;
+  std::vector<TypesMgr::TypeId>  TypeDecor;
+  std::vector<char>              IsLValueDecor;
 
 };  // class TreeDecoration
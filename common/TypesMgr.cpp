@@ -34,6 +34,7 @@
 #include <iostream>
 
 #include <cstddef>    // std::size_t
+#include <cctype>     // std::isdigit
 // uncomment to disable assert()
 // #define NDEBUG
 #include <cassert>
@@ -87,14 +88,36 @@ TypesMgr::TypeId TypesMgr::createVoidTy() {
 
 TypesMgr::TypeId TypesMgr::createFunctionTy(const std::vector<TypeId> & paramsTypes,
 					    TypeId returnType) {
-  TypesVec.push_back(Type(paramsTypes, returnType));
-  return TypesVec.size()-1;
+  std::vector<TypeId> key;
+  key.reserve(paramsTypes.size() + 2);
+  key.push_back(TypeKind::FunctionKind);
+  key.push_back(returnType);
+  key.insert(key.end(), paramsTypes.begin(), paramsTypes.end());
+  return internCompoundTy(key, Type(paramsTypes, returnType));
 }
 
 TypesMgr::TypeId TypesMgr::createArrayTy(unsigned int size,
 					 TypeId elemType) {
-  TypesVec.push_back(Type{size, elemType});
-  return TypesVec.size()-1;
+  std::vector<TypeId> key = {TypeKind::ArrayKind, size, elemType};
+  return internCompoundTy(key, Type{size, elemType});
+}
+
+TypesMgr::TypeId TypesMgr::internCompoundTy(const std::vector<TypeId> & key,
+					    const Type & t) {
+  auto it = CompoundTypes.find(key);
+  if (it != CompoundTypes.end())
+    return it->second;
+  TypesVec.push_back(t);
+  TypeId tid = TypesVec.size()-1;
+  CompoundTypes.insert({key, tid});
+  return tid;
+}
+
+std::size_t TypesMgr::TypeKeyHash::operator() (const std::vector<TypeId> & key) const {
+  std::size_t h = key.size();
+  for (TypeId tid : key)
+    h = (h ^ tid) * 1099511628211u;
+  return h;
 }
 
 // ----------------------------------------------------------------------
@@ -205,39 +228,10 @@ TypesMgr::TypeId TypesMgr::getArrayElemType(TypeId tid) const {
 // ----------------------------------------------------------------------
 // methods for checking different compatibilities of Types
 
+// the types are hash-consed: equal types have the same TypeId
 bool TypesMgr::equalTypes(TypeId tid1, TypeId tid2) const {
-  if (tid1 == tid2)
-    return true;
-  const Type & t1 = TypesVec.at(tid1);
-  const Type & t2 = TypesVec.at(tid2);
-  if (t1.getTypeKind() != t2.getTypeKind())
-    return false;
-  if (t1.isPrimitiveTy() and t2.isPrimitiveTy())
-    return true;
-  if (t1.isFunctionTy()) {  // or: if (t2.isFunctionTy()) {
-    if (t1.getNumOfParameters() != t2.getNumOfParameters())
-      return false;
-    TypeId tid1_aux;
-    TypeId tid2_aux;
-    for (unsigned int i = 0; i < t1.getNumOfParameters(); ++i) {
-      tid1_aux = t1.getParameterType(i);
-      tid2_aux = t2.getParameterType(i);
-      if (not equalTypes(tid1_aux, tid2_aux))
-	return false;
-    }
-    tid1_aux = t1.getFuncReturnType();
-    tid2_aux = t2.getFuncReturnType();
-    return equalTypes(tid1_aux, tid2_aux);
-  }
-  if (t1.isArrayTy()) {  // or: if (t2.isArrayTy()) {
-    if (t1.getArraySize() != t2.getArraySize()) {
-      return false;
-    }
-    TypeId tid1_aux = t1.getArrayElemType();
-    TypeId tid2_aux = t2.getArrayElemType();
-    return equalTypes(tid1_aux, tid2_aux);
-  }
-  return false;
+  assert(tid1 < TypesVec.size() and tid2 < TypesVec.size());
+  return tid1 == tid2;
 }
 
 bool TypesMgr::comparableTypes(TypeId tid1, TypeId tid2,
@@ -275,6 +269,13 @@ std::size_t TypesMgr::getSizeOfType (TypeId tid) const {
   return 0;
 }
 
+// ----------------------------------------------------------------------
+// number of different types
+
+std::size_t TypesMgr::getNumberOfTypes() const {
+  return TypesVec.size();
+}
+
 // ----------------------------------------------------------------------
 // methods to convert to string and print types
 
@@ -343,6 +344,51 @@ std::string TypesMgr::to_string_basic(TypeId tid) const {
   }
 }
 
+// the type written by to_string at position 'pos' of 's' (advanced
+// past it), or the error type
+static TypesMgr::TypeId typeFromString(TypesMgr & types, const std::string & s,
+                                       std::size_t & pos) {
+  auto skip = [&](const std::string & word) {
+    if (s.compare(pos, word.size(), word) != 0) return false;
+    pos += word.size();
+    return true;
+  };
+  if (skip("integer"))   return types.createIntegerTy();
+  if (skip("float"))     return types.createFloatTy();
+  if (skip("boolean"))   return types.createBooleanTy();
+  if (skip("character")) return types.createCharacterTy();
+  if (skip("void"))      return types.createVoidTy();
+  if (skip("array<")) {
+    std::size_t digits = 0;
+    unsigned int size = 0;
+    for ( ; pos < s.size() and std::isdigit((unsigned char)s[pos]); ++pos, ++digits)
+      size = 10*size + (s[pos] - '0');
+    if (digits == 0 or not skip(",")) return types.createErrorTy();
+    TypesMgr::TypeId elem = typeFromString(types, s, pos);
+    if (types.isErrorTy(elem) or not skip(">")) return types.createErrorTy();
+    return types.createArrayTy(size, elem);
+  }
+  if (skip("function<")) {
+    std::vector<TypesMgr::TypeId> params;
+    while (not skip(">")) {
+      if (not params.empty() and not skip(",")) return types.createErrorTy();
+      params.push_back(typeFromString(types, s, pos));
+      if (types.isErrorTy(params.back())) return types.createErrorTy();
+    }
+    if (not skip(":")) return types.createErrorTy();
+    TypesMgr::TypeId ret = typeFromString(types, s, pos);
+    if (types.isErrorTy(ret)) return types.createErrorTy();
+    return types.createFunctionTy(params, ret);
+  }
+  return types.createErrorTy();
+}
+
+TypesMgr::TypeId TypesMgr::from_string(const std::string & s) {
+  std::size_t pos = 0;
+  TypeId tid = typeFromString(*this, s, pos);
+  return pos == s.size() ? tid : createErrorTy();
+}
+
 
 // ======================================================================
 // class TypesMgr::Type
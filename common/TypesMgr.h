@@ -30,6 +30,7 @@
 
 #include <vector>
 #include <string>
+#include <unordered_map>
 #include <iostream>
 
 #include <cstddef>    // std::size_t
@@ -46,6 +47,9 @@
 // integer, float, boolean, character and void. Also it
 // recognizes two compound types: functions and fixed-size
 // arrays. Finally there exist a special type 'error'.
+// Compound types are hash-consed: creating a type that already
+// exists returns the same TypeId, so two types are structurally
+// equal if and only if their TypeId's are equal.
 
 class TypesMgr {
 
@@ -109,6 +113,9 @@ public:
   // Method to compute the size of a type (primitive type size = 1)
   std::size_t getSizeOfType (TypeId tid) const;
 
+  // Number of different types (primitive, error and compound)
+  std::size_t getNumberOfTypes () const;
+
   // Methods to convert to string and print types.
   std::string to_string (TypeId tidm) const;
   void        dump      (TypeId         tid,
@@ -116,14 +123,29 @@ public:
   // will return type name for basic types, element type name for arrays, 'none' for functions.
   // useful for GenCode add_var and add_param
   std::string to_string_basic (TypeId tidm) const;
+  // the type written by to_string (the error type if 's' is not one)
+  TypeId      from_string     (const std::string & s);
 
 private:
   // Forward declaration of class Type
   class Type;
 
+  // Hash of the key of a compound type
+  struct TypeKeyHash {
+    std::size_t operator() (const std::vector<TypeId> & key) const;
+  };
+
   // Attributes:
   //   - vector to save the Types
   std::vector<Type> TypesVec;
+  //   - the TypeId of every compound type, given its key: the kind
+  //     followed by the return type and parameters of a function, or
+  //     by the size and element type of an array
+  std::unordered_map<std::vector<TypeId>, TypeId, TypeKeyHash> CompoundTypes;
+
+  // Returns the TypeId of the compound type with this key, adding
+  // type t to TypesVec if it does not exist yet
+  TypeId internCompoundTy (const std::vector<TypeId> & key, const Type & t);
 
   // There are eight kinds of types:
   //   - an especial kind error,
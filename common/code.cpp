@@ -27,68 +27,281 @@
 ////////////////////////////////////////////////////////////////
 
 #include <iostream>
+#include <sstream>
 #include <vector>
+#include <utility>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdlib>
+#include <cstdio>
+#include <cctype>
+#include <cstring>
+#include <cmath>
 #include "code.h"
 #include "LLVMCodeGen.h"
+#include "Interpreter.h"
 
 using namespace std;
 
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'operand'
+
+// table of interned strings (names of variables, labels and functions,
+// and string constants). It is shared by all the compilations of the
+// process (threads, files of the batch mode, requests of the server),
+// and strings are never removed: it is bounded by the distinct texts
+// ever seen, which a server keeps from one request to the next.
+//
+// The texts are in chunks that are never moved (chunk c has
+// FirstChunk << c of them), so operand::name() reads them without the
+// lock: a text is written before intern() returns its index, and only
+// intern() (which adds texts and chunks) takes the lock
+namespace {
+  struct InternTable {
+    static const std::uint32_t FirstChunk = 1024;
+    static const unsigned      NumChunks = 23;  // (all the 32 bit indices)
+
+    std::mutex                                     mtx;
+    std::atomic<std::string *>                     chunks[NumChunks];
+    std::uint32_t                                  size;
+    std::unordered_map<std::string, std::uint32_t> ids;
+
+    InternTable() : size(0) {
+      for (auto & chunk : chunks) chunk.store(nullptr, std::memory_order_relaxed);
+    }
+    ~InternTable() {
+      for (auto & chunk : chunks) delete [] chunk.load(std::memory_order_relaxed);
+    }
+
+    // chunk and position in it of the text 'id'
+    static void locate(std::uint32_t id, unsigned & c, std::uint64_t & pos) {
+      std::uint64_t n = std::uint64_t(id) + FirstChunk;
+      c = 0;
+      while (n >= (std::uint64_t(FirstChunk) << (c + 1))) ++c;
+      pos = n - (std::uint64_t(FirstChunk) << c);
+    }
+
+    const std::string & text(std::uint32_t id) const {
+      unsigned c;
+      std::uint64_t pos;
+      locate(id, c, pos);
+      return chunks[c].load(std::memory_order_acquire)[pos];
+    }
+  };
+
+  InternTable & internTable() {
+    static InternTable table;
+    return table;
+  }
+
+  const std::string emptyText;
+
+  // value of the escape sequence '\c' of a char constant
+  char escapedChar(char c) {
+    switch (c) {
+    case 'b' : return '\b';
+    case 't' : return '\t';
+    case 'n' : return '\n';
+    case 'f' : return '\f';
+    case 'r' : return '\r';
+    default  : return c;    // \" \' and \\ .
+    }
+  }
+
+  // shortest text of a float constant that reads back the same value,
+  // in plain decimal notation and with a decimal point (the t-code has
+  // no exponents, and "3" would be an integer constant)
+  std::string floatText(float f) {
+    if (not std::isfinite(f)) return std::isnan(f) ? "nan" : (f < 0 ? "-inf" : "inf");
+    char buf[128];
+    for (int prec = 1; prec <= 9; ++prec) {
+      std::snprintf(buf, sizeof(buf), "%.*g", prec, f);
+      if (std::strtof(buf, nullptr) == f) break;
+    }
+    if (std::strchr(buf, 'e')) {
+      for (int prec = 1; prec <= 60; ++prec) {
+        std::snprintf(buf, sizeof(buf), "%.*f", prec, f);
+        if (std::strtof(buf, nullptr) == f) break;
+      }
+    }
+    std::string s = buf;
+    if (s.find('.') == std::string::npos) s += ".0";
+    return s;
+  }
+}
+
+/// Constructors
+operand::operand() : k{NONE} { v.u = 0; }
+
+operand::operand(Kind kind, std::uint32_t value) : k{std::uint8_t(kind)} { v.u = value; }
+
+operand::operand(const char *text) : operand(std::string(text)) { }
+
+operand::operand(const std::string &text) : k{NONE} {
+  v.u = 0;
+  if (text.empty()) return;
+  std::size_t i = (text[0] == '-' or text[0] == '+') ? 1 : 0;
+  if (text.size() > 1 and text[0] == '%' and std::isdigit(text[1])) {
+    k = TEMP;
+    v.u = std::uint32_t(std::strtoul(text.c_str() + 1, nullptr, 10));
+  }
+  else if (i < text.size() and (std::isdigit(text[i]) or text[i] == '.')) {
+    if (text.find_first_of(".eE") == std::string::npos) {
+      k = INT;
+      v.i = std::int32_t(std::strtol(text.c_str(), nullptr, 10));
+    }
+    else {
+      k = FLOAT;
+      v.f = std::strtof(text.c_str(), nullptr);
+    }
+  }
+  else {
+    k = VAR;
+    v.u = intern(text);
+  }
+}
+
+operand operand::temporal(std::uint32_t n) { return operand(TEMP, n); }
+operand operand::variable(const std::string &name) { return operand(VAR, intern(name)); }
+operand operand::intConst(std::int32_t n) { return operand(INT, std::uint32_t(n)); }
+operand operand::floatConst(float f) { operand op(FLOAT, 0); op.v.f = f; return op; }
+operand operand::charConst(const std::string &text) {
+  std::int32_t c = 0;
+  if (text.size() >= 2 and text[0] == '\\') c = (unsigned char)escapedChar(text[1]);
+  else if (not text.empty()) c = (unsigned char)text[0];
+  return operand(CHAR, std::uint32_t(c));
+}
+operand operand::label(const std::string &name) { return operand(LABEL, intern(name)); }
+operand operand::function(const std::string &name) { return operand(FUNC, intern(name)); }
+operand operand::stringConst(const std::string &text) { return operand(STRING, intern(text)); }
+
+/// Accessors
+operand::Kind operand::kind() const { return Kind(k); }
+bool operand::isNone() const { return k == NONE; }
+bool operand::isTemp() const { return k == TEMP; }
+bool operand::isVar() const { return k == VAR; }
+bool operand::isLabel() const { return k == LABEL; }
+bool operand::isConst() const { return k == INT or k == FLOAT or k == CHAR; }
+std::uint32_t operand::id() const { return v.u; }
+std::int32_t operand::intValue() const { return v.i; }
+float operand::floatValue() const { return v.f; }
+
+const std::string & operand::name() const {
+  if (k != VAR and k != LABEL and k != FUNC and k != STRING) return emptyText;
+  return internTable().text(v.u);
+}
+
+bool operand::operator==(const operand &op) const { return k == op.k and v.u == op.v.u; }
+bool operand::operator!=(const operand &op) const { return not (*this == op); }
+bool operand::operator<(const operand &op) const {
+  return k < op.k or (k == op.k and v.u < op.v.u);
+}
+
+/// index of the text in the table of interned strings
+std::uint32_t operand::intern(const std::string &text) {
+  InternTable & table = internTable();
+  std::lock_guard<std::mutex> lock(table.mtx);
+  std::unordered_map<std::string, std::uint32_t>::const_iterator it = table.ids.find(text);
+  if (it != table.ids.end()) return it->second;
+  std::uint32_t id = table.size;
+  unsigned c;
+  std::uint64_t pos;
+  InternTable::locate(id, c, pos);
+  std::string *chunk = table.chunks[c].load(std::memory_order_relaxed);
+  if (chunk == nullptr) {
+    chunk = new std::string[std::uint64_t(InternTable::FirstChunk) << c];
+    table.chunks[c].store(chunk, std::memory_order_release);
+  }
+  chunk[pos] = text;
+  ++table.size;
+  table.ids.insert(std::make_pair(text, id));
+  return id;
+}
+
+/// print (as written in the t-code)
+string operand::dump() const {
+  switch (k) {
+  case TEMP  : return "%" + std::to_string(v.u);
+  case INT   : return std::to_string(v.i);
+  case FLOAT : return floatText(v.f);
+  case CHAR  : {
+    switch (v.i) {
+    case '\b' : return "\\b";
+    case '\t' : return "\\t";
+    case '\n' : return "\\n";
+    case '\f' : return "\\f";
+    case '\r' : return "\\r";
+    case '\'' : return "\\'";
+    case '\\' : return "\\\\";
+    default   : return std::string(1, char(v.i));
+    }
+  }
+  case NONE  : return "";
+  default    : return name();
+  }
+}
+
+
 ////////////////////////////////////////////////////////////////////
 /// Implementation for class 'instruction'
 
 /// Constructor
 instruction::instruction(Operation op,
-                         const std::string &a1, const std::string &a2, const std::string &a3) {
+                         const operand &a1, const operand &a2, const operand &a3) {
   oper = op;
   arg1 = a1;
   arg2 = a2;
   arg3 = a3;
+  line = 0;
 }
 
-instruction instruction::LABEL(const std::string &a1) { return instruction(_LABEL, a1); }
-instruction instruction::UJUMP(const std::string &a1) { return instruction(_UJUMP, a1); }
-instruction instruction::FJUMP(const std::string &a1, const std::string &a2) { return instruction(_FJUMP, a1, a2); }
-instruction instruction::HALT(const std::string &a1) { return instruction(_HALT, a1); }
-instruction instruction::PUSH(const std::string &a1) { return instruction(_PUSH, a1); }
-instruction instruction::POP(const std::string &a1) { return instruction(_POP, a1); }
-instruction instruction::CALL(const std::string &a1) { return instruction(_CALL, a1); }
+instruction instruction::LABEL(const std::string &a1) { return instruction(_LABEL, operand::label(a1)); }
+instruction instruction::UJUMP(const std::string &a1) { return instruction(_UJUMP, operand::label(a1)); }
+instruction instruction::FJUMP(const operand &a1, const std::string &a2) { return instruction(_FJUMP, a1, operand::label(a2)); }
+instruction instruction::HALT(const std::string &a1) { return instruction(_HALT, operand::stringConst(a1)); }
+instruction instruction::PUSH(const operand &a1) { return instruction(_PUSH, a1); }
+instruction instruction::POP(const operand &a1) { return instruction(_POP, a1); }
+instruction instruction::CALL(const std::string &a1) { return instruction(_CALL, operand::function(a1)); }
 instruction instruction::RETURN() { return instruction(_RETURN); }
-instruction instruction::ADD(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_ADD, a1, a2, a3); }
-instruction instruction::SUB(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_SUB, a1, a2, a3); }
-instruction instruction::MUL(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_MUL, a1, a2, a3); }
-instruction instruction::DIV(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_DIV, a1, a2, a3); }
-instruction instruction::EQ(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_EQ, a1, a2, a3); }
-instruction instruction::LT(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_LT, a1, a2, a3); }
-instruction instruction::LE(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_LE, a1, a2, a3); }
-instruction instruction::AND(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_AND, a1, a2, a3); }
-instruction instruction::OR(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_OR, a1, a2, a3); }
-instruction instruction::FADD(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FADD, a1, a2, a3); }
-instruction instruction::FSUB(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FSUB, a1, a2, a3); }
-instruction instruction::FMUL(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FMUL, a1, a2, a3); }
-instruction instruction::FDIV(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FDIV, a1, a2, a3); }
-instruction instruction::FEQ(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FEQ, a1, a2, a3); }
-instruction instruction::FLT(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FLT, a1, a2, a3); }
-instruction instruction::FLE(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FLE, a1, a2, a3); }
-instruction instruction::NOT(const std::string &a1, const std::string &a2) { return instruction(_NOT, a1, a2); }
-instruction instruction::NEG(const std::string &a1, const std::string &a2) { return instruction(_NEG, a1, a2); }
-instruction instruction::FNEG(const std::string &a1, const std::string &a2) { return instruction(_FNEG, a1, a2); }
-instruction instruction::FLOAT(const std::string &a1, const std::string &a2) { return instruction(_FLOAT, a1, a2); }  
-instruction instruction::LOAD(const std::string &a1, const std::string &a2) { return instruction(_LOAD, a1, a2); }
-instruction instruction::ILOAD(const std::string &a1, const std::string &a2) { return instruction(_ILOAD, a1, a2); }
-instruction instruction::CHLOAD(const std::string &a1, const std::string &a2) { return instruction(_CHLOAD, a1, a2); }
-instruction instruction::FLOAD(const std::string &a1, const std::string &a2) { return instruction(_FLOAD, a1, a2); }
-instruction instruction::XLOAD(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_XLOAD, a1, a2, a3); }
-instruction instruction::LOADX(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_LOADX, a1, a2, a3); }
-instruction instruction::ALOAD(const std::string &a1, const std::string &a2) { return instruction(_ALOAD, a1, a2); }
-instruction instruction::LOADC(const std::string &a1, const std::string &a2) { return instruction(_LOADC, a1, a2); }
-instruction instruction::CLOAD(const std::string &a1, const std::string &a2) { return instruction(_CLOAD, a1, a2); }
-instruction instruction::READI(const std::string &a1) { return instruction(_READI, a1); }
-instruction instruction::READF(const std::string &a1) { return instruction(_READF, a1); }
-instruction instruction::READC(const std::string &a1) { return instruction(_READC, a1); }
-instruction instruction::WRITEI(const std::string &a1) { return instruction(_WRITEI, a1); }
-instruction instruction::WRITEF(const std::string &a1) { return instruction(_WRITEF, a1); }
-instruction instruction::WRITEC(const std::string &a1) { return instruction(_WRITEC, a1); }
-instruction instruction::WRITES(const std::string &a1) { return instruction(_WRITES, a1); }
+instruction instruction::ADD(const operand &a1, const operand &a2, const operand &a3) { return instruction(_ADD, a1, a2, a3); }
+instruction instruction::SUB(const operand &a1, const operand &a2, const operand &a3) { return instruction(_SUB, a1, a2, a3); }
+instruction instruction::MUL(const operand &a1, const operand &a2, const operand &a3) { return instruction(_MUL, a1, a2, a3); }
+instruction instruction::DIV(const operand &a1, const operand &a2, const operand &a3) { return instruction(_DIV, a1, a2, a3); }
+instruction instruction::EQ(const operand &a1, const operand &a2, const operand &a3) { return instruction(_EQ, a1, a2, a3); }
+instruction instruction::LT(const operand &a1, const operand &a2, const operand &a3) { return instruction(_LT, a1, a2, a3); }
+instruction instruction::LE(const operand &a1, const operand &a2, const operand &a3) { return instruction(_LE, a1, a2, a3); }
+instruction instruction::AND(const operand &a1, const operand &a2, const operand &a3) { return instruction(_AND, a1, a2, a3); }
+instruction instruction::OR(const operand &a1, const operand &a2, const operand &a3) { return instruction(_OR, a1, a2, a3); }
+instruction instruction::FADD(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FADD, a1, a2, a3); }
+instruction instruction::FSUB(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FSUB, a1, a2, a3); }
+instruction instruction::FMUL(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FMUL, a1, a2, a3); }
+instruction instruction::FDIV(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FDIV, a1, a2, a3); }
+instruction instruction::FEQ(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FEQ, a1, a2, a3); }
+instruction instruction::FLT(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FLT, a1, a2, a3); }
+instruction instruction::FLE(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FLE, a1, a2, a3); }
+instruction instruction::NOT(const operand &a1, const operand &a2) { return instruction(_NOT, a1, a2); }
+instruction instruction::NEG(const operand &a1, const operand &a2) { return instruction(_NEG, a1, a2); }
+instruction instruction::FNEG(const operand &a1, const operand &a2) { return instruction(_FNEG, a1, a2); }
+instruction instruction::FLOAT(const operand &a1, const operand &a2) { return instruction(_FLOAT, a1, a2); }  
+instruction instruction::LOAD(const operand &a1, const operand &a2) { return instruction(_LOAD, a1, a2); }
+instruction instruction::ILOAD(const operand &a1, const std::string &a2) { return instruction(_ILOAD, a1, operand::intConst(std::int32_t(std::strtol(a2.c_str(), nullptr, 10)))); }
+instruction instruction::CHLOAD(const operand &a1, const std::string &a2) { return instruction(_CHLOAD, a1, operand::charConst(a2)); }
+instruction instruction::FLOAD(const operand &a1, const std::string &a2) { return instruction(_FLOAD, a1, operand::floatConst(std::strtof(a2.c_str(), nullptr))); }
+instruction instruction::XLOAD(const operand &a1, const operand &a2, const operand &a3) { return instruction(_XLOAD, a1, a2, a3); }
+instruction instruction::LOADX(const operand &a1, const operand &a2, const operand &a3) { return instruction(_LOADX, a1, a2, a3); }
+instruction instruction::ALOAD(const operand &a1, const operand &a2) { return instruction(_ALOAD, a1, a2); }
+instruction instruction::LOADC(const operand &a1, const operand &a2) { return instruction(_LOADC, a1, a2); }
+instruction instruction::CLOAD(const operand &a1, const operand &a2) { return instruction(_CLOAD, a1, a2); }
+instruction instruction::ACOPY(const operand &a1, const operand &a2, const operand &a3) { return instruction(_ACOPY, a1, a2, a3); }
+instruction instruction::AFILL(const operand &a1, const operand &a2, const operand &a3) { return instruction(_AFILL, a1, a2, a3); }
+instruction instruction::READI(const operand &a1) { return instruction(_READI, a1); }
+instruction instruction::READF(const operand &a1) { return instruction(_READF, a1); }
+instruction instruction::READC(const operand &a1) { return instruction(_READC, a1); }
+instruction instruction::WRITEI(const operand &a1) { return instruction(_WRITEI, a1); }
+instruction instruction::WRITEF(const operand &a1) { return instruction(_WRITEF, a1); }
+instruction instruction::WRITEC(const operand &a1) { return instruction(_WRITEC, a1); }
+instruction instruction::WRITES(const std::string &a1) { return instruction(_WRITES, operand::stringConst(a1)); }
 instruction instruction::WRITELN() { return instruction(_WRITELN); }
 instruction instruction::NOOP() { return instruction(_NOOP); }
 
@@ -100,51 +313,53 @@ string instruction::dump() const {
   string s;
   string ind="   ";
   switch (oper) {
-  case instruction::_LABEL : { s = "label " + arg1 + " :"; ind = ""; break; }
-  case instruction::_UJUMP : { s = "goto " + arg1; break; }
-  case instruction::_FJUMP : { s = "ifFalse " + arg1 + " goto " +arg2; break; }
-  case instruction::_HALT  : { s = "halt \"" + arg1 + "\""; break; }
+  case instruction::_LABEL : { s = "label " + arg1.dump() + " :"; ind = ""; break; }
+  case instruction::_UJUMP : { s = "goto " + arg1.dump(); break; }
+  case instruction::_FJUMP : { s = "ifFalse " + arg1.dump() + " goto " +arg2.dump(); break; }
+  case instruction::_HALT  : { s = "halt \"" + arg1.dump() + "\""; break; }
   case instruction::_LOAD  : 
   case instruction::_FLOAD : 
-  case instruction::_ILOAD : { s = arg1 + " = " + arg2; break; } 
-  case instruction::_CHLOAD : { s = arg1 + " = '" + arg2 +"'"; break; } 
-  case instruction::_PUSH : { s = "pushparam " + (arg1.empty()? "" : arg1); break; }
-  case instruction::_POP : { s = "popparam " + (arg1.empty()? "" : arg1); break; }
-  case instruction::_CALL : { s = "call " + arg1; break; }
+  case instruction::_ILOAD : { s = arg1.dump() + " = " + arg2.dump(); break; } 
+  case instruction::_CHLOAD : { s = arg1.dump() + " = '" + arg2.dump() +"'"; break; } 
+  case instruction::_PUSH : { s = "pushparam " + arg1.dump(); break; }
+  case instruction::_POP : { s = "popparam " + arg1.dump(); break; }
+  case instruction::_CALL : { s = "call " + arg1.dump(); break; }
   case instruction::_RETURN : { s = "return"; break; }
-  case instruction::_XLOAD : { s = arg1 + "[" + arg2 + "] = " + arg3; break; }
-  case instruction::_LOADX : { s = arg1 + " = " + arg2 + "[" + arg3 + "]"; break; }
-  case instruction::_ALOAD : { s = arg1 + " = &" + arg2; break; }
-  case instruction::_LOADC : { s = arg1 + " = *" + arg2; break; }
-  case instruction::_CLOAD : { s = "*" + arg1 + " = " + arg2; break; }
-  case instruction::_READI : { s = "readi " + arg1; break; }
-  case instruction::_READF : { s = "readf " + arg1; break; }
-  case instruction::_READC : { s = "readc " + arg1; break; }
-  case instruction::_WRITEI : { s = "writei " + arg1; break; }
-  case instruction::_WRITEF : { s = "writef " + arg1; break; }
-  case instruction::_WRITEC : { s = "writec " + arg1; break; }
-  case instruction::_WRITES : { s = "writes " + arg1; break; }
+  case instruction::_XLOAD : { s = arg1.dump() + "[" + arg2.dump() + "] = " + arg3.dump(); break; }
+  case instruction::_LOADX : { s = arg1.dump() + " = " + arg2.dump() + "[" + arg3.dump() + "]"; break; }
+  case instruction::_ALOAD : { s = arg1.dump() + " = &" + arg2.dump(); break; }
+  case instruction::_LOADC : { s = arg1.dump() + " = *" + arg2.dump(); break; }
+  case instruction::_CLOAD : { s = "*" + arg1.dump() + " = " + arg2.dump(); break; }
+  case instruction::_ACOPY : { s = "acopy " + arg1.dump() + " " + arg2.dump() + " " + arg3.dump(); break; }
+  case instruction::_AFILL : { s = "afill " + arg1.dump() + " " + arg2.dump() + " " + arg3.dump(); break; }
+  case instruction::_READI : { s = "readi " + arg1.dump(); break; }
+  case instruction::_READF : { s = "readf " + arg1.dump(); break; }
+  case instruction::_READC : { s = "readc " + arg1.dump(); break; }
+  case instruction::_WRITEI : { s = "writei " + arg1.dump(); break; }
+  case instruction::_WRITEF : { s = "writef " + arg1.dump(); break; }
+  case instruction::_WRITEC : { s = "writec " + arg1.dump(); break; }
+  case instruction::_WRITES : { s = "writes " + arg1.dump(); break; }
   case instruction::_WRITELN : { s = "writeln"; break; }
-  case instruction::_ADD : { s = arg1 + " = " + arg2 + " + " + arg3; break; }
-  case instruction::_SUB : { s = arg1 + " = " + arg2 + " - " + arg3; break; }
-  case instruction::_MUL : { s = arg1 + " = " + arg2 + " * " + arg3; break; }
-  case instruction::_DIV : { s = arg1 + " = " + arg2 + " / " + arg3; break; }
-  case instruction::_AND : { s = arg1 + " = " + arg2 + " and " + arg3; break; }
-  case instruction::_OR : { s = arg1 + " = " + arg2 + " or " + arg3; break; }
-  case instruction::_EQ : { s = arg1 + " = " + arg2 + " == " + arg3; break; }
-  case instruction::_LT : { s = arg1 + " = " + arg2 + " < " + arg3; break; }
-  case instruction::_LE : { s = arg1 + " = " + arg2 + " <= " + arg3; break; }
-  case instruction::_NOT : { s = arg1 + " = not " + arg2; break; }
-  case instruction::_NEG : { s = arg1 + " = - " + arg2; break; }
-  case instruction::_FADD : { s = arg1 + " = " + arg2 + " +. " + arg3; break; }
-  case instruction::_FSUB : { s = arg1 + " = " + arg2 + " -. " + arg3; break; }
-  case instruction::_FMUL : { s = arg1 + " = " + arg2 + " *. " + arg3; break; }
-  case instruction::_FDIV : { s = arg1 + " = " + arg2 + " /. " + arg3; break; }
-  case instruction::_FEQ : { s = arg1 + " = " + arg2 + " ==. " + arg3; break; }
-  case instruction::_FLT : { s = arg1 + " = " + arg2 + " <. " + arg3; break; }
-  case instruction::_FLE : { s =  arg1 + " = " + arg2 + " <=. " + arg3; break; }
-  case instruction::_FNEG : { s =  arg1 + " = -. " + arg2; break; }
-  case instruction::_FLOAT : { s = arg1 + " = float " + arg2; break; }
+  case instruction::_ADD : { s = arg1.dump() + " = " + arg2.dump() + " + " + arg3.dump(); break; }
+  case instruction::_SUB : { s = arg1.dump() + " = " + arg2.dump() + " - " + arg3.dump(); break; }
+  case instruction::_MUL : { s = arg1.dump() + " = " + arg2.dump() + " * " + arg3.dump(); break; }
+  case instruction::_DIV : { s = arg1.dump() + " = " + arg2.dump() + " / " + arg3.dump(); break; }
+  case instruction::_AND : { s = arg1.dump() + " = " + arg2.dump() + " and " + arg3.dump(); break; }
+  case instruction::_OR : { s = arg1.dump() + " = " + arg2.dump() + " or " + arg3.dump(); break; }
+  case instruction::_EQ : { s = arg1.dump() + " = " + arg2.dump() + " == " + arg3.dump(); break; }
+  case instruction::_LT : { s = arg1.dump() + " = " + arg2.dump() + " < " + arg3.dump(); break; }
+  case instruction::_LE : { s = arg1.dump() + " = " + arg2.dump() + " <= " + arg3.dump(); break; }
+  case instruction::_NOT : { s = arg1.dump() + " = not " + arg2.dump(); break; }
+  case instruction::_NEG : { s = arg1.dump() + " = - " + arg2.dump(); break; }
+  case instruction::_FADD : { s = arg1.dump() + " = " + arg2.dump() + " +. " + arg3.dump(); break; }
+  case instruction::_FSUB : { s = arg1.dump() + " = " + arg2.dump() + " -. " + arg3.dump(); break; }
+  case instruction::_FMUL : { s = arg1.dump() + " = " + arg2.dump() + " *. " + arg3.dump(); break; }
+  case instruction::_FDIV : { s = arg1.dump() + " = " + arg2.dump() + " /. " + arg3.dump(); break; }
+  case instruction::_FEQ : { s = arg1.dump() + " = " + arg2.dump() + " ==. " + arg3.dump(); break; }
+  case instruction::_FLT : { s = arg1.dump() + " = " + arg2.dump() + " <. " + arg3.dump(); break; }
+  case instruction::_FLE : { s =  arg1.dump() + " = " + arg2.dump() + " <=. " + arg3.dump(); break; }
+  case instruction::_FNEG : { s =  arg1.dump() + " = -. " + arg2.dump(); break; }
+  case instruction::_FLOAT : { s = arg1.dump() + " = float " + arg2.dump(); break; }
   case instruction::_NOOP : { s = "noop"; break; }
   default : { s = "????"; break; }
   }
@@ -156,7 +371,9 @@ string instruction::dump() const {
 // concatenation of instruction+list (or instruction+instruction, via automatic coertion)
 
 instructionList instruction::operator||(const instructionList &lst) const {
-  return instructionList(*this) || lst;
+  instructionList newlist(*this);
+  newlist.append(lst);
+  return newlist;
 }
 
 
@@ -171,17 +388,37 @@ instructionList::instructionList(const instruction &inst) { this->push_back(inst
 instructionList::~instructionList() {}
 
 // concatenation of lists (or list+instruction, via automatic coertion)
-instructionList instructionList::operator||(const instructionList &lst) const {
-  instructionList newlist = (*this);
+instructionList instructionList::operator||(const instructionList &lst) const & {
+  instructionList newlist;
+  newlist.reserve(this->size() + lst.size());
+  newlist.insert(newlist.end(), this->begin(), this->end());
   newlist.insert(newlist.end(), lst.begin(), lst.end());
   return newlist;
 }
+// concatenation to a temporary list: extend it instead of copying it
+instructionList instructionList::operator||(const instructionList &lst) && {
+  this->append(lst);
+  return std::move(*this);
+}
+
+// append at the end of the list
+instructionList & instructionList::append(const instructionList &lst) {
+  this->insert(this->end(), lst.begin(), lst.end());
+  return *this;
+}
+instructionList & instructionList::append(const instruction &inst) {
+  this->push_back(inst);
+  return *this;
+}
 
 // print instructionList (for debugging)
 string instructionList::dump() const {
-  string s;  
-  for (auto i : *this ) s += i.dump() + "\n";
-  return s;
+  ostringstream os;
+  dump(os);
+  return os.str();
+}
+void instructionList::dump(std::ostream & os) const {
+  for (const auto & i : *this) os << i.dump() << '\n';
 }
 
 
@@ -236,13 +473,16 @@ void subroutine::add_instruction(const instruction &inst) {
 }
 /// add instruction list to current instructions
 void subroutine::add_instructions(const instructionList &lins) {
-  for (auto i : lins)
+  for (auto & i : lins)
     this->add_instruction(i);
 }
 /// set instruction list (overwritting current instructions)
-void subroutine::set_instructions(const instructionList &lins) {
-  instructions.clear();
-  this->add_instructions(lins);
+void subroutine::set_instructions(instructionList &&lins) {
+  instructions = std::move(lins);
+  labels.clear();
+  for (size_t pc = 0; pc < instructions.size(); ++pc)
+    if (instructions[pc].oper == instruction::_LABEL)
+      labels.insert(make_pair(instructions[pc].arg1, pc));
 }
 /// get instruction at given program counter
 instruction subroutine::get_instruction_at(size_t pc) const {
@@ -250,31 +490,36 @@ instruction subroutine::get_instruction_at(size_t pc) const {
   return instructions[pc];
 }
 /// get program counter for given label
-size_t subroutine::get_label_pc(std::string &lab) const { return labels.find(lab)->second; }
-/// get the list of instructions (needed only in LLVMCodeGen)
-instructionList subroutine::get_instructions() const {
+size_t subroutine::get_label_pc(const operand &lab) const { return labels.find(lab)->second; }
+/// check whether the label is declared
+bool subroutine::has_label(const operand &lab) const { return labels.find(lab) != labels.end(); }
+/// get the list of instructions
+const instructionList & subroutine::get_instructions() const {
   return instructions;
 }
 /// print (for debugging)
 string subroutine::dump() const {
-  string s;
-  s = "function " + name + "\n";
+  ostringstream os;
+  dump(os);
+  return os.str();
+}
+void subroutine::dump(std::ostream & os) const {
+  os << "function " << name << "\n";
   if (not params.empty()) {
-    s += "  params\n" ;
-    for (auto p : params) s += "    " + p.dump() + "\n";
-    s += "  endparams\n\n";
+    os << "  params\n" ;
+    for (const auto & p : params) os << "    " << p.dump() << "\n";
+    os << "  endparams\n\n";
   }
   if (not vars.empty()) {
-    s += "  vars\n";
-    for (auto v : vars) s += "    " + v.dump() + "\n";
-    s += "  endvars\n\n";
+    os << "  vars\n";
+    for (const auto & v : vars) os << "    " << v.dump() << "\n";
+    os << "  endvars\n\n";
   }
 
-  string ind = "  ";
+  const char * ind = "  ";
   if (labels.empty()) ind="";
-  for (auto i : instructions) s += ind + i.dump() + "\n";  
-  s += "endfunction\n\n";
-  return s;
+  for (const auto & i : instructions) os << ind << i.dump() << "\n";
+  os << "endfunction\n\n";
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -302,15 +547,21 @@ void code::add_subroutine(const subroutine &s) {
   subs.push_back(s);
   names.insert(make_pair(s.get_name(), subs.size()-1));
 }
-/// get the list of subroutine's (needed only in LLVMCodeGen)
+/// get the list of subroutine's
 const std::vector<subroutine> & code::get_subroutine_list() const {
   return subs;
 }
+std::vector<subroutine> & code::get_subroutine_list() {
+  return subs;
+}
 /// print (for debugging)
 string code::dump() const {
-  string c;
-  for (auto s : subs) c += s.dump();
-  return c;
+  ostringstream os;
+  dump(os);
+  return os.str();
+}
+void code::dump(std::ostream & os) const {
+  for (const auto & s : subs) s.dump(os);
 }
 /// print the code in LLVM IR
 std::string code::dumpLLVM(const TypesMgr & Types, const SymTable & Symbols) const {
@@ -318,21 +569,44 @@ std::string code::dumpLLVM(const TypesMgr & Types, const SymTable & Symbols) con
   std::string llvmStr = llvmCode.dumpLLVM();
   return llvmStr;
 }
+bool code::dumpLLVM(const TypesMgr & Types, const SymTable & Symbols,
+                    std::string & llvmStr, std::string & errorMessage) const {
+  LLVMCodeGen llvmCode(Types, Symbols, *this);
+  return llvmCode.dumpLLVM(llvmStr, errorMessage);
+}
+bool code::dumpLLVM(const TypesMgr & Types, const SymTable & Symbols,
+                    std::ostream & os, std::string & errorMessage) const {
+  LLVMCodeGen llvmCode(Types, Symbols, *this);
+  return llvmCode.dumpLLVM(os, errorMessage);
+}
+/// print the code in binary t-code format (see class Interpreter)
+std::string code::dumpBinary() const {
+  Interpreter binCode(*this);
+  if (binCode.hasErrors()) return "";
+  std::ostringstream binStr;
+  binCode.writeImage(binStr);
+  return binStr.str();
+}
+bool code::dumpBinary(std::ostream & os) const {
+  Interpreter binCode(*this);
+  if (binCode.hasErrors()) return false;
+  binCode.writeImage(os);
+  return bool(os);
+}
 
 
 ////////////////////////////////////////////////////////////////////
-/// Static methods to manage counters
-int counters::countIF = 0;
-int counters::countWHILE = 0;
-int counters::countTEMP = 0;
+/// Methods to manage counters
 
 string counters::newLabelIF() { return std::to_string(++countIF); }
 string counters::newLabelWHILE() { return std::to_string(++countWHILE); }
-string counters::newTEMP() { return std::to_string(++countTEMP); }
+string counters::newLabelLOGIC() { return std::to_string(++countLOGIC); }
+operand counters::newTEMP() { return operand::temporal(++countTEMP); }
 
 void counters::resetLabelIF() { countIF = 0; }
 void counters::resetLabelWHILE() { countWHILE = 0; }
+void counters::resetLabelLOGIC() { countLOGIC = 0; }
 void counters::resetTEMP() { countTEMP = 0; }
 
-void counters::resetLabels() { resetLabelIF(); resetLabelWHILE(); }
+void counters::resetLabels() { resetLabelIF(); resetLabelWHILE(); resetLabelLOGIC(); }
 void counters::reset() { resetLabels(); resetTEMP(); }
@@ -31,6 +31,9 @@
 #include <map>
 #include <list>
 #include <vector>
+#include <string>
+#include <iosfwd>
+#include <cstdint>
 #include "TypesMgr.h"
 #include "SymTable.h"
 
@@ -39,6 +42,82 @@
 class instructionList;
 class LLVMCodeGen;
 
+////////////////////////////////////////////////////////////////////
+/// Class operand stores an argument of an instruction: its kind and a
+/// 32-bit value (number of a temporal, immediate constant, or index of
+/// a name or string in the table of interned strings). Names are
+/// interned once for the whole process, so operands are compared as
+/// integers and the text is only built in dump()
+
+class operand {
+public:
+  /// kinds of operands
+  typedef enum {NONE, TEMP, VAR, INT, FLOAT, CHAR, LABEL, FUNC, STRING} Kind;
+
+  /// constructor: no operand
+  operand();
+  /// constructor from the t-code text: "" is no operand, "%n" a temporal,
+  /// numbers are int/float constants, and any other text a variable name
+  operand(const std::string &text);
+  operand(const char *text);
+
+  /// ------ specific constructors for each kind -------
+
+  // temporal "%n"
+  static operand temporal(std::uint32_t n);
+  // local variable or parameter
+  static operand variable(const std::string &name);
+  // integer constant
+  static operand intConst(std::int32_t n);
+  // float constant
+  static operand floatConst(float f);
+  // character constant (text between quotes, maybe an escape sequence)
+  static operand charConst(const std::string &text);
+  // label name
+  static operand label(const std::string &name);
+  // subroutine name
+  static operand function(const std::string &name);
+  // string constant (of writes and halt)
+  static operand stringConst(const std::string &text);
+
+  /// kind of the operand
+  Kind kind() const;
+  bool isNone() const;
+  bool isTemp() const;
+  bool isVar() const;
+  bool isLabel() const;
+  /// true for int, float and char constants
+  bool isConst() const;
+
+  /// number of a temporal or index of an interned name
+  std::uint32_t id() const;
+  /// value of an int or char constant
+  std::int32_t intValue() const;
+  /// value of a float constant
+  float floatValue() const;
+  /// interned text of a variable, label, function or string ("" otherwise)
+  const std::string & name() const;
+
+  bool operator==(const operand &op) const;
+  bool operator!=(const operand &op) const;
+  bool operator<(const operand &op) const;
+
+  // print operand (as written in the t-code)
+  std::string dump() const;
+
+private:
+  std::uint8_t k;
+  union {
+    std::uint32_t u;
+    std::int32_t  i;
+    float         f;
+  } v;
+
+  operand(Kind kind, std::uint32_t value);
+  static std::uint32_t intern(const std::string &text);
+};
+
+
 ////////////////////////////////////////////////////////////////////
 /// Class instruction stores a VM instruction code with its operands
 
@@ -49,16 +128,19 @@ public:
                 _ADD, _SUB, _MUL, _DIV, _EQ, _LT, _LE, _NEG, _NOT, _AND, _OR, _FLOAT,
                 _FADD, _FSUB, _FMUL, _FDIV, _FEQ, _FLT, _FLE, _FNEG,
                 _LOAD, _ILOAD, _CHLOAD, _FLOAD, _XLOAD, _LOADX, _ALOAD, _LOADC, _CLOAD,
+                _ACOPY, _AFILL,
                 _READI, _READF, _READC, _WRITEI, _WRITEF, _WRITEC, _WRITES, _WRITELN, _NOOP, _INVALID} Operation;
   
   /// instruction code
   Operation oper;
   /// arguments
-  std::string arg1, arg2, arg3;
+  operand arg1, arg2, arg3;
+  /// line of the ASL statement it has been generated for (0 if unknown)
+  std::uint32_t line;
   
   /// constructor
   instruction(Operation op,
-              const std::string &a1="", const std::string &a2="", const std::string &a3="");
+              const operand &a1=operand(), const operand &a2=operand(), const operand &a3=operand());
 
   /// destructor
   ~instruction();
@@ -73,87 +155,91 @@ public:
   // create new instruction "goto a1"
   static instruction UJUMP(const std::string &a1);
   // create new instruction "ifFalse a1 goto a2"
-  static instruction FJUMP(const std::string &a1, const std::string &a2);
+  static instruction FJUMP(const operand &a1, const std::string &a2);
   // create new instruction "halt"
   static instruction HALT(const std::string &a1="");
   // create new instruction "pushparam a1"
-  static instruction PUSH(const std::string &a1="");
+  static instruction PUSH(const operand &a1=operand());
   // create new instruction "popparam a1"
-  static instruction POP(const std::string &a1="");
+  static instruction POP(const operand &a1=operand());
   // create new instruction "call a1"
   static instruction CALL(const std::string &a1);
   // create new instruction "return"
   static instruction RETURN();
   // create new instruction "a1 = a2 + a3"
-  static instruction ADD(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction ADD(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 - a3"
-  static instruction SUB(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction SUB(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 * a3"
-  static instruction MUL(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction MUL(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 / a3"
-  static instruction DIV(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction DIV(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 == a3"
-  static instruction EQ(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction EQ(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 < a3"
-  static instruction LT(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction LT(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 <= a3"
-  static instruction LE(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction LE(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 and a3"
-  static instruction AND(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction AND(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 or a3"
-  static instruction OR(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction OR(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 +. a3"
-  static instruction FADD(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FADD(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 -. a3"
-  static instruction FSUB(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FSUB(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 *. a3"
-  static instruction FMUL(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FMUL(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 /. a3"
-  static instruction FDIV(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FDIV(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 ==. a3"
-  static instruction FEQ(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FEQ(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 <. a3"
-  static instruction FLT(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FLT(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 <=. a3"
-  static instruction FLE(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FLE(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = not a2"
-  static instruction NOT(const std::string &a1, const std::string &a2);
+  static instruction NOT(const operand &a1, const operand &a2);
   // create new instruction "a1 = - a2"
-  static instruction NEG(const std::string &a1, const std::string &a2);
+  static instruction NEG(const operand &a1, const operand &a2);
   // create new instruction "a1 = -. a2"
-  static instruction FNEG(const std::string &a1, const std::string &a2);
+  static instruction FNEG(const operand &a1, const operand &a2);
   // create new instruction "a1 = float a2"
-  static instruction FLOAT(const std::string &a1, const std::string &a2);  
+  static instruction FLOAT(const operand &a1, const operand &a2);  
   // create new instruction "a1 = a2"
-  static instruction LOAD(const std::string &a1, const std::string &a2);
+  static instruction LOAD(const operand &a1, const operand &a2);
   // create new instruction "a1 = a2" (whereF a2 is an integer constant)
-  static instruction ILOAD(const std::string &a1, const std::string &a2);
+  static instruction ILOAD(const operand &a1, const std::string &a2);
   // create new instruction "a1 = a2" (where a2 is a character constant)
-  static instruction CHLOAD(const std::string &a1, const std::string &a2);
+  static instruction CHLOAD(const operand &a1, const std::string &a2);
   // create new instruction "a1 = a2" (where a2 is a float constant)
-  static instruction FLOAD(const std::string &a1, const std::string &a2);
+  static instruction FLOAD(const operand &a1, const std::string &a2);
   // create new instruction "a1[a2] = a3" 
-  static instruction XLOAD(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction XLOAD(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2[a3]" 
-  static instruction LOADX(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction LOADX(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = &a2" 
-  static instruction ALOAD(const std::string &a1, const std::string &a2);
+  static instruction ALOAD(const operand &a1, const operand &a2);
   // create new instruction "a1 = *a2" 
-  static instruction LOADC(const std::string &a1, const std::string &a2);
+  static instruction LOADC(const operand &a1, const operand &a2);
   // create new instruction "*a1 = a2" 
-  static instruction CLOAD(const std::string &a1, const std::string &a2);
+  static instruction CLOAD(const operand &a1, const operand &a2);
+  // create new instruction "acopy a1 a2 a3" (a1[0..a3-1] = a2[0..a3-1])
+  static instruction ACOPY(const operand &a1, const operand &a2, const operand &a3);
+  // create new instruction "afill a1 a2 a3" (a1[0..a3-1] = a2)
+  static instruction AFILL(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "readi a1" 
-  static instruction READI(const std::string &a1);
+  static instruction READI(const operand &a1);
   // create new instruction "readf a1" 
-  static instruction READF(const std::string &a1);
+  static instruction READF(const operand &a1);
   // create new instruction "readc a1" 
-  static instruction READC(const std::string &a1);
+  static instruction READC(const operand &a1);
   // create new instruction "writei a1" 
-  static instruction WRITEI(const std::string &a1); 
+  static instruction WRITEI(const operand &a1); 
   // create new instruction "writef a1" 
-  static instruction WRITEF(const std::string &a1);
+  static instruction WRITEF(const operand &a1);
   // create new instruction "writec a1" 
-  static instruction WRITEC(const std::string &a1);
+  static instruction WRITEC(const operand &a1);
   // create new instruction "writes 'string constant'" 
   static instruction WRITES(const std::string &a1);
   // create new instruction "writeln" 
@@ -178,11 +264,20 @@ public:
   // destructor
   ~instructionList();
 
-  // concatenation of lists (or list+instruction, via automatic coertion)
-  instructionList operator||(const instructionList &lst) const;
+  // concatenation of lists (or list+instruction, via automatic coertion).
+  // A temporary left operand is extended in place, so chains such as
+  // "a || b || c" only copy each instruction once
+  instructionList operator||(const instructionList &lst) const &;
+  instructionList operator||(const instructionList &lst) &&;
+
+  // append a list (or an instruction) at the end of this one
+  instructionList & append(const instructionList &lst);
+  instructionList & append(const instruction &inst);
 
   // print instructionList
   std::string dump() const;   
+  // the same, written to the stream as it goes
+  void dump(std::ostream & os) const;
 };
 
 
@@ -213,8 +308,8 @@ private:
   std::string name;
   /// instructions
   instructionList instructions;
-  /// map label name -> position in instructions
-  std::map<std::string, size_t> labels;
+  /// map label -> position in instructions
+  std::map<operand, size_t> labels;
 
 public:
   /// list of local variables
@@ -239,17 +334,21 @@ public:
   /// add instruction list to current instructions
   void add_instructions(const instructionList &lins);
   /// set instruction list (overwritting current instructions)
-  void set_instructions(const instructionList &lins);
+  void set_instructions(instructionList &&lins);
   
   /// get instruction at given program counter in subroutine
   instruction get_instruction_at(size_t pc) const;
   /// get program counter in subroutine for given label
-  size_t get_label_pc(std::string &lab) const;
-  /// get the list of instructions (needed only in LLVMCodeGen)
-  instructionList get_instructions() const;
+  size_t get_label_pc(const operand &lab) const;
+  /// check whether the subroutine declares the given label
+  bool has_label(const operand &lab) const;
+  /// get the list of instructions
+  const instructionList & get_instructions() const;
 
   // print subroutine (params, vars, and instructions)
   std::string dump() const;
+  // the same, written to the stream as it goes
+  void dump(std::ostream & os) const;
 };
 
 
@@ -274,13 +373,27 @@ public:
   const subroutine& get_subroutine(const std::string &name) const;
   /// add new subroutine
   void add_subroutine(const subroutine &s);
-  /// get the list of subroutines (needed only in LLVMCodeGen)
+  /// get the list of subroutines
   const std::vector<subroutine> & get_subroutine_list() const;
+  std::vector<subroutine> & get_subroutine_list();
 
   // print code (all info for all subroutines)
   std::string dump() const;
+  // the same, written to the stream one subroutine at a time
+  void dump(std::ostream & os) const;
   /// print the code in LLVM IR
   std::string dumpLLVM(const TypesMgr & Types, const SymTable &Symbols) const;
+  /// the same, returning false and the reason if some construct has no LLVM translation
+  bool dumpLLVM(const TypesMgr & Types, const SymTable &Symbols,
+                std::string & llvmStr, std::string & errorMessage) const;
+  /// the same, written to the stream one subroutine at a time (it may
+  /// have part of the code when it fails)
+  bool dumpLLVM(const TypesMgr & Types, const SymTable &Symbols,
+                std::ostream & os, std::string & errorMessage) const;
+  /// print the code in binary t-code format (empty if the code is not valid)
+  std::string dumpBinary() const;
+  /// the same, written to the stream (false if the code is not valid)
+  bool dumpBinary(std::ostream & os) const;
   
   // Error codes for "HALT" instruction
   static const std::string INDEX_OUT_OF_RANGE;
@@ -291,28 +404,35 @@ public:
 
 
 ////////////////////////////////////////////////////////////////////
-/// Class counters manages temporal and labels counters
+/// Class counters manages temporal and labels counters. Every code
+/// generator has its own counters, so that several functions can be
+/// generated at the same time
 
 class counters {
 private:
-  static int countIF;
-  static int countWHILE;
-  static int countTEMP;
+  int countIF    = 0;
+  int countWHILE = 0;
+  int countLOGIC = 0;
+  int countTEMP  = 0;
 
 public:
-  // return id for new label or temp (id is a number, but returned as string
+  // return id for new label (id is a number, but returned as string
   // to ease concatenation with other literals (e.g. "labelIF" + "4" -> "LabelIF4")
-  static std::string newLabelIF();
-  static std::string newLabelWHILE();
-  static std::string newTEMP();
+  std::string newLabelIF();
+  std::string newLabelWHILE();
+  // labels of the short-circuit evaluation of "and" and "or"
+  std::string newLabelLOGIC();
+  // return a new temporal operand (e.g. "%4")
+  operand newTEMP();
   
   // reset individual counters 
-  static void resetLabelIF();
-  static void resetLabelWHILE();
-  static void resetTEMP();
+  void resetLabelIF();
+  void resetLabelWHILE();
+  void resetLabelLOGIC();
+  void resetTEMP();
   
-  // reset label counters (IF and WHILE)
-  static void resetLabels();
-  // reset all counters (IF, WHILE, and TEMP)
-  static void reset();
+  // reset label counters (IF, WHILE and LOGIC)
+  void resetLabels();
+  // reset all counters (IF, WHILE, LOGIC, and TEMP)
+  void reset();
 };